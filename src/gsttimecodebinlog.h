@@ -0,0 +1,111 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* On-disk layout of the binary logs written with log-format=binary.
+ *
+ * A file is one header followed by fixed-size records, so record i starts at
+ * header_size + i * record_size. All integers are little-endian. Readers must
+ * use header_size and record_size from the header rather than sizeof(), so
+ * later versions can append fields.
+ *
+ * Since version 5 several elements of a process can share a file. Each
+ * record carries the index of its stream, and before the first record of
+ * a stream a GstTimecodeBinlogStream record announces its name. Such a
+ * record has GST_TIMECODE_BINLOG_FLAG_STREAM set and is no frame. A stream
+ * whose name changes is announced again. Earlier versions have a single
+ * stream 0 without a name.
+ *
+ * This header only depends on the C library so that tools can read the logs
+ * without linking GStreamer.
+ */
+
+#ifndef __GST_TIMECODE_BINLOG_H__
+#define __GST_TIMECODE_BINLOG_H__
+
+#include <stdint.h>
+
+#define GST_TIMECODE_BINLOG_MAGIC "GSTTCLOG"
+#define GST_TIMECODE_BINLOG_VERSION 5
+
+/* Which element wrote the file */
+#define GST_TIMECODE_BINLOG_KIND_SENDER   0   /* timecodeoverlay */
+#define GST_TIMECODE_BINLOG_KIND_RECEIVER 1   /* timecodeparse */
+
+/* Record flags */
+#define GST_TIMECODE_BINLOG_FLAG_NO_LATENCY    (1u << 0)  /* latency is -1 */
+#define GST_TIMECODE_BINLOG_FLAG_NO_SEC_OFFSET (1u << 1)  /* sec_offset could not be read */
+#define GST_TIMECODE_BINLOG_FLAG_STREAM        (1u << 2)  /* a GstTimecodeBinlogStream */
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t record_size;
+  uint32_t kind;
+  /* sec_offset of the first record that carried one. Updated in place once
+   * known, so it may be 0 if no record ever had one. Compressed files are
+   * not updated; there it stays 0 unless the first record had one. */
+  uint64_t sec_offset;
+  /* Streams announced so far, updated in place. In compressed files the
+   * streams known when the header was written. Version 5, 0 before. */
+  uint32_t n_streams;
+  uint32_t reserved0;
+  uint32_t width;
+  uint32_t height;
+  int32_t fps_n;
+  int32_t fps_d;
+  uint8_t reserved1[8];
+} GstTimecodeBinlogHeader;
+
+typedef struct {
+  uint64_t frame_nr;
+  uint64_t time_s;
+  uint64_t time_p;                /* 0 in sender logs */
+  int64_t latency;                /* 0 in sender logs */
+  uint32_t flags;
+  int32_t sec_offset_delta;       /* record sec_offset - header sec_offset */
+  /* Version 2 */
+  uint32_t hop;                   /* 0 in sender logs */
+  uint32_t stream;                /* Version 5, 0 before */
+  int64_t hop_delta;              /* -1 for hop 0 and in sender logs */
+  /* Version 3 */
+  int64_t clock_offset;           /* µs added to the local wall clock */
+  int64_t clock_error;            /* µs, -1 if unknown */
+  /* Version 4 */
+  uint64_t time_r;                /* 0 in sender logs and if not measured */
+  int64_t render_latency;         /* -1 in sender logs and if not measured */
+} GstTimecodeBinlogRecord;
+
+/* Same size as a record, flags and stream at the same place */
+typedef struct {
+  uint8_t reserved0[32];
+  uint32_t flags;                 /* GST_TIMECODE_BINLOG_FLAG_STREAM */
+  uint32_t reserved1;
+  uint32_t reserved2;
+  uint32_t stream;
+  char name[40];                  /* NUL-padded, not terminated if 40 long */
+} GstTimecodeBinlogStream;
+
+_Static_assert (sizeof (GstTimecodeBinlogHeader) == 64, "binlog header layout");
+_Static_assert (sizeof (GstTimecodeBinlogRecord) == 88, "binlog record layout");
+_Static_assert (sizeof (GstTimecodeBinlogStream) == sizeof (GstTimecodeBinlogRecord),
+    "binlog stream layout");
+
+#endif /* __GST_TIMECODE_BINLOG_H__ */
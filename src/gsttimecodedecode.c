@@ -0,0 +1,327 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecodedecode.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Adds the sum of every pstride-th byte of [x[i], x[i] + width) of rows
+ * [0, n_rows) of each of n_cells cells to sums. pstride is 1, 2 or 4. The
+ * SIMD kernels load 16 bytes per cell and row, mask out the other components,
+ * and hand the cells near the end of the row to the next narrower kernel. */
+typedef void (*SumCellsFunc) (const guint8 * y, gint stride, guint n_rows,
+    guint n_cells, const guint * x, guint width, guint pstride,
+    gsize row_bytes, guint32 * sums);
+
+static void
+sum_cells_scalar (const guint8 *y, gint stride, guint n_rows, guint n_cells,
+    const guint *x, guint width, guint pstride, gsize row_bytes, guint32 *sums)
+{
+  for (guint cell = 0; cell < n_cells; cell++) {
+    const guint8 *p = y + x[cell];
+    guint32 sum = 0;
+    for (guint line = 0; line < n_rows; line++, p += stride)
+      for (guint i = 0; i < width; i += pstride)
+        sum += p[i];
+    sums[cell] += sum;
+  }
+}
+
+/* For components deeper than 8 bits, stored as 16-bit little-endian samples.
+ * Not vectorized: the 10-bit formats are rare enough. */
+static void
+sum_cells_16 (const guint8 *y, gint stride, guint n_rows,
+    const GsttimecodeCells *cells, guint32 *sums)
+{
+  for (guint cell = 0; cell < cells->n_cells; cell++) {
+    const guint8 *p = y + cells->x[cell];
+    guint32 sum = 0;
+    for (guint line = 0; line < n_rows; line++, p += stride)
+      for (guint i = 0; i < cells->width * cells->pstride; i += cells->pstride)
+        sum += (p[i] | (p[i + 1] << 8)) >> cells->shift;
+    sums[cell] += sum;
+  }
+}
+
+/* Byte masks selecting the first n bytes of a 16-byte vector */
+static const guint8 lead_mask[17][16] __attribute__ ((aligned (16))) = {
+#define M(n) { [0 ... (n) - 1] = 0xff }
+  { 0 }, M(1), M(2), M(3), M(4), M(5), M(6), M(7), M(8),
+  M(9), M(10), M(11), M(12), M(13), M(14), M(15), M(16),
+#undef M
+};
+
+/* Byte masks selecting one byte out of every 1, 2 or 4 */
+static const guint8 component_mask[5][16] __attribute__ ((aligned (16))) = {
+  [1] = { [0 ... 15] = 0xff },
+  [2] = { 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0 },
+  [4] = { 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0 },
+};
+
+#ifdef HAVE_SSE2
+static void
+sum_cells_sse2 (const guint8 *y, gint stride, guint n_rows, guint n_cells,
+    const guint *x, guint width, guint pstride, gsize row_bytes, guint32 *sums)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const guint head = (width - 1) & ~15u;
+  const __m128i comp = _mm_load_si128 ((const __m128i *) component_mask[pstride]);
+  const __m128i mask = _mm_and_si128 (comp,
+      _mm_load_si128 ((const __m128i *) lead_mask[width - head]));
+  guint cell = 0;
+
+  for (; cell < n_cells; cell++) {
+    if (x[cell] + head + 16 > row_bytes)
+      break;
+    const guint8 *p = y + x[cell];
+    __m128i acc = zero;
+    for (guint line = 0; line < n_rows; line++, p += stride) {
+      guint i = 0;
+      for (; i < head; i += 16)
+        acc = _mm_add_epi64 (acc, _mm_sad_epu8 (_mm_and_si128 (
+                _mm_loadu_si128 ((const __m128i *) (p + i)), comp), zero));
+      __m128i v = _mm_and_si128 (_mm_loadu_si128 ((const __m128i *) (p + i)), mask);
+      acc = _mm_add_epi64 (acc, _mm_sad_epu8 (v, zero));
+    }
+    sums[cell] += _mm_cvtsi128_si32 (acc) +
+        _mm_cvtsi128_si32 (_mm_unpackhi_epi64 (acc, acc));
+  }
+
+  if (cell < n_cells)
+    sum_cells_scalar (y, stride, n_rows, n_cells - cell, x + cell, width,
+        pstride, row_bytes, sums + cell);
+}
+#endif
+
+#ifdef HAVE_AVX2
+/* Two cells per iteration: their 16-byte windows go into the two halves of
+ * one register, so a single SAD yields both sums. */
+__attribute__ ((target ("avx2")))
+static void
+sum_cells_avx2 (const guint8 *y, gint stride, guint n_rows, guint n_cells,
+    const guint *x, guint width, guint pstride, gsize row_bytes, guint32 *sums)
+{
+  if (width > 16) {
+    sum_cells_sse2 (y, stride, n_rows, n_cells, x, width, pstride, row_bytes,
+        sums);
+    return;
+  }
+
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i mask = _mm256_broadcastsi128_si256 (_mm_and_si128 (
+          _mm_load_si128 ((const __m128i *) lead_mask[width]),
+          _mm_load_si128 ((const __m128i *) component_mask[pstride])));
+  guint cell = 0;
+
+  for (; cell + 1 < n_cells; cell += 2) {
+    if (x[cell + 1] + 16 > row_bytes)
+      break;
+    const guint8 *p0 = y + x[cell];
+    const guint8 *p1 = y + x[cell + 1];
+    __m256i acc = zero;
+    for (guint line = 0; line < n_rows; line++, p0 += stride, p1 += stride) {
+      __m256i v = _mm256_inserti128_si256 (_mm256_castsi128_si256 (
+              _mm_loadu_si128 ((const __m128i *) p0)),
+          _mm_loadu_si128 ((const __m128i *) p1), 1);
+      acc = _mm256_add_epi64 (acc, _mm256_sad_epu8 (_mm256_and_si256 (v, mask), zero));
+    }
+    sums[cell] += _mm256_extract_epi32 (acc, 0) + _mm256_extract_epi32 (acc, 2);
+    sums[cell + 1] += _mm256_extract_epi32 (acc, 4) + _mm256_extract_epi32 (acc, 6);
+  }
+
+  if (cell < n_cells)
+    sum_cells_sse2 (y, stride, n_rows, n_cells - cell, x + cell, width,
+        pstride, row_bytes, sums + cell);
+}
+#endif
+
+#ifdef HAVE_NEON
+static void
+sum_cells_neon (const guint8 *y, gint stride, guint n_rows, guint n_cells,
+    const guint *x, guint width, guint pstride, gsize row_bytes, guint32 *sums)
+{
+  const guint head = (width - 1) & ~15u;
+  const uint8x16_t comp = vld1q_u8 (component_mask[pstride]);
+  const uint8x16_t mask = vandq_u8 (comp, vld1q_u8 (lead_mask[width - head]));
+  guint cell = 0;
+
+  for (; cell < n_cells; cell++) {
+    if (x[cell] + head + 16 > row_bytes)
+      break;
+    const guint8 *p = y + x[cell];
+    uint32x4_t acc = vdupq_n_u32 (0);
+    for (guint line = 0; line < n_rows; line++, p += stride) {
+      guint i = 0;
+      for (; i < head; i += 16)
+        acc = vpadalq_u16 (acc, vpaddlq_u8 (vandq_u8 (vld1q_u8 (p + i), comp)));
+      acc = vpadalq_u16 (acc, vpaddlq_u8 (vandq_u8 (vld1q_u8 (p + i), mask)));
+    }
+    uint64x2_t acc64 = vpaddlq_u32 (acc);
+    sums[cell] += (guint32) (vgetq_lane_u64 (acc64, 0) + vgetq_lane_u64 (acc64, 1));
+  }
+
+  if (cell < n_cells)
+    sum_cells_scalar (y, stride, n_rows, n_cells - cell, x + cell, width,
+        pstride, row_bytes, sums + cell);
+}
+#endif
+
+static SumCellsFunc
+select_kernel (const gchar **name)
+{
+#ifdef HAVE_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    *name = "avx2";
+    return sum_cells_avx2;
+  }
+#endif
+#ifdef HAVE_SSE2
+  *name = "sse2";
+  return sum_cells_sse2;
+#elif defined(HAVE_NEON)
+  *name = "neon";
+  return sum_cells_neon;
+#else
+  *name = "scalar";
+  return sum_cells_scalar;
+#endif
+}
+
+static SumCellsFunc sum_cells;
+static const gchar *sum_cells_name;
+
+static void
+init_kernel (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    sum_cells = select_kernel (&sum_cells_name);
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+const gchar *
+gst_timecode_decode_kernel_name (void)
+{
+  init_kernel ();
+  return sum_cells_name;
+}
+
+/* Scaled layouts have cells that differ by a pixel, so every cell gets the
+ * same interior size, centred in the cell. */
+void
+gst_timecode_cells_init (GsttimecodeCells *cells,
+    const GsttimecodeLayout *layout, guint row,
+    const GsttimecodeComponent *comp)
+{
+  guint min_w = G_MAXUINT;
+  for (guint i = 0; i < layout->cells; i++)
+    min_w = MIN (min_w, layout->x[i + 1] - layout->x[i]);
+
+  cells->n_cells = layout->cells;
+  cells->bits_per_cell = layout->bits_per_cell;
+  cells->width = MAX (min_w - 2 * (min_w / 4), 1);
+  for (guint i = 0; i < layout->cells; i++) {
+    guint x = layout->x[i] + (layout->x[i + 1] - layout->x[i] - cells->width) / 2;
+    cells->x[i] = (x >> comp->w_sub) * comp->pstride + comp->poffset;
+  }
+  cells->pstride = comp->pstride;
+  cells->depth = comp->depth;
+  cells->shift = comp->shift;
+
+  guint h = layout->y[row + 1] - layout->y[row];
+  cells->height = MAX (h - 2 * (h / 4), 1);
+  cells->top = layout->y[row] + (h - cells->height) / 2;
+}
+
+/* Gray code of the four levels, so that mistaking a cell for a neighbouring
+ * level costs a single bit */
+static const guint8 level_symbol[GST_TIMECODE_LEVELS] = { 0, 1, 3, 2 };
+
+guint
+gst_timecode_decode_word (const guint8 *plane, gint stride, gsize row_bytes,
+    const GsttimecodeCells *cells, guint64 *word)
+{
+  guint32 sums[GST_TIMECODE_WORD_BITS] = { 0 };
+
+  init_kernel ();
+
+  const guint8 *top = plane + (gsize) cells->top * stride;
+  if (cells->depth == 8)
+    sum_cells (top, stride, cells->height, cells->n_cells, cells->x,
+        (cells->width - 1) * cells->pstride + 1, cells->pstride, row_bytes,
+        sums);
+  else
+    sum_cells_16 (top, stride, cells->height, cells, sums);
+
+  /* Means are compared in 8 bits */
+  guint n = (cells->width * cells->height) << (cells->depth - 8);
+  guint64 value = 0;
+
+  if (cells->bits_per_cell == 1) {
+    guint min_margin = 128;
+    for (guint bit = 0; bit < cells->n_cells; bit++) {
+      guint mean = (sums[bit] + n / 2) / n;
+      guint margin = mean >= 128 ? mean - 128 + 1 : 128 - mean;
+      value = (value << 1) | (mean >= 128);
+      min_margin = MIN (min_margin, margin);
+    }
+    *word = value;
+    return min_margin * 100 / 128;
+  }
+
+  /* Levels are 85 apart, the boundaries lie halfway between them */
+  const guint half = 255 / (GST_TIMECODE_LEVELS - 1) / 2 + 1;
+  guint min_margin = half;
+  for (guint cell = 0; cell < cells->n_cells; cell++) {
+    guint mean = (sums[cell] + n / 2) / n;
+    guint level = (mean * (GST_TIMECODE_LEVELS - 1) + 128) / 255;
+    guint center = level * 255 / (GST_TIMECODE_LEVELS - 1);
+    guint margin = half;
+    /* Black and white only have a boundary on one side */
+    if ((mean < center && level > 0) ||
+        (mean > center && level < GST_TIMECODE_LEVELS - 1))
+      margin = half - MIN (ABS ((gint) mean - (gint) center), half);
+    value = (value << 2) | level_symbol[level];
+    min_margin = MIN (min_margin, margin);
+  }
+  *word = value;
+  return min_margin * 100 / half;
+}
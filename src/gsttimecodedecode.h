@@ -0,0 +1,64 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_TIMECODE_DECODE_H__
+#define __GST_TIMECODE_DECODE_H__
+
+#include <glib.h>
+
+#include "gsttimecodelayout.h"
+#include "gsttimecodeformat.h"
+
+G_BEGIN_DECLS
+
+/* Where the interior of each cell of one word lies in the plane of the
+ * sampled component. Only the inner half of each cell is sampled, which
+ * ignores the ringing that compression leaves along the cell edges. */
+typedef struct {
+  guint n_cells;
+  guint bits_per_cell;              /* 1: black/white, 2: four grey levels */
+  guint x[GST_TIMECODE_WORD_BITS];  /* byte offset of the first interior sample */
+  guint width;                      /* interior samples per cell row */
+  guint top;                        /* first interior row */
+  guint height;                     /* interior rows */
+  guint pstride;                    /* bytes from one sample to the next */
+  guint depth;
+  guint shift;
+} GsttimecodeCells;
+
+void gst_timecode_cells_init (GsttimecodeCells * cells,
+    const GsttimecodeLayout * layout, guint row,
+    const GsttimecodeComponent * comp);
+
+/* Decodes one 64-bit word, most significant bit first, by comparing the
+ * mean interior value of each cell with mid-grey, or for two bits per cell
+ * with the boundaries between the four grey levels. row_bytes is how many
+ * bytes of each row of the plane may be read. The returned confidence
+ * (0-100) is the distance of the least certain cell from the nearest
+ * boundary, relative to half the distance between two levels. */
+guint gst_timecode_decode_word (const guint8 * plane, gint stride,
+    gsize row_bytes, const GsttimecodeCells * cells, guint64 * word);
+
+/* Name of the kernel gst_timecode_decode_word() uses on this CPU */
+const gchar *gst_timecode_decode_kernel_name (void);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_DECODE_H__ */
@@ -0,0 +1,111 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecodedense.h"
+
+#define MASK(bits) ((G_GUINT64_CONSTANT (1) << (bits)) - 1)
+
+/* CRC-32C (Castagnoli), which detects up to 5 bit errors in messages of
+ * this length. Bitwise, the block is at most 52 bytes per frame. */
+static guint32
+crc32c_update (guint32 crc, guint64 word, guint n_bytes)
+{
+  for (guint i = 0; i < n_bytes; i++) {
+    crc ^= (word >> (56 - 8 * i)) & 0xff;
+    for (guint bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0x82F63B78 & -(crc & 1));
+  }
+  return crc;
+}
+
+static guint32
+compute_crc (const guint64 *words, guint n_rows)
+{
+  guint32 crc = crc32c_update (0xffffffff, words[0], 4);
+  for (guint row = 1; row < n_rows; row++)
+    crc = crc32c_update (crc, words[row], 8);
+  return ~crc;
+}
+
+guint
+gst_timecode_dense_rows (guint64 word1)
+{
+  return gst_timecode_dense_n_rows (word1 >> 59);
+}
+
+guint
+gst_timecode_dense_pack (const GsttimecodeDense *message,
+    guint64 words[GST_TIMECODE_DENSE_ROWS])
+{
+  guint fields = message->fields & MASK (GST_TIMECODE_N_FIELDS);
+  guint n_rows = 2;
+
+  words[1] = (guint64) fields << 59 |
+      (guint64) (message->interval_log2 & MASK (3)) << 56 |
+      (message->frame_nr & MASK (GST_TIMECODE_DENSE_FRAME_NR_BITS)) << 32 |
+      (message->time_s & MASK (GST_TIMECODE_DENSE_TIME_S_BITS));
+  for (guint i = 0; i < GST_TIMECODE_N_FIELDS; i++)
+    if (fields & (1 << i))
+      words[n_rows++] = message->values[i];
+
+  words[0] = (message->sec_offset & MASK (32)) << 32;
+  words[0] |= compute_crc (words, n_rows);
+  return n_rows;
+}
+
+gboolean
+gst_timecode_dense_unpack (const guint64 *words, GsttimecodeDense *message)
+{
+  guint n_rows = gst_timecode_dense_rows (words[1]);
+
+  if ((words[0] & MASK (32)) != compute_crc (words, n_rows))
+    return FALSE;
+
+  memset (message, 0, sizeof *message);
+  message->sec_offset = words[0] >> 32;
+  message->fields = (words[1] >> 59) & MASK (GST_TIMECODE_N_FIELDS);
+  message->interval_log2 = (words[1] >> 56) & MASK (3);
+  message->frame_nr = (words[1] >> 32) & MASK (GST_TIMECODE_DENSE_FRAME_NR_BITS);
+  message->time_s = words[1] & MASK (GST_TIMECODE_DENSE_TIME_S_BITS);
+  for (guint i = 0, row = 2; i < GST_TIMECODE_N_FIELDS; i++)
+    if (message->fields & (1 << i))
+      message->values[i] = words[row++];
+  return TRUE;
+}
+
+guint64
+gst_timecode_dense_unwrap (guint64 low, guint bits, guint64 reference)
+{
+  guint64 period = G_GUINT64_CONSTANT (1) << bits;
+  guint64 value = (reference & ~MASK (bits)) | (low & MASK (bits));
+
+  if (value > reference && value - reference > period / 2 && value >= period)
+    value -= period;
+  else if (value < reference && reference - value > period / 2)
+    value += period;
+  return value;
+}
@@ -0,0 +1,72 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODE_DENSE_H__
+#define __GST_TIMECODE_DENSE_H__
+
+#include <glib.h>
+
+#include "gsttimecodelayout.h"
+
+G_BEGIN_DECLS
+
+/* The words of a dense code block, most significant bit first:
+ *
+ *   row 0       sec_offset (32) | CRC-32C (32)
+ *   row 1       fields (5) | interval (3) | frame_nr (24) | time_s (32)
+ *   row 2...    the enabled fields in GsttimecodeFields order, 64 bits each
+ *
+ * sec_offset loses only bits that are 0 until 2106. frame_nr and time_s are
+ * cut to their low bits and unwrapped by the receiver: frame_nr against the
+ * previous frame, time_s against its own clock, which must be within about
+ * 35 minutes of the sender's. interval is log2 of the frames until the
+ * next stamped one. The CRC covers everything but itself. */
+#define GST_TIMECODE_DENSE_FRAME_NR_BITS 24
+#define GST_TIMECODE_DENSE_TIME_S_BITS 32
+
+typedef struct {
+  guint fields;
+  guint interval_log2;
+  guint64 sec_offset;
+  guint64 time_s;
+  guint64 frame_nr;
+  /* Indexed by field bit, only the enabled ones are encoded */
+  guint64 values[GST_TIMECODE_N_FIELDS];
+} GsttimecodeDense;
+
+/* Fills words with the rows of message. Returns the number of rows. */
+guint gst_timecode_dense_pack (const GsttimecodeDense * message,
+    guint64 words[GST_TIMECODE_DENSE_ROWS]);
+
+/* Number of rows announced by row 1 */
+guint gst_timecode_dense_rows (guint64 word1);
+
+/* Checks the CRC of the rows in words and decodes them. frame_nr and time_s
+ * are left cut, see gst_timecode_dense_unwrap(). */
+gboolean gst_timecode_dense_unpack (const guint64 * words,
+    GsttimecodeDense * message);
+
+/* The value whose low bits are low that is closest to reference */
+guint64 gst_timecode_dense_unwrap (guint64 low, guint bits, guint64 reference);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_DENSE_H__ */
@@ -0,0 +1,126 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsttimecodefeedback.h"
+
+GstEvent *
+gst_timecode_feedback_event_new (const GsttimecodeFeedback *feedback)
+{
+  return gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+      gst_structure_new (GST_TIMECODE_FEEDBACK_EVENT_NAME,
+          "latency", G_TYPE_INT64, feedback->latency,
+          "loss", G_TYPE_DOUBLE, feedback->loss,
+          "frame-nr", G_TYPE_UINT64, feedback->frame_nr,
+          NULL));
+}
+
+gboolean
+gst_timecode_feedback_event_parse (GstEvent *event,
+    GsttimecodeFeedback *feedback)
+{
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM)
+    return FALSE;
+
+  const GstStructure *s = gst_event_get_structure (event);
+  if (!s || !gst_structure_has_name (s, GST_TIMECODE_FEEDBACK_EVENT_NAME))
+    return FALSE;
+
+  return gst_structure_get (s,
+      "latency", G_TYPE_INT64, &feedback->latency,
+      "loss", G_TYPE_DOUBLE, &feedback->loss,
+      "frame-nr", G_TYPE_UINT64, &feedback->frame_nr,
+      NULL);
+}
+
+typedef struct {
+  GsttimecodeFeedback feedback;
+  guint64 seqnum;
+} Channel;
+
+typedef struct {
+  GMutex lock;
+  GHashTable *channels;
+} Registry;
+
+static Registry *
+get_registry (void)
+{
+  static gsize registry = 0;
+
+  if (g_once_init_enter (&registry)) {
+    /* Both plugins carry a copy of this file but must see the same channels,
+     * so the registry hangs off a type that both copies find by name */
+    GQuark quark = g_quark_from_static_string ("gst-timecode-feedback-registry");
+    GType type = g_type_from_name ("GsttimecodeFeedbackRegistry");
+    if (!type)
+      type = g_pointer_type_register_static ("GsttimecodeFeedbackRegistry");
+
+    Registry *r = g_type_get_qdata (type, quark);
+    if (!r) {
+      r = g_new0 (Registry, 1);
+      g_mutex_init (&r->lock);
+      r->channels = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+          g_free);
+      g_type_set_qdata (type, quark, r);
+    }
+    g_once_init_leave (&registry, (gsize) r);
+  }
+  return (Registry *) registry;
+}
+
+void
+gst_timecode_feedback_publish (const gchar *channel,
+    const GsttimecodeFeedback *feedback)
+{
+  Registry *registry = get_registry ();
+
+  g_mutex_lock (&registry->lock);
+  Channel *c = g_hash_table_lookup (registry->channels, channel);
+  if (!c) {
+    c = g_new0 (Channel, 1);
+    g_hash_table_insert (registry->channels, g_strdup (channel), c);
+  }
+  c->feedback = *feedback;
+  c->seqnum++;
+  g_mutex_unlock (&registry->lock);
+}
+
+gboolean
+gst_timecode_feedback_poll (const gchar *channel, guint64 *seqnum,
+    GsttimecodeFeedback *feedback)
+{
+  Registry *registry = get_registry ();
+  gboolean updated = FALSE;
+
+  g_mutex_lock (&registry->lock);
+  Channel *c = g_hash_table_lookup (registry->channels, channel);
+  if (c && c->seqnum != *seqnum) {
+    *feedback = c->feedback;
+    *seqnum = c->seqnum;
+    updated = TRUE;
+  }
+  g_mutex_unlock (&registry->lock);
+  return updated;
+}
@@ -0,0 +1,54 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODE_FEEDBACK_H__
+#define __GST_TIMECODE_FEEDBACK_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* What timecodeparse reports back to timecodeoverlay */
+typedef struct {
+  gint64 latency;               /* smoothed latency in µs */
+  gdouble loss;                 /* smoothed fraction of frames lost */
+  guint64 frame_nr;             /* last frame the estimate includes */
+} GsttimecodeFeedback;
+
+/* Name of the structure of the custom upstream event */
+#define GST_TIMECODE_FEEDBACK_EVENT_NAME "timecode-feedback"
+
+GstEvent *gst_timecode_feedback_event_new (const GsttimecodeFeedback * feedback);
+gboolean gst_timecode_feedback_event_parse (GstEvent * event,
+    GsttimecodeFeedback * feedback);
+
+/* Named channels carry the feedback between elements of the same process
+ * that do not share a pipeline, e.g. when the video goes through
+ * udpsink/udpsrc. publish replaces the channel's value, poll returns TRUE
+ * and the value if it changed since *seqnum. */
+void gst_timecode_feedback_publish (const gchar * channel,
+    const GsttimecodeFeedback * feedback);
+gboolean gst_timecode_feedback_poll (const gchar * channel, guint64 * seqnum,
+    GsttimecodeFeedback * feedback);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_FEEDBACK_H__ */
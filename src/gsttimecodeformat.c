@@ -0,0 +1,170 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecodeformat.h"
+
+/* The fill kernels, one per pixel size */
+static void
+fill_8 (guint8 *dest, const guint8 *pixel, guint n_pixels)
+{
+  memset (dest, pixel[0], n_pixels);
+}
+
+static void
+fill_16 (guint8 *dest, const guint8 *pixel, guint n_pixels)
+{
+  guint16 v;
+  memcpy (&v, pixel, sizeof v);
+  for (guint i = 0; i < n_pixels; i++)
+    memcpy (dest + i * sizeof v, &v, sizeof v);
+}
+
+static void
+fill_32 (guint8 *dest, const guint8 *pixel, guint n_pixels)
+{
+  guint32 v;
+  memcpy (&v, pixel, sizeof v);
+  for (guint i = 0; i < n_pixels; i++)
+    memcpy (dest + i * sizeof v, &v, sizeof v);
+}
+
+static gboolean
+init_plane (GsttimecodePlane *plane, const GstVideoFormatInfo *finfo,
+    guint index)
+{
+  plane->plane = index;
+  plane->pixel_size = 0;
+  for (guint c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); c++) {
+    if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, c) != index)
+      continue;
+    plane->pixel_size = GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, c);
+    plane->w_sub = GST_VIDEO_FORMAT_INFO_W_SUB (finfo, c);
+    plane->h_sub = GST_VIDEO_FORMAT_INFO_H_SUB (finfo, c);
+    break;
+  }
+
+  switch (plane->pixel_size) {
+    case 1:
+      plane->fill = fill_8;
+      return TRUE;
+    case 2:
+      plane->fill = fill_16;
+      return TRUE;
+    case 4:
+      plane->fill = fill_32;
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/* Stores value, given for an 8-bit component, into the bytes of component c
+ * within one pixel of its plane. 255 maps to the maximum of deeper
+ * components so that white stays white. */
+static void
+put_sample (guint8 *pixel, const GsttimecodePlane *plane,
+    const GstVideoFormatInfo *finfo, guint c, guint8 value)
+{
+  guint depth = GST_VIDEO_FORMAT_INFO_DEPTH (finfo, c);
+  guint offset = GST_VIDEO_FORMAT_INFO_POFFSET (finfo, c) % plane->pixel_size;
+
+  if (depth == 8) {
+    pixel[offset] = value;
+  } else {
+    guint v = value == 255 ? (1u << depth) - 1 : (guint) value << (depth - 8);
+    v <<= GST_VIDEO_FORMAT_INFO_SHIFT (finfo, c);
+    pixel[offset] = v & 0xff;
+    pixel[offset + 1] = v >> 8;
+  }
+}
+
+static void
+init_component (GsttimecodeComponent *comp, const GstVideoFormatInfo *finfo,
+    guint c)
+{
+  comp->plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, c);
+  comp->pstride = GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, c);
+  comp->poffset = GST_VIDEO_FORMAT_INFO_POFFSET (finfo, c);
+  comp->w_sub = GST_VIDEO_FORMAT_INFO_W_SUB (finfo, c);
+  comp->h_sub = GST_VIDEO_FORMAT_INFO_H_SUB (finfo, c);
+  comp->depth = GST_VIDEO_FORMAT_INFO_DEPTH (finfo, c);
+  comp->shift = GST_VIDEO_FORMAT_INFO_SHIFT (finfo, c);
+}
+
+/* Derives the drawing and reading parameters from the format description.
+ * Returns FALSE for formats whose pixels are not 1, 2 or 4 bytes or whose
+ * components are wider than 16 bits. */
+gboolean
+gst_timecode_format_init (GsttimecodeFormat *format, const GstVideoInfo *info)
+{
+  const GstVideoFormatInfo *finfo = info->finfo;
+  gboolean rgb = GST_VIDEO_FORMAT_INFO_IS_RGB (finfo);
+
+  memset (format, 0, sizeof *format);
+  format->format = GST_VIDEO_INFO_FORMAT (info);
+
+  for (guint c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); c++) {
+    guint depth = GST_VIDEO_FORMAT_INFO_DEPTH (finfo, c);
+    if (depth < 8 || depth > 16 || (depth > 8 && GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, c) < 2))
+      return FALSE;
+  }
+
+  if (!init_plane (&format->code, finfo, GST_VIDEO_FORMAT_INFO_PLANE (finfo, 0)))
+    return FALSE;
+
+  for (guint p = 0; p < GST_VIDEO_INFO_N_PLANES (info); p++) {
+    if (p == format->code.plane)
+      continue;
+    if (!init_plane (&format->neutral[format->n_neutral], finfo, p))
+      return FALSE;
+    format->n_neutral++;
+  }
+
+  for (guint c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); c++) {
+    guint p = GST_VIDEO_FORMAT_INFO_PLANE (finfo, c);
+    gboolean neutral = !rgb && c > 0;
+
+    if (p == format->code.plane) {
+      for (guint l = 0; l < GST_TIMECODE_LEVELS; l++)
+        put_sample (format->levels[l], &format->code, finfo, c,
+            neutral ? 128 : l * 255 / (GST_TIMECODE_LEVELS - 1));
+      continue;
+    }
+    for (guint n = 0; n < format->n_neutral; n++)
+      if (format->neutral[n].plane == p)
+        put_sample (format->neutral_pixel[n], &format->neutral[n], finfo, c, 128);
+  }
+
+  init_component (&format->luma, finfo, rgb ? GST_VIDEO_COMP_G : GST_VIDEO_COMP_Y);
+  if (GST_VIDEO_FORMAT_INFO_IS_YUV (finfo)) {
+    init_component (&format->chroma[0], finfo, GST_VIDEO_COMP_U);
+    init_component (&format->chroma[1], finfo, GST_VIDEO_COMP_V);
+    format->n_chroma = 2;
+  }
+
+  return TRUE;
+}
@@ -0,0 +1,102 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODE_FORMAT_H__
+#define __GST_TIMECODE_FORMAT_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+/* The raw formats both elements handle without conversion */
+#define GST_TIMECODE_VIDEO_CAPS GST_VIDEO_CAPS_MAKE ( \
+    "{ I420, YV12, NV12, YUY2, UYVY, RGBx, BGRx, GRAY8, P010_10LE, I420_10LE }")
+
+/* Where the samples of one component lie in a frame, as in GstVideoFormatInfo */
+typedef struct {
+  guint plane;
+  guint pstride;                /* bytes from one sample to the next */
+  guint poffset;                /* byte offset of the first sample */
+  guint w_sub;                  /* log2 horizontal subsampling */
+  guint h_sub;                  /* log2 vertical subsampling */
+  guint depth;                  /* 8: one byte, more: 16-bit little-endian */
+  guint shift;
+} GsttimecodeComponent;
+
+/* Fills n_pixels pixels of pixel_size bytes with copies of pixel */
+typedef void (*GsttimecodeFillFunc) (guint8 * dest, const guint8 * pixel,
+    guint n_pixels);
+
+/* A plane the code block covers */
+typedef struct {
+  guint plane;
+  guint pixel_size;             /* bytes per pixel in this plane */
+  guint w_sub;
+  guint h_sub;
+  GsttimecodeFillFunc fill;
+} GsttimecodePlane;
+
+/* Grey levels of a cell, level i is i * 255 / 3. The binary encoding only
+ * uses black and white, the dense one all four. */
+#define GST_TIMECODE_LEVELS 4
+
+/* Everything the elements need to know about the negotiated format, set up
+ * once per negotiation so that drawing and reading do not look at the format
+ * per pixel. The code is drawn into the plane of the first component (luma or
+ * R) in grey levels, all other planes are set to neutral chroma under the
+ * code block. */
+typedef struct {
+  GstVideoFormat format;
+
+  GsttimecodePlane code;
+  guint8 levels[GST_TIMECODE_LEVELS][4];
+
+  guint n_neutral;
+  GsttimecodePlane neutral[GST_VIDEO_MAX_PLANES - 1];
+  guint8 neutral_pixel[GST_VIDEO_MAX_PLANES - 1][4];
+
+  /* Sampled to decode the code: luma, or G for RGB */
+  GsttimecodeComponent luma;
+  /* Checked to be neutral, none for RGB and GRAY formats */
+  guint n_chroma;
+  GsttimecodeComponent chroma[2];
+} GsttimecodeFormat;
+
+gboolean gst_timecode_format_init (GsttimecodeFormat * format,
+    const GstVideoInfo * info);
+
+/* Reads the sample of comp at pixel (x, y), scaled to 8 bits */
+static inline guint
+gst_timecode_component_read (const GsttimecodeComponent * comp,
+    const guint8 * plane, gint stride, guint x, guint y)
+{
+  const guint8 *p = plane + (gsize) (y >> comp->h_sub) * stride +
+      (x >> comp->w_sub) * comp->pstride + comp->poffset;
+
+  if (comp->depth == 8)
+    return p[0];
+  return ((p[0] | (p[1] << 8)) >> comp->shift) >> (comp->depth - 8);
+}
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_FORMAT_H__ */
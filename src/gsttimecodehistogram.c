@@ -0,0 +1,102 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecodehistogram.h"
+
+#define SUB_COUNT (1 << GST_TIMECODEHISTOGRAM_SUB_BITS)
+#define HALF_COUNT (SUB_COUNT / 2)
+
+static guint
+bucket_index (guint64 value)
+{
+  if (value < SUB_COUNT)
+    return value;
+
+  /* Shift value into [HALF_COUNT, SUB_COUNT) */
+  guint shift = 63 - __builtin_clzll (value) - (GST_TIMECODEHISTOGRAM_SUB_BITS - 1);
+  guint index = SUB_COUNT + (shift - 1) * HALF_COUNT + (value >> shift) - HALF_COUNT;
+  return MIN (index, GST_TIMECODEHISTOGRAM_BUCKETS - 1);
+}
+
+/* Largest value that lands in bucket index */
+static guint64
+bucket_highest (guint index)
+{
+  if (index < SUB_COUNT)
+    return index;
+
+  guint shift = (index - SUB_COUNT) / HALF_COUNT + 1;
+  guint64 sub = (index - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+  return ((sub + 1) << shift) - 1;
+}
+
+void
+gst_timecodehistogram_reset (Gsttimecodehistogram *hist)
+{
+  memset (hist, 0, sizeof *hist);
+  hist->min = G_MAXUINT64;
+}
+
+void
+gst_timecodehistogram_record (Gsttimecodehistogram *hist, guint64 value)
+{
+  hist->counts[bucket_index (value)]++;
+  hist->total++;
+  hist->sum += value;
+  hist->min = MIN (hist->min, value);
+  hist->max = MAX (hist->max, value);
+}
+
+gdouble
+gst_timecodehistogram_mean (const Gsttimecodehistogram *hist)
+{
+  if (hist->total == 0)
+    return 0;
+  return (gdouble) hist->sum / hist->total;
+}
+
+guint64
+gst_timecodehistogram_percentile (const Gsttimecodehistogram *hist,
+    gdouble percentile)
+{
+  if (hist->total == 0)
+    return 0;
+
+  gdouble exact = CLAMP (percentile, 0, 100) / 100 * hist->total;
+  guint64 rank = MAX ((guint64) exact, 1);
+  if (rank < exact)
+    rank++;
+
+  guint64 seen = 0;
+  for (guint i = 0; i < GST_TIMECODEHISTOGRAM_BUCKETS; i++) {
+    seen += hist->counts[i];
+    if (seen >= rank)
+      return i == GST_TIMECODEHISTOGRAM_BUCKETS - 1 ? hist->max :
+          MIN (bucket_highest (i), hist->max);
+  }
+  return hist->max;
+}
@@ -0,0 +1,64 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODEHISTOGRAM_H__
+#define __GST_TIMECODEHISTOGRAM_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Log-bucketed histogram in the style of HdrHistogram. Values below
+ * 2^SUB_BITS get a bucket each; above, every power of two is split into
+ * 2^(SUB_BITS-1) buckets, so any value is reported within 1/64 (1.6%) of its
+ * true value. Values up to 2^MAX_BITS are tracked, larger ones are counted
+ * in the last bucket. Memory use is fixed. */
+#define GST_TIMECODEHISTOGRAM_SUB_BITS 7
+#define GST_TIMECODEHISTOGRAM_MAX_BITS 40
+#define GST_TIMECODEHISTOGRAM_BUCKETS \
+    ((1 << GST_TIMECODEHISTOGRAM_SUB_BITS) + \
+     (GST_TIMECODEHISTOGRAM_MAX_BITS - GST_TIMECODEHISTOGRAM_SUB_BITS) * \
+     (1 << (GST_TIMECODEHISTOGRAM_SUB_BITS - 1)))
+
+typedef struct {
+  guint64 counts[GST_TIMECODEHISTOGRAM_BUCKETS];
+  guint64 total;
+  guint64 min;
+  guint64 max;
+  guint64 sum;
+} Gsttimecodehistogram;
+
+void gst_timecodehistogram_reset (Gsttimecodehistogram * hist);
+
+/* O(1) */
+void gst_timecodehistogram_record (Gsttimecodehistogram * hist,
+    guint64 value);
+
+gdouble gst_timecodehistogram_mean (const Gsttimecodehistogram * hist);
+
+/* The largest value that shares a bucket with the value at percentile
+ * (0-100), or 0 if nothing was recorded. Walks all buckets. */
+guint64 gst_timecodehistogram_percentile (const Gsttimecodehistogram * hist,
+    gdouble percentile);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODEHISTOGRAM_H__ */
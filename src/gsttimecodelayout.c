@@ -0,0 +1,191 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsttimecodelayout.h"
+
+/* Cells smaller than this cannot be told apart after compression */
+#define MIN_CELL_SIZE 4
+
+GType
+gst_timecode_anchor_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIMECODE_ANCHOR_TOP_LEFT, "Top left corner", "top-left"},
+    {GST_TIMECODE_ANCHOR_TOP_RIGHT, "Top right corner", "top-right"},
+    {GST_TIMECODE_ANCHOR_BOTTOM_LEFT, "Bottom left corner", "bottom-left"},
+    {GST_TIMECODE_ANCHOR_BOTTOM_RIGHT, "Bottom right corner", "bottom-right"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    /* Both plugins carry a copy of this file, only register the type once */
+    GType t = g_type_from_name ("GsttimecodeAnchor");
+    if (!t)
+      t = g_enum_register_static ("GsttimecodeAnchor", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+GType
+gst_timecode_encoding_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIMECODE_ENCODING_BINARY, "One black or white cell per bit", "binary"},
+    {GST_TIMECODE_ENCODING_DENSE, "Two bits per grey cell with a CRC", "dense"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodeEncoding");
+    if (!t)
+      t = g_enum_register_static ("GsttimecodeEncoding", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+GType
+gst_timecode_fields_get_type (void)
+{
+  static gsize type = 0;
+  static const GFlagsValue values[] = {
+    {GST_TIMECODE_FIELD_BUFFER_TIME, "Buffer timestamp", "buffer-time"},
+    {GST_TIMECODE_FIELD_STREAM_TIME, "Stream time", "stream-time"},
+    {GST_TIMECODE_FIELD_RUNNING_TIME, "Running time", "running-time"},
+    {GST_TIMECODE_FIELD_CLOCK_TIME, "Clock time", "clock-time"},
+    {GST_TIMECODE_FIELD_RENDER_TIME, "Render time", "render-time"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodeFields");
+    if (!t)
+      t = g_flags_register_static ("GsttimecodeFields", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+/* Rounds a cell size in 16.16 fixed point to whole pixels that tile the
+ * codec blocks: a power of two below align, a multiple of align above */
+static guint64
+snap_cell (guint64 cell, guint align)
+{
+  guint px = MAX ((cell + 0x8000) >> 16, 1);
+
+  if (px >= align) {
+    px = (px + align / 2) / align * align;
+  } else {
+    guint lo = 1u << (g_bit_storage (px) - 1);
+    px = px - lo < 2 * lo - px ? lo : 2 * lo;
+  }
+  return (guint64) px << 16;
+}
+
+/* Computes where code block hop lies in a width x height frame. Cell sizes
+ * are kept in 16.16 fixed point so that a scaled layout does not accumulate
+ * rounding errors across the cells of a word. With an alignment the cells
+ * are whole pixels and the block starts on a codec block boundary, so the
+ * cell edges coincide with block edges, which keeps the encoder from
+ * spending bits on edges running through its blocks. Returns FALSE if the
+ * block does not fit into the frame or its cells would be too small. */
+gboolean
+gst_timecode_layout_compute (GsttimecodeLayout *layout,
+    const GsttimecodeGeometry *geometry, guint hop, gint width, gint height)
+{
+  guint64 cell_w, cell_h;
+  guint64 margin_x, margin_y;
+  /* Distance between hop blocks and start granularity, at least a chroma
+   * sample of subsampled formats */
+  guint align = 2;
+
+  if (width <= 0 || height <= 0)
+    return FALSE;
+
+  layout->encoding = geometry->encoding;
+  layout->fields = geometry->fields;
+  if (geometry->encoding == GST_TIMECODE_ENCODING_DENSE) {
+    layout->cells = GST_TIMECODE_DENSE_CELLS;
+    layout->rows = gst_timecode_dense_n_rows (geometry->fields);
+  } else {
+    layout->cells = GST_TIMECODE_WORD_BITS;
+    layout->rows = GST_TIMECODE_ROWS;
+  }
+  layout->bits_per_cell = GST_TIMECODE_WORD_BITS / layout->cells;
+
+  if (geometry->cell_size == 0) {
+    cell_w = ((guint64) GST_TIMECODE_REFERENCE_CELL_SIZE << 16) * width /
+        GST_TIMECODE_REFERENCE_WIDTH;
+    cell_h = ((guint64) GST_TIMECODE_REFERENCE_CELL_SIZE << 16) * height /
+        GST_TIMECODE_REFERENCE_HEIGHT;
+    margin_x = (guint64) geometry->margin_x * width / GST_TIMECODE_REFERENCE_WIDTH;
+    margin_y = (guint64) geometry->margin_y * height / GST_TIMECODE_REFERENCE_HEIGHT;
+  } else {
+    cell_w = cell_h = (guint64) geometry->cell_size << 16;
+    margin_x = geometry->margin_x;
+    margin_y = geometry->margin_y;
+  }
+
+  if (geometry->align > 2) {
+    align = 1u << (g_bit_storage (MIN (geometry->align, GST_TIMECODE_MAX_ALIGN)) - 1);
+    cell_w = snap_cell (cell_w, align);
+    cell_h = snap_cell (cell_h, align);
+  }
+
+  if (cell_w < (MIN_CELL_SIZE << 16) || cell_h < (MIN_CELL_SIZE << 16))
+    return FALSE;
+
+  guint64 block_w = (cell_w * layout->cells + 0x8000) >> 16;
+  guint64 block_h = (cell_h * layout->rows + 0x8000) >> 16;
+  /* A distance between the blocks that is a multiple of align keeps them
+   * apart after rounding the start to it */
+  margin_y += hop * ((block_h + align - 1) & ~(guint64) (align - 1));
+  if (margin_x + block_w > (guint64) width || margin_y + block_h > (guint64) height)
+    return FALSE;
+
+  gboolean right = geometry->anchor == GST_TIMECODE_ANCHOR_TOP_RIGHT ||
+      geometry->anchor == GST_TIMECODE_ANCHOR_BOTTOM_RIGHT;
+  gboolean bottom = geometry->anchor == GST_TIMECODE_ANCHOR_BOTTOM_LEFT ||
+      geometry->anchor == GST_TIMECODE_ANCHOR_BOTTOM_RIGHT;
+  guint x0 = right ? width - margin_x - block_w : margin_x;
+  guint y0 = bottom ? height - margin_y - block_h : margin_y;
+  /* With align set the start is rounded away from the edge the margin is
+   * measured from, so the block keeps at least its margin. The even start
+   * of the default is rounded down as ever, so recordings read the same. */
+  guint up = geometry->align > 2 ? align - 1 : 0;
+  x0 = right ? x0 & ~(align - 1) : (x0 + up) & ~(align - 1);
+  y0 = bottom ? y0 & ~(align - 1) : (y0 + up) & ~(align - 1);
+  if (x0 + block_w > (guint64) width || y0 + block_h > (guint64) height)
+    return FALSE;
+
+  for (guint i = 0; i <= layout->cells; i++)
+    layout->x[i] = x0 + ((cell_w * i + 0x8000) >> 16);
+  for (guint r = 0; r <= layout->rows; r++)
+    layout->y[r] = y0 + ((cell_h * r + 0x8000) >> 16);
+
+  return TRUE;
+}
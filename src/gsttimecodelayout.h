@@ -0,0 +1,156 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_TIMECODE_LAYOUT_H__
+#define __GST_TIMECODE_LAYOUT_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TIMECODE_WORD_BITS 64
+/* Word rows in the code block. Rows 0-4 are reserved for the optional timing
+ * fields, 5-7 hold sec_offset, time_s and frame_nr. */
+#define GST_TIMECODE_ROWS 8
+
+/* How the words are drawn. binary spends one black or white cell per bit.
+ * dense spends one of four grey levels per two bits, packs sec_offset,
+ * time_s and frame_nr into two rows and protects them with a CRC, see
+ * gsttimecodedense.h. */
+typedef enum {
+  GST_TIMECODE_ENCODING_BINARY,
+  GST_TIMECODE_ENCODING_DENSE,
+} GsttimecodeEncoding;
+
+#define GST_TYPE_TIMECODE_ENCODING (gst_timecode_encoding_get_type())
+GType gst_timecode_encoding_get_type (void);
+
+/* The optional timing fields. Enabled fields take the rows directly above
+ * sec_offset in this order, disabled ones take no rows. buffer, stream and
+ * running time are in ns (GST_CLOCK_TIME_NONE if unknown). clock and render
+ * time are converted to µs since sec_offset like time_s (0 if unknown), so
+ * that they can be compared with the wall clock of the receiver. */
+typedef enum {
+  GST_TIMECODE_FIELD_BUFFER_TIME = (1 << 0),
+  GST_TIMECODE_FIELD_STREAM_TIME = (1 << 1),
+  GST_TIMECODE_FIELD_RUNNING_TIME = (1 << 2),
+  GST_TIMECODE_FIELD_CLOCK_TIME = (1 << 3),
+  GST_TIMECODE_FIELD_RENDER_TIME = (1 << 4),
+} GsttimecodeFields;
+
+#define GST_TIMECODE_N_FIELDS 5
+
+/* Cells per word and the most rows of a dense block: two base rows followed
+ * by one row per enabled field */
+#define GST_TIMECODE_DENSE_CELLS 32
+#define GST_TIMECODE_DENSE_ROWS (2 + GST_TIMECODE_N_FIELDS)
+
+#define GST_TYPE_TIMECODE_FIELDS (gst_timecode_fields_get_type())
+GType gst_timecode_fields_get_type (void);
+
+/* The top byte of the sec_offset word carries the enabled fields, so
+ * timecodeparse finds their rows without being configured */
+#define GST_TIMECODE_FIELDS_SHIFT 56
+#define GST_TIMECODE_SEC_OFFSET_MASK \
+    ((G_GUINT64_CONSTANT (1) << GST_TIMECODE_FIELDS_SHIFT) - 1)
+
+/* Its top three bits carry log2 of the frames until the next stamped one,
+ * see GsttimecodeSampler */
+#define GST_TIMECODE_INTERVAL_SHIFT 61
+
+/* Rows of a dense block carrying fields */
+static inline guint
+gst_timecode_dense_n_rows (guint fields)
+{
+  return 2 + __builtin_popcount (fields & ((1 << GST_TIMECODE_N_FIELDS) - 1));
+}
+
+/* Row of field, which must be one of the enabled fields */
+static inline guint
+gst_timecode_field_row (guint fields, guint field)
+{
+  return GST_TIMECODE_N_FIELDS - __builtin_popcount (fields) +
+      __builtin_popcount (fields & (field - 1));
+}
+
+/* In auto mode (cell-size=0) the layout is defined for a frame of this size
+ * and scaled to the actual frame, so it survives scaling between overlay and
+ * parse. */
+#define GST_TIMECODE_REFERENCE_WIDTH 1920
+#define GST_TIMECODE_REFERENCE_HEIGHT 1080
+#define GST_TIMECODE_REFERENCE_CELL_SIZE 16
+
+#define GST_TIMECODE_DEFAULT_MARGIN_X 512
+#define GST_TIMECODE_DEFAULT_MARGIN_Y 56
+
+/* Largest codec block the code can be aligned to, e.g. 16 for H.264
+ * macroblocks and 64 for HEVC and AV1 */
+#define GST_TIMECODE_MAX_ALIGN 128
+
+/* Corner of the frame the margins are measured from */
+typedef enum {
+  GST_TIMECODE_ANCHOR_TOP_LEFT,
+  GST_TIMECODE_ANCHOR_TOP_RIGHT,
+  GST_TIMECODE_ANCHOR_BOTTOM_LEFT,
+  GST_TIMECODE_ANCHOR_BOTTOM_RIGHT,
+} GsttimecodeAnchor;
+
+#define GST_TYPE_TIMECODE_ANCHOR (gst_timecode_anchor_get_type())
+GType gst_timecode_anchor_get_type (void);
+
+/* The geometry properties shared by timecodeoverlay and timecodeparse */
+typedef struct {
+  GsttimecodeAnchor anchor;
+  guint margin_x;
+  guint margin_y;
+  guint cell_size;              /* 0: scale the reference layout */
+  GsttimecodeEncoding encoding;
+  guint align;                  /* codec block size to snap to, 0: none */
+  guint fields;                 /* GsttimecodeFields, one dense row each */
+} GsttimecodeGeometry;
+
+/* Number of code blocks a chain of timecodeoverlay elements can stamp into
+ * one frame. Block hop is stacked hop blocks away from the anchor corner, so
+ * each overlay writes its own block without clobbering the others. */
+#define GST_TIMECODE_MAX_HOPS 4
+
+#define GST_TIMECODE_GEOMETRY_INIT { GST_TIMECODE_ANCHOR_TOP_LEFT, \
+    GST_TIMECODE_DEFAULT_MARGIN_X, GST_TIMECODE_DEFAULT_MARGIN_Y, 0, \
+    GST_TIMECODE_ENCODING_BINARY, 0, 0 }
+
+/* Pixel boundaries of the code block in one frame. Cell i of word row r
+ * covers columns [x[i], x[i+1]) and rows [y[r], y[r+1]), for i < cells and
+ * r < rows. Scaled cells may differ in size by one pixel. */
+typedef struct {
+  GsttimecodeEncoding encoding;
+  guint cells;                  /* cells per word */
+  guint bits_per_cell;
+  guint rows;
+  guint fields;                 /* the dense block has rows for */
+  guint x[GST_TIMECODE_WORD_BITS + 1];
+  guint y[GST_TIMECODE_ROWS + 1];
+} GsttimecodeLayout;
+
+gboolean gst_timecode_layout_compute (GsttimecodeLayout * layout,
+    const GsttimecodeGeometry * geometry, guint hop, gint width, gint height);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_LAYOUT_H__ */
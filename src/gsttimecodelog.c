@@ -0,0 +1,1179 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Background writer for the per-frame logs of timecodeoverlay and
+ * timecodeparse.
+ *
+ * The streaming thread only copies a fixed-size record into a single-producer
+ * single-consumer ring. One writer thread per process serves the rings of
+ * all elements: it owns the log files and does all formatting and file I/O,
+ * so a slow disk does not show up as jitter in the pipeline that is being
+ * measured. Producers never contend with each other, each has a ring of its
+ * own.
+ *
+ * Elements whose location is the same path share one file. Every line or
+ * record is tagged with the stream it belongs to, the stream-id of the
+ * element or else its name. Files are written through a large buffer and
+ * flushed a few times a second, so many streams still mean few writes.
+ *
+ * Files can be compressed as they are written and split into segments by
+ * size or duration. Each segment starts with its own header and stream
+ * announcements and is cut before a hop 0 record, so it can be read on its
+ * own and a frame never spans two segments.
+ *
+ * Optionally the producer also publishes each record live into a
+ * shared-memory ring for external monitors, see gsttimecodeshm.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "gsttimecodelog.h"
+#include "gsttimecodebinlog.h"
+#include "gsttimecodeshm.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_timecodelog_debug);
+#define GST_CAT_DEFAULT gst_timecodelog_debug
+
+/* How long the writer sleeps when all rings are empty */
+#define GST_TIMECODELOG_POLL_INTERVAL (G_USEC_PER_SEC / 200)
+/* How long a blocked producer sleeps before checking for space again */
+#define GST_TIMECODELOG_BLOCK_INTERVAL 100
+/* How often the files are flushed at most, and their buffer size */
+#define GST_TIMECODELOG_FLUSH_INTERVAL (G_USEC_PER_SEC / 10)
+#define GST_TIMECODELOG_FILE_BUFFER_SIZE (1 << 20)
+/* What the compressor hands to stdio at once */
+#define GST_TIMECODELOG_COMPRESSED_SIZE (64 * 1024)
+
+#define LOG_LINE_LEN 256
+
+G_STATIC_ASSERT ((GST_TIMECODELOG_RING_SIZE & (GST_TIMECODELOG_RING_SIZE - 1)) == 0);
+
+/* What a call to the compressor does besides taking the input */
+typedef enum {
+  GST_TIMECODELOG_COMPRESS_CONTINUE,
+  GST_TIMECODELOG_COMPRESS_FLUSH,
+  GST_TIMECODELOG_COMPRESS_END,
+} GsttimecodelogCompressMode;
+
+/* A file the logs of one or more elements write to. path is the location
+ * the logs were given, segment_path the file currently written. */
+typedef struct {
+  gchar *path;
+  gchar *segment_path;
+  guint segment;
+  FILE *file;
+  gchar *buffer;
+  guint kind;
+  const gchar *columns;
+  GsttimecodelogFormat format;
+  GsttimecodelogCompression compression;
+  /* z_stream or ZSTD_CStream, NULL without compression */
+  gpointer compressor;
+  guint8 *compressed;
+  /* Limits of a segment, 0 for none, and how far the current one got.
+   * size counts the bytes handed to stdio, after compression. */
+  guint64 max_size;
+  GstClockTime max_duration;
+  guint64 size;
+  gint64 started;
+  GstTimecodeBinlogHeader header;
+  gboolean header_pending;
+  /* Logs writing to the file, and stream indices handed out */
+  guint n_logs;
+  guint n_streams;
+  gboolean dirty;
+  /* Failed writes and flushes of the current segment, e.g. a full disk */
+  guint errors;
+} GsttimecodelogFile;
+
+/* Caps of the stream, handed from the streaming thread to the writer */
+typedef struct {
+  gint width;
+  gint height;
+  gint fps_n;
+  gint fps_d;
+} GsttimecodelogVideoInfo;
+
+struct _Gsttimecodelog {
+  GstObject *owner;
+  guint kind;
+  const gchar *columns;
+  GsttimecodelogFormatFunc format;
+
+  /* Protected by the service lock. Only taken by the writer thread and by
+   * property/caps changes, never by the producer. */
+  GsttimecodelogFile *file;
+  gchar *path;
+  GsttimecodelogFormat file_format;
+  GsttimecodelogCompression compression;
+  guint64 max_size;
+  GstClockTime max_duration;
+  /* NULL for the owner's name. stream_name is what the writer logs, looked
+   * up again after changes; announced is set once a binary file has it. */
+  gchar *stream_id;
+  gchar *stream_name;
+  guint stream;
+  gboolean announced;
+
+  /* The caps set last, taken from video_info by the writer thread before
+   * it writes. Whoever swaps the pointer out owns it, so set_info never
+   * waits for the writer's I/O. */
+  gpointer video_info;
+  GsttimecodelogVideoInfo video;
+
+  /* "YYYY-mm-dd HH:MM:SS" of ts_second, only used by the writer thread */
+  gint64 ts_second;
+  gchar ts_prefix[sizeof ("2011-10-08 07:07:09")];
+
+  gint policy;
+  /* GLib has no 64-bit atomics, so this uses the builtins they wrap */
+  guint64 dropped;
+
+  /* head is only written by the producer, tail only by the writer thread */
+  gint head;
+  gint tail;
+  GsttimecodelogRecord ring[GST_TIMECODELOG_RING_SIZE];
+
+  /* Swapped by property changes, which wait for the producer to leave
+   * publishing before freeing the old one */
+  gpointer shm;
+  gint publishing;
+};
+
+/* The writer thread of the process and what it writes. The thread runs
+ * while there are logs; it stops when its pointer is taken away. */
+typedef struct {
+  GMutex lock;
+  GList *logs;
+  GList *files;
+  GThread *thread;
+  gint64 next_flush;
+} GsttimecodelogService;
+
+static GsttimecodelogService *service;
+
+/* Swaps the pointer at p for new and returns the old one */
+static gpointer
+gst_timecodelog_exchange (gpointer *p, gpointer new)
+{
+  gpointer old;
+  do {
+    old = g_atomic_pointer_get (p);
+  } while (!g_atomic_pointer_compare_and_exchange (p, old, new));
+  return old;
+}
+
+GType
+gst_timecodelog_full_policy_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIMECODELOG_FULL_POLICY_DROP, "Drop the record and count it", "drop"},
+    {GST_TIMECODELOG_FULL_POLICY_BLOCK, "Wait for the writer to catch up", "block"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    /* Both plugins carry a copy of this file, only register the type once */
+    GType t = g_type_from_name ("GsttimecodelogFullPolicy");
+    if (!t)
+      t = g_enum_register_static ("GsttimecodelogFullPolicy", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+GType
+gst_timecodelog_format_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIMECODELOG_FORMAT_TEXT, "Tab-separated text", "text"},
+    {GST_TIMECODELOG_FORMAT_BINARY, "Fixed-size binary records", "binary"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodelogFormat");
+    if (!t)
+      t = g_enum_register_static ("GsttimecodelogFormat", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+GType
+gst_timecodelog_compression_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIMECODELOG_COMPRESSION_NONE, "Uncompressed", "none"},
+    {GST_TIMECODELOG_COMPRESSION_GZIP, "gzip", "gzip"},
+    {GST_TIMECODELOG_COMPRESSION_ZSTD, "Zstandard", "zstd"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodelogCompression");
+    if (!t)
+      t = g_enum_register_static ("GsttimecodelogCompression", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+static gboolean
+gst_timecodelog_compression_available (GsttimecodelogCompression compression)
+{
+  switch (compression) {
+    case GST_TIMECODELOG_COMPRESSION_NONE:
+      return TRUE;
+#ifdef HAVE_ZLIB
+    case GST_TIMECODELOG_COMPRESSION_GZIP:
+      return TRUE;
+#endif
+#ifdef HAVE_ZSTD
+    case GST_TIMECODELOG_COMPRESSION_ZSTD:
+      return TRUE;
+#endif
+    default:
+      return FALSE;
+  }
+}
+
+/* Counts a failed write or flush, warning on the first of a segment */
+static void
+gst_timecodelog_file_error (GsttimecodelogFile *file, const gchar *what)
+{
+  if (file->errors++ == 0)
+    GST_WARNING ("%s %s failed: %s", what, file->segment_path,
+        g_strerror (errno));
+}
+
+static void
+gst_timecodelog_fwrite (GsttimecodelogFile *file, const void *data, gsize len)
+{
+  if (fwrite (data, 1, len, file->file) != len)
+    gst_timecodelog_file_error (file, "Writing");
+}
+
+static void
+gst_timecodelog_fflush (GsttimecodelogFile *file)
+{
+  if (fflush (file->file) != 0)
+    gst_timecodelog_file_error (file, "Flushing");
+}
+
+/* Runs data through the compressor and writes out what it produces */
+static void
+gst_timecodelog_compress (GsttimecodelogFile *file, const void *data,
+    gsize len, GsttimecodelogCompressMode mode)
+{
+  switch (file->compression) {
+#ifdef HAVE_ZLIB
+    case GST_TIMECODELOG_COMPRESSION_GZIP: {
+      z_stream *z = file->compressor;
+      gint flush = mode == GST_TIMECODELOG_COMPRESS_END ? Z_FINISH :
+          mode == GST_TIMECODELOG_COMPRESS_FLUSH ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+      z->next_in = (Bytef *) data;
+      z->avail_in = len;
+      do {
+        z->next_out = file->compressed;
+        z->avail_out = GST_TIMECODELOG_COMPRESSED_SIZE;
+        if (deflate (z, flush) == Z_STREAM_ERROR) {
+          GST_ERROR ("Compressing %s failed", file->segment_path);
+          return;
+        }
+        gsize n = GST_TIMECODELOG_COMPRESSED_SIZE - z->avail_out;
+        gst_timecodelog_fwrite (file, file->compressed, n);
+        file->size += n;
+      } while (z->avail_out == 0);
+      break;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case GST_TIMECODELOG_COMPRESSION_ZSTD: {
+      ZSTD_EndDirective end = mode == GST_TIMECODELOG_COMPRESS_END ? ZSTD_e_end :
+          mode == GST_TIMECODELOG_COMPRESS_FLUSH ? ZSTD_e_flush : ZSTD_e_continue;
+      ZSTD_inBuffer in = { data, len, 0 };
+      gsize remaining;
+      do {
+        ZSTD_outBuffer out = { file->compressed, GST_TIMECODELOG_COMPRESSED_SIZE, 0 };
+        remaining = ZSTD_compressStream2 (file->compressor, &out, &in, end);
+        if (ZSTD_isError (remaining)) {
+          GST_ERROR ("Compressing %s failed: %s", file->segment_path,
+              ZSTD_getErrorName (remaining));
+          return;
+        }
+        gst_timecodelog_fwrite (file, file->compressed, out.pos);
+        file->size += out.pos;
+      } while (end == ZSTD_e_continue ? in.pos < in.size : remaining != 0);
+      break;
+    }
+#endif
+    default:
+      g_assert_not_reached ();
+  }
+}
+
+static gboolean
+gst_timecodelog_compressor_new (GsttimecodelogFile *file)
+{
+  switch (file->compression) {
+#ifdef HAVE_ZLIB
+    case GST_TIMECODELOG_COMPRESSION_GZIP: {
+      z_stream *z = g_new0 (z_stream, 1);
+      /* 16 adds the gzip wrapper, so segments can be read with zcat */
+      if (deflateInit2 (z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+              Z_DEFAULT_STRATEGY) != Z_OK) {
+        g_free (z);
+        return FALSE;
+      }
+      file->compressor = z;
+      break;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case GST_TIMECODELOG_COMPRESSION_ZSTD:
+      if (!(file->compressor = ZSTD_createCStream ()))
+        return FALSE;
+      break;
+#endif
+    default:
+      return TRUE;
+  }
+
+  if (!file->compressed)
+    file->compressed = g_malloc (GST_TIMECODELOG_COMPRESSED_SIZE);
+  return TRUE;
+}
+
+static void
+gst_timecodelog_compressor_free (GsttimecodelogFile *file)
+{
+  switch (file->compression) {
+#ifdef HAVE_ZLIB
+    case GST_TIMECODELOG_COMPRESSION_GZIP:
+      deflateEnd (file->compressor);
+      g_free (file->compressor);
+      break;
+#endif
+#ifdef HAVE_ZSTD
+    case GST_TIMECODELOG_COMPRESSION_ZSTD:
+      ZSTD_freeCStream (file->compressor);
+      break;
+#endif
+    default:
+      break;
+  }
+  file->compressor = NULL;
+}
+
+/* Nothing is written while a segment could not be opened */
+static void
+gst_timecodelog_file_write (GsttimecodelogFile *file, const void *data,
+    gsize len)
+{
+  if (!file->file)
+    return;
+
+  if (file->compressor) {
+    gst_timecodelog_compress (file, data, len, GST_TIMECODELOG_COMPRESS_CONTINUE);
+  } else {
+    gst_timecodelog_fwrite (file, data, len);
+    file->size += len;
+  }
+}
+
+/* Overwrites bytes written before, which compressed files do not allow */
+static gboolean
+gst_timecodelog_file_patch (GsttimecodelogFile *file, glong offset,
+    const void *data, gsize len)
+{
+  if (!file->file || file->compressor)
+    return FALSE;
+
+  glong end = ftell (file->file);
+  fseek (file->file, offset, SEEK_SET);
+  gst_timecodelog_fwrite (file, data, len);
+  fseek (file->file, end, SEEK_SET);
+  return TRUE;
+}
+
+/* The date and time of day only change once per second, so they are
+ * formatted once and reused for all records of that second. */
+static void
+gst_timecodelog_format_ts (Gsttimecodelog *log, gint64 realtime, gchar *buf,
+    gsize size)
+{
+  gint64 second = realtime / G_USEC_PER_SEC;
+
+  if (second != log->ts_second) {
+    time_t t = (time_t) second;
+    struct tm tm;
+    if (!gmtime_r (&t, &tm) ||
+        strftime (log->ts_prefix, sizeof (log->ts_prefix), "%Y-%m-%d %H:%M:%S", &tm) == 0) {
+      buf[0] = '\0';
+      return;
+    }
+    log->ts_second = second;
+  }
+  g_snprintf (buf, size, "%s.%06dZ", log->ts_prefix,
+      (gint) (realtime % G_USEC_PER_SEC));
+}
+
+/* The element's own columns with the stream appended */
+static void
+gst_timecodelog_write_text (Gsttimecodelog *log, GsttimecodelogFile *file,
+    const GsttimecodelogRecord *record)
+{
+  gchar ts[sizeof ("2011-10-08 07:07:09.000000Z")];
+  gchar line[LOG_LINE_LEN];
+
+  gst_timecodelog_format_ts (log, record->realtime, ts, sizeof (ts));
+  gint len = log->format (record, ts, line, sizeof (line));
+  len = CLAMP (len, 0, (gint) sizeof (line) - 1);
+  if (len > 0 && line[len - 1] == '\n')
+    line[--len] = '\0';
+  GST_LOG_OBJECT (log->owner, "%s", line);
+
+  len += g_snprintf (line + len, sizeof (line) - len, "\t%s\n", log->stream_name);
+  if (len >= (gint) sizeof (line)) {
+    /* Cut an overlong stream name, but keep the line a line */
+    len = sizeof (line) - 1;
+    line[len - 1] = '\n';
+  }
+  gst_timecodelog_file_write (file, line, len);
+}
+
+static void
+gst_timecodelog_write_binary (Gsttimecodelog *log, GsttimecodelogFile *file,
+    const GsttimecodelogRecord *record)
+{
+  GstTimecodeBinlogHeader *header = &file->header;
+  guint64 sec_offset = GUINT64_FROM_LE (header->sec_offset);
+
+  if (file->header_pending) {
+    memcpy (header->magic, GST_TIMECODE_BINLOG_MAGIC, sizeof (header->magic));
+    header->version = GUINT32_TO_LE (GST_TIMECODE_BINLOG_VERSION);
+    header->header_size = GUINT32_TO_LE (sizeof (GstTimecodeBinlogHeader));
+    header->record_size = GUINT32_TO_LE (sizeof (GstTimecodeBinlogRecord));
+    header->kind = GUINT32_TO_LE (file->kind);
+    header->width = GUINT32_TO_LE (log->video.width);
+    header->height = GUINT32_TO_LE (log->video.height);
+    header->fps_n = GINT32_TO_LE (log->video.fps_n);
+    header->fps_d = GINT32_TO_LE (log->video.fps_d);
+    /* Compressed segments cannot be updated later, so they count all
+     * streams the file has handed out */
+    header->n_streams = GUINT32_TO_LE (file->compressor ? file->n_streams : 0);
+    sec_offset = record->sec_offset;
+    header->sec_offset = GUINT64_TO_LE (sec_offset);
+    gst_timecodelog_file_write (file, header, sizeof (*header));
+    file->header_pending = FALSE;
+  } else if (sec_offset == 0 && record->sec_offset != 0) {
+    /* The receiver may fail to read sec_offset on the first frames. Fill it
+     * in once known; earlier records are flagged and do not depend on it.
+     * Compressed segments keep 0, so later records carry all of it. */
+    guint64 le = GUINT64_TO_LE (record->sec_offset);
+    if (gst_timecodelog_file_patch (file,
+            offsetof (GstTimecodeBinlogHeader, sec_offset), &le, sizeof (le))) {
+      sec_offset = record->sec_offset;
+      header->sec_offset = le;
+    }
+  }
+
+  if (!log->announced) {
+    if (log->stream >= GUINT32_FROM_LE (header->n_streams)) {
+      guint32 le = GUINT32_TO_LE (log->stream + 1);
+      if (gst_timecodelog_file_patch (file,
+              offsetof (GstTimecodeBinlogHeader, n_streams), &le, sizeof (le)))
+        header->n_streams = le;
+    }
+    GstTimecodeBinlogStream announce = {
+      .flags = GUINT32_TO_LE (GST_TIMECODE_BINLOG_FLAG_STREAM),
+      .stream = GUINT32_TO_LE (log->stream),
+    };
+    strncpy (announce.name, log->stream_name, sizeof (announce.name));
+    gst_timecodelog_file_write (file, &announce, sizeof (announce));
+    log->announced = TRUE;
+  }
+
+  guint32 flags = 0;
+  if (record->latency < 0)
+    flags |= GST_TIMECODE_BINLOG_FLAG_NO_LATENCY;
+  if (record->sec_offset == 0)
+    flags |= GST_TIMECODE_BINLOG_FLAG_NO_SEC_OFFSET;
+
+  GstTimecodeBinlogRecord out = {
+    .frame_nr = GUINT64_TO_LE (record->frame_nr),
+    .time_s = GUINT64_TO_LE (record->time_s),
+    .time_p = GUINT64_TO_LE (record->time_p),
+    .latency = GINT64_TO_LE (record->latency),
+    .flags = GUINT32_TO_LE (flags),
+    .sec_offset_delta = GINT32_TO_LE (record->sec_offset == 0 ? 0 :
+        (gint32) ((gint64) record->sec_offset - (gint64) sec_offset)),
+    .hop = GUINT32_TO_LE (record->hop),
+    .stream = GUINT32_TO_LE (log->stream),
+    .hop_delta = GINT64_TO_LE (record->hop_delta),
+    .clock_offset = GINT64_TO_LE (record->clock_offset),
+    .clock_error = GINT64_TO_LE (record->clock_error),
+    .time_r = GUINT64_TO_LE (record->time_r),
+    .render_latency = GINT64_TO_LE (record->render_latency),
+  };
+  gst_timecodelog_file_write (file, &out, sizeof (out));
+}
+
+/* Finds the directive a location numbers its segments with, like
+ * multifilesink: one %d or %u with an optional width of up to two digits,
+ * such as %05u. directive is NULL if there is none, suffix is the text after
+ * it. FALSE if path has any other directive. */
+static gboolean
+gst_timecodelog_parse_location (const gchar *path, const gchar **directive,
+    const gchar **suffix)
+{
+  *directive = strchr (path, '%');
+  if (!*directive)
+    return TRUE;
+
+  const gchar *p = *directive + 1;
+  while (g_ascii_isdigit (*p) && p - *directive <= 2)
+    p++;
+  if (*p != 'd' && *p != 'u')
+    return FALSE;
+  *suffix = p + 1;
+  return strchr (*suffix, '%') == NULL;
+}
+
+/* Must be called with the service lock held */
+static gboolean
+gst_timecodelog_segment_open (GsttimecodelogFile *file)
+{
+  const gchar *directive, *suffix;
+
+  g_free (file->segment_path);
+  /* A location with a directive names every segment. The directive is
+   * filled in here, the location is never used as a format string. */
+  if (gst_timecodelog_parse_location (file->path, &directive, &suffix) &&
+      directive)
+    file->segment_path = g_strdup_printf (directive[1] == '0' ?
+        "%.*s%0*u%s" : "%.*s%*u%s", (gint) (directive - file->path),
+        file->path, (gint) g_ascii_strtoull (directive + 1, NULL, 10),
+        file->segment, suffix);
+  else if (file->segment > 0)
+    file->segment_path = g_strdup_printf ("%s.%u", file->path, file->segment);
+  else
+    file->segment_path = g_strdup (file->path);
+
+  file->file = g_fopen (file->segment_path,
+      file->format == GST_TIMECODELOG_FORMAT_BINARY ||
+      file->compression != GST_TIMECODELOG_COMPRESSION_NONE ? "wb" : "w");
+  if (!file->file) {
+    GST_ERROR ("Failed opening logfile at %s", file->segment_path);
+    return FALSE;
+  }
+  setvbuf (file->file, file->buffer, _IOFBF, GST_TIMECODELOG_FILE_BUFFER_SIZE);
+  if (!gst_timecodelog_compressor_new (file)) {
+    GST_ERROR ("Failed setting up compression of %s", file->segment_path);
+    fclose (file->file);
+    file->file = NULL;
+    return FALSE;
+  }
+
+  file->size = 0;
+  file->errors = 0;
+  file->started = g_get_monotonic_time ();
+  memset (&file->header, 0, sizeof (file->header));
+  file->header_pending = TRUE;
+  if (file->format == GST_TIMECODELOG_FORMAT_TEXT) {
+    /* The element's columns end with the newline */
+    gst_timecodelog_file_write (file, file->columns, strlen (file->columns) - 1);
+    gst_timecodelog_file_write (file, "\tstream\n", strlen ("\tstream\n"));
+  }
+  /* Every segment names its streams again */
+  for (GList *l = service->logs; l; l = l->next) {
+    Gsttimecodelog *log = l->data;
+    if (log->file == file)
+      log->announced = FALSE;
+  }
+  return TRUE;
+}
+
+/* Must be called with the service lock held */
+static void
+gst_timecodelog_segment_close (GsttimecodelogFile *file)
+{
+  if (!file->file)
+    return;
+
+  if (file->compressor) {
+    gst_timecodelog_compress (file, NULL, 0, GST_TIMECODELOG_COMPRESS_END);
+    gst_timecodelog_compressor_free (file);
+  }
+  if (fclose (file->file) != 0)
+    gst_timecodelog_file_error (file, "Closing");
+  if (file->errors > 0)
+    GST_WARNING ("%u writes to %s failed, it is incomplete", file->errors,
+        file->segment_path);
+  file->file = NULL;
+}
+
+/* Whether the segment is due to be replaced. A segment that failed to open
+ * is not retried. */
+static gboolean
+gst_timecodelog_segment_full (GsttimecodelogFile *file, gint64 now)
+{
+  if (!file->file)
+    return FALSE;
+
+  return (file->max_size > 0 && file->size >= file->max_size) ||
+      (file->max_duration > 0 &&
+      now - file->started >= (gint64) (file->max_duration / GST_USECOND));
+}
+
+/* Must be called with the service lock held */
+static void
+gst_timecodelog_segment_next (GsttimecodelogFile *file)
+{
+  gst_timecodelog_segment_close (file);
+  file->segment++;
+  if (gst_timecodelog_segment_open (file))
+    GST_INFO ("Continuing log in %s", file->segment_path);
+}
+
+/* Writes out everything the producer has published so far. Must be called
+ * with the service lock held. Returns the number of records consumed. */
+static guint
+gst_timecodelog_drain (Gsttimecodelog *log)
+{
+  GsttimecodelogFile *file = log->file;
+  gint64 now = g_get_monotonic_time ();
+  guint n = 0;
+
+  GsttimecodelogVideoInfo *video = gst_timecodelog_exchange (&log->video_info,
+      NULL);
+  if (video) {
+    log->video = *video;
+    g_free (video);
+  }
+
+  if (file && !log->stream_name)
+    log->stream_name = log->stream_id ? g_strdup (log->stream_id) :
+        log->owner ? gst_object_get_name (log->owner) : g_strdup ("");
+
+  guint tail = (guint) g_atomic_int_get (&log->tail);
+  guint head = (guint) g_atomic_int_get (&log->head);
+  while (tail != head) {
+    const GsttimecodelogRecord *record =
+        &log->ring[tail & (GST_TIMECODELOG_RING_SIZE - 1)];
+    /* Later hops of a receiver stay in the segment of their frame. A
+     * sender logs one record per frame, whatever its hop. */
+    if (file && (record->hop == 0 || log->kind == GST_TIMECODE_BINLOG_KIND_SENDER) &&
+        gst_timecodelog_segment_full (file, now))
+      gst_timecodelog_segment_next (file);
+    if (file && file->format == GST_TIMECODELOG_FORMAT_BINARY)
+      gst_timecodelog_write_binary (log, file, record);
+    else if (file)
+      gst_timecodelog_write_text (log, file, record);
+    tail++;
+    n++;
+    /* Hand the slot back before looking for more */
+    g_atomic_int_set (&log->tail, (gint) tail);
+    if (tail == head)
+      head = (guint) g_atomic_int_get (&log->head);
+  }
+  if (n > 0 && file)
+    file->dirty = TRUE;
+
+  return n;
+}
+
+/* Must be called with the service lock held */
+static void
+gst_timecodelog_flush (void)
+{
+  for (GList *l = service->files; l; l = l->next) {
+    GsttimecodelogFile *file = l->data;
+    if (file->dirty && file->file) {
+      /* Readers of a running log see whole records */
+      if (file->compressor)
+        gst_timecodelog_compress (file, NULL, 0, GST_TIMECODELOG_COMPRESS_FLUSH);
+      gst_timecodelog_fflush (file);
+    }
+    file->dirty = FALSE;
+  }
+  service->next_flush = g_get_monotonic_time () + GST_TIMECODELOG_FLUSH_INTERVAL;
+}
+
+static gpointer
+gst_timecodelog_thread (gpointer data)
+{
+  GThread *self = g_thread_self ();
+
+  g_mutex_lock (&service->lock);
+  while (service->thread == self) {
+    guint n = 0;
+    for (GList *l = service->logs; l; l = l->next)
+      n += gst_timecodelog_drain (l->data);
+    if (g_get_monotonic_time () >= service->next_flush)
+      gst_timecodelog_flush ();
+
+    if (n == 0) {
+      g_mutex_unlock (&service->lock);
+      g_usleep (GST_TIMECODELOG_POLL_INTERVAL);
+      g_mutex_lock (&service->lock);
+    }
+  }
+  g_mutex_unlock (&service->lock);
+
+  return NULL;
+}
+
+/* Opens the first segment of a new file. The limits are the log's until
+ * another log changes them. Must be called with the service lock held. */
+static GsttimecodelogFile *
+gst_timecodelog_file_open (Gsttimecodelog *log, const gchar *path,
+    GsttimecodelogFormat format, GsttimecodelogCompression compression)
+{
+  GsttimecodelogFile *file = g_new0 (GsttimecodelogFile, 1);
+  file->path = g_strdup (path);
+  file->buffer = g_malloc (GST_TIMECODELOG_FILE_BUFFER_SIZE);
+  file->kind = log->kind;
+  file->columns = log->columns;
+  file->format = format;
+  file->compression = compression;
+  file->max_size = log->max_size;
+  file->max_duration = log->max_duration;
+
+  if (!gst_timecodelog_segment_open (file)) {
+    g_free (file->segment_path);
+    g_free (file->buffer);
+    g_free (file->path);
+    g_free (file);
+    return NULL;
+  }
+  return file;
+}
+
+/* Must be called with the service lock held */
+static void
+gst_timecodelog_file_close (GsttimecodelogFile *file)
+{
+  gst_timecodelog_segment_close (file);
+  g_free (file->compressed);
+  g_free (file->buffer);
+  g_free (file->segment_path);
+  g_free (file->path);
+  g_free (file);
+}
+
+/* Must be called with the service lock held */
+static void
+gst_timecodelog_detach (Gsttimecodelog *log)
+{
+  GsttimecodelogFile *file = log->file;
+
+  log->file = NULL;
+  if (file && --file->n_logs == 0) {
+    GST_INFO_OBJECT (log->owner, "Closing logfile %s", file->path);
+    service->files = g_list_remove (service->files, file);
+    gst_timecodelog_file_close (file);
+  }
+}
+
+/* Points log at the file at path, which other logs may already write to.
+ * A log that is the only one writing there starts the file over, like the
+ * first one to open it. Must be called with the service lock held. */
+static gboolean
+gst_timecodelog_attach (Gsttimecodelog *log, const gchar *path,
+    GsttimecodelogFormat format, GsttimecodelogCompression compression)
+{
+  GsttimecodelogFile *file = NULL;
+
+  for (GList *l = service->files; l; l = l->next)
+    if (g_strcmp0 (((GsttimecodelogFile *) l->data)->path, path) == 0)
+      file = l->data;
+
+  if (file && file == log->file && file->n_logs == 1)
+    file = NULL;
+
+  if (file && (file->kind != log->kind || file->format != format ||
+          file->compression != compression)) {
+    GST_ERROR_OBJECT (log->owner, "%s is written by another element in a "
+        "different kind, format or compression", path);
+    return FALSE;
+  }
+
+  if (!file) {
+    /* What the old file still buffers must not end up in a new one */
+    if (log->file && log->file->file)
+      gst_timecodelog_fflush (log->file);
+    if (!(file = gst_timecodelog_file_open (log, path, format, compression)))
+      return FALSE;
+    gst_timecodelog_detach (log);
+    service->files = g_list_prepend (service->files, file);
+  } else if (file != log->file) {
+    gst_timecodelog_detach (log);
+  } else {
+    return TRUE;
+  }
+
+  file->n_logs++;
+  log->file = file;
+  log->stream = file->n_streams++;
+  log->announced = FALSE;
+  return TRUE;
+}
+
+/* Both plugins carry a copy of this file. The first one loaded hangs its
+ * service on a type, where the other one finds it, so the process has one
+ * writer thread and one table of open files. Plugins are loaded one at a
+ * time, which makes the lookup safe when called from plugin_init. */
+void
+gst_timecodelog_init (void)
+{
+  static gsize once = 0;
+
+  if (g_once_init_enter (&once)) {
+    GQuark quark = g_quark_from_static_string ("GsttimecodelogService");
+    GType type = g_type_from_name ("GsttimecodelogService");
+    if (!type)
+      type = g_pointer_type_register_static ("GsttimecodelogService");
+
+    service = g_type_get_qdata (type, quark);
+    if (!service) {
+      service = g_new0 (GsttimecodelogService, 1);
+      g_mutex_init (&service->lock);
+      g_type_set_qdata (type, quark, service);
+    }
+    g_once_init_leave (&once, 1);
+  }
+}
+
+Gsttimecodelog *
+gst_timecodelog_new (GstObject *owner, guint kind, const gchar *columns,
+    GsttimecodelogFormatFunc format)
+{
+  static gsize debug_once = 0;
+
+  if (g_once_init_enter (&debug_once)) {
+    GST_DEBUG_CATEGORY_INIT (gst_timecodelog_debug, "timecodelog", 0,
+        "Timecode log writer");
+    g_once_init_leave (&debug_once, 1);
+  }
+
+  gst_timecodelog_init ();
+
+  Gsttimecodelog *log = g_new0 (Gsttimecodelog, 1);
+  log->owner = owner;
+  log->kind = kind;
+  log->columns = columns;
+  log->format = format;
+  log->policy = GST_TIMECODELOG_FULL_POLICY_DROP;
+  log->ts_second = -1;
+
+  g_mutex_lock (&service->lock);
+  service->logs = g_list_prepend (service->logs, log);
+  if (!service->thread)
+    service->thread = g_thread_new ("timecodelog", gst_timecodelog_thread, NULL);
+  g_mutex_unlock (&service->lock);
+  return log;
+}
+
+void
+gst_timecodelog_free (Gsttimecodelog *log)
+{
+  GThread *thread = NULL;
+
+  gst_timecodelog_set_shm_name (log, NULL);
+
+  g_mutex_lock (&service->lock);
+  gst_timecodelog_drain (log);
+  if (log->file && log->file->file)
+    gst_timecodelog_fflush (log->file);
+  gst_timecodelog_detach (log);
+  service->logs = g_list_remove (service->logs, log);
+  if (!service->logs) {
+    thread = service->thread;
+    service->thread = NULL;
+  }
+  g_mutex_unlock (&service->lock);
+  if (thread)
+    g_thread_join (thread);
+
+  guint64 dropped = gst_timecodelog_get_dropped (log);
+  if (dropped > 0)
+    GST_WARNING_OBJECT (log->owner, "Dropped %" G_GUINT64_FORMAT
+        " log records", dropped);
+
+  g_free (log->video_info);
+  g_free (log->path);
+  g_free (log->stream_id);
+  g_free (log->stream_name);
+  g_free (log);
+}
+
+gboolean
+gst_timecodelog_set_location (Gsttimecodelog *log, const gchar *path)
+{
+  const gchar *directive, *suffix;
+
+  if (path && !gst_timecodelog_parse_location (path, &directive, &suffix)) {
+    GST_ERROR_OBJECT (log->owner, "%s has a directive other than one %%d or "
+        "%%u", path);
+    return FALSE;
+  }
+
+  g_mutex_lock (&service->lock);
+  gboolean ret = gst_timecodelog_attach (log, path, log->file_format,
+      log->compression);
+  if (ret) {
+    g_free (log->path);
+    log->path = g_strdup (path);
+  }
+  g_mutex_unlock (&service->lock);
+  return ret;
+}
+
+gchar *
+gst_timecodelog_dup_location (Gsttimecodelog *log)
+{
+  g_mutex_lock (&service->lock);
+  gchar *path = g_strdup (log->path);
+  g_mutex_unlock (&service->lock);
+  return path;
+}
+
+/* Reopens the current location so the file starts with the right header */
+void
+gst_timecodelog_set_format (Gsttimecodelog *log, GsttimecodelogFormat format)
+{
+  g_mutex_lock (&service->lock);
+  if (format != log->file_format) {
+    log->file_format = format;
+    if (log->path)
+      gst_timecodelog_attach (log, log->path, format, log->compression);
+  }
+  g_mutex_unlock (&service->lock);
+}
+
+GsttimecodelogFormat
+gst_timecodelog_get_format (Gsttimecodelog *log)
+{
+  return log->file_format;
+}
+
+/* Reopens the current location like a format change. FALSE if this build
+ * lacks the compression. */
+gboolean
+gst_timecodelog_set_compression (Gsttimecodelog *log,
+    GsttimecodelogCompression compression)
+{
+  if (!gst_timecodelog_compression_available (compression))
+    return FALSE;
+
+  g_mutex_lock (&service->lock);
+  if (compression != log->compression) {
+    log->compression = compression;
+    if (log->path)
+      gst_timecodelog_attach (log, log->path, log->file_format, compression);
+  }
+  g_mutex_unlock (&service->lock);
+  return TRUE;
+}
+
+GsttimecodelogCompression
+gst_timecodelog_get_compression (Gsttimecodelog *log)
+{
+  return log->compression;
+}
+
+/* The limits apply to the file, which the elements sharing it have in
+ * common: the last one to change them wins. The current segment is checked
+ * against them before its next frame. */
+void
+gst_timecodelog_set_max_size (Gsttimecodelog *log, guint64 max_size)
+{
+  g_mutex_lock (&service->lock);
+  log->max_size = max_size;
+  if (log->file)
+    log->file->max_size = max_size;
+  g_mutex_unlock (&service->lock);
+}
+
+guint64
+gst_timecodelog_get_max_size (Gsttimecodelog *log)
+{
+  g_mutex_lock (&service->lock);
+  guint64 max_size = log->max_size;
+  g_mutex_unlock (&service->lock);
+  return max_size;
+}
+
+void
+gst_timecodelog_set_max_duration (Gsttimecodelog *log, GstClockTime max_duration)
+{
+  g_mutex_lock (&service->lock);
+  log->max_duration = max_duration;
+  if (log->file)
+    log->file->max_duration = max_duration;
+  g_mutex_unlock (&service->lock);
+}
+
+GstClockTime
+gst_timecodelog_get_max_duration (Gsttimecodelog *log)
+{
+  g_mutex_lock (&service->lock);
+  GstClockTime max_duration = log->max_duration;
+  g_mutex_unlock (&service->lock);
+  return max_duration;
+}
+
+/* Stream metadata for the binary header. Only used by files whose header has
+ * not been written yet. Called from the streaming thread, so it does not
+ * take the service lock the writer holds during I/O. */
+void
+gst_timecodelog_set_video_info (Gsttimecodelog *log, gint width, gint height,
+    gint fps_n, gint fps_d)
+{
+  GsttimecodelogVideoInfo *video = g_new (GsttimecodelogVideoInfo, 1);
+  video->width = width;
+  video->height = height;
+  video->fps_n = fps_n;
+  video->fps_d = fps_d;
+  /* Replaces caps the writer has not taken yet */
+  g_free (gst_timecodelog_exchange (&log->video_info, video));
+}
+
+/* Names the stream in the log, NULL for the owner's name */
+void
+gst_timecodelog_set_stream_id (Gsttimecodelog *log, const gchar *stream_id)
+{
+  g_mutex_lock (&service->lock);
+  g_free (log->stream_id);
+  log->stream_id = g_strdup (stream_id);
+  g_clear_pointer (&log->stream_name, g_free);
+  log->announced = FALSE;
+  g_mutex_unlock (&service->lock);
+}
+
+gchar *
+gst_timecodelog_dup_stream_id (Gsttimecodelog *log)
+{
+  g_mutex_lock (&service->lock);
+  gchar *stream_id = g_strdup (log->stream_id);
+  g_mutex_unlock (&service->lock);
+  return stream_id;
+}
+
+void
+gst_timecodelog_set_full_policy (Gsttimecodelog *log,
+    GsttimecodelogFullPolicy policy)
+{
+  g_atomic_int_set (&log->policy, policy);
+}
+
+GsttimecodelogFullPolicy
+gst_timecodelog_get_full_policy (Gsttimecodelog *log)
+{
+  return g_atomic_int_get (&log->policy);
+}
+
+guint64
+gst_timecodelog_get_dropped (Gsttimecodelog *log)
+{
+  return __atomic_load_n (&log->dropped, __ATOMIC_RELAXED);
+}
+
+/* Publishes into the shared-memory object name from now on, or stops if
+ * name is NULL */
+gboolean
+gst_timecodelog_set_shm_name (Gsttimecodelog *log, const gchar *name)
+{
+  GsttimecodeShm *shm = g_atomic_pointer_get (&log->shm);
+
+  /* The name is taken while this log still has it */
+  if (name && shm && g_strcmp0 (gst_timecode_shm_get_name (shm) + 1,
+          name[0] == '/' ? name + 1 : name) == 0)
+    return TRUE;
+
+  shm = NULL;
+  if (name && !(shm = gst_timecode_shm_new (name, log->kind)))
+    return FALSE;
+
+  GsttimecodeShm *old = gst_timecodelog_exchange (&log->shm, shm);
+  while (g_atomic_int_get (&log->publishing))
+    g_usleep (GST_TIMECODELOG_BLOCK_INTERVAL);
+  if (old)
+    gst_timecode_shm_free (old);
+  return TRUE;
+}
+
+gchar *
+gst_timecodelog_dup_shm_name (Gsttimecodelog *log)
+{
+  g_atomic_int_inc (&log->publishing);
+  GsttimecodeShm *shm = g_atomic_pointer_get (&log->shm);
+  gchar *name = shm ? g_strdup (gst_timecode_shm_get_name (shm)) : NULL;
+  g_atomic_int_add (&log->publishing, -1);
+  return name;
+}
+
+/* Called from the streaming thread. Never takes a lock and never allocates;
+ * with the block policy it waits for the writer to free a slot. */
+gboolean
+gst_timecodelog_push (Gsttimecodelog *log, const GsttimecodelogRecord *record)
+{
+  guint head = (guint) log->head;
+
+  /* Monitors see the record even if the file writer falls behind */
+  g_atomic_int_inc (&log->publishing);
+  GsttimecodeShm *shm = g_atomic_pointer_get (&log->shm);
+  if (shm)
+    gst_timecode_shm_publish (shm, record);
+  g_atomic_int_add (&log->publishing, -1);
+
+  while (head - (guint) g_atomic_int_get (&log->tail) >= GST_TIMECODELOG_RING_SIZE) {
+    if (g_atomic_int_get (&log->policy) == GST_TIMECODELOG_FULL_POLICY_DROP) {
+      __atomic_fetch_add (&log->dropped, 1, __ATOMIC_RELAXED);
+      return FALSE;
+    }
+    g_usleep (GST_TIMECODELOG_BLOCK_INTERVAL);
+  }
+
+  log->ring[head & (GST_TIMECODELOG_RING_SIZE - 1)] = *record;
+  g_atomic_int_set (&log->head, (gint) (head + 1));
+  return TRUE;
+}
@@ -0,0 +1,144 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_TIMECODELOG_H__
+#define __GST_TIMECODELOG_H__
+
+#include <gst/gst.h>
+#include <time.h>
+
+G_BEGIN_DECLS
+
+/* Number of records the ring between the streaming thread and the writer
+ * thread of the process can hold, per element. Must be a power of two. */
+#define GST_TIMECODELOG_RING_SIZE 1024
+
+/* What the streaming thread does when the writer falls behind */
+typedef enum {
+  GST_TIMECODELOG_FULL_POLICY_DROP,
+  GST_TIMECODELOG_FULL_POLICY_BLOCK,
+} GsttimecodelogFullPolicy;
+
+#define GST_TYPE_TIMECODELOG_FULL_POLICY (gst_timecodelog_full_policy_get_type())
+GType gst_timecodelog_full_policy_get_type (void);
+
+/* On-disk format of the log, see gsttimecodebinlog.h for the binary one */
+typedef enum {
+  GST_TIMECODELOG_FORMAT_TEXT,
+  GST_TIMECODELOG_FORMAT_BINARY,
+} GsttimecodelogFormat;
+
+#define GST_TYPE_TIMECODELOG_FORMAT (gst_timecodelog_format_get_type())
+GType gst_timecodelog_format_get_type (void);
+
+/* Compression of the log files, applied by the writer thread */
+typedef enum {
+  GST_TIMECODELOG_COMPRESSION_NONE,
+  GST_TIMECODELOG_COMPRESSION_GZIP,
+  GST_TIMECODELOG_COMPRESSION_ZSTD,
+} GsttimecodelogCompression;
+
+#define GST_TYPE_TIMECODELOG_COMPRESSION (gst_timecodelog_compression_get_type())
+GType gst_timecodelog_compression_get_type (void);
+
+/* One log line, filled in on the streaming thread. Fields an element does not
+ * use are left at 0. */
+typedef struct {
+  gint64 realtime;        /* wall-clock time of the sample, µs since the epoch */
+  guint64 frame_nr;
+  guint64 time_s;
+  guint64 time_p;
+  gint64 latency;
+  guint64 sec_offset;
+  guint hop;              /* code block the values were read from */
+  gint64 hop_delta;       /* µs since the previous hop stamped the frame, -1 for hop 0 */
+  gint64 clock_offset;    /* µs added to the local wall clock, see GsttimecodeNetclock */
+  gint64 clock_error;     /* µs the wall clock may be off by, -1 if unknown */
+  guint64 time_r;         /* like time_p, when the sink renders the frame, 0 if not measured */
+  gint64 render_latency;  /* time_r - time_s, -1 if not measured */
+} GsttimecodelogRecord;
+
+/* Formats one record into buf as a line matching the columns the log was
+ * created with, which the log appends the stream column to. ts is the UTC
+ * time string of record->realtime. Runs on the writer thread. */
+typedef gint (*GsttimecodelogFormatFunc) (const GsttimecodelogRecord * record,
+    const gchar * ts, gchar * buf, gsize size);
+
+typedef struct _Gsttimecodelog Gsttimecodelog;
+
+/* Wall-clock time in µs since the epoch. Take one sample per frame and use it
+ * for both the encoded value and the log record, so the two cannot skew. */
+static inline gint64
+gst_timecodelog_realtime (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_REALTIME, &ts);
+  return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+/* Finds the writer of the process, see gsttimecodelog.c. Called from
+ * plugin_init, and by gst_timecodelog_new() for programs without plugins. */
+void gst_timecodelog_init (void);
+
+Gsttimecodelog *gst_timecodelog_new (GstObject * owner, guint kind,
+    const gchar * columns, GsttimecodelogFormatFunc format);
+void gst_timecodelog_free (Gsttimecodelog * log);
+
+/* path may number the segments with one %d or %u, see README.md. FALSE if
+ * it has other directives or cannot be opened. */
+gboolean gst_timecodelog_set_location (Gsttimecodelog * log, const gchar * path);
+gchar *gst_timecodelog_dup_location (Gsttimecodelog * log);
+
+void gst_timecodelog_set_format (Gsttimecodelog * log,
+    GsttimecodelogFormat format);
+GsttimecodelogFormat gst_timecodelog_get_format (Gsttimecodelog * log);
+gboolean gst_timecodelog_set_compression (Gsttimecodelog * log,
+    GsttimecodelogCompression compression);
+GsttimecodelogCompression gst_timecodelog_get_compression (Gsttimecodelog * log);
+
+/* Start a new segment of the file once it reaches this size in bytes or
+ * duration, 0 for no limit */
+void gst_timecodelog_set_max_size (Gsttimecodelog * log, guint64 max_size);
+guint64 gst_timecodelog_get_max_size (Gsttimecodelog * log);
+void gst_timecodelog_set_max_duration (Gsttimecodelog * log,
+    GstClockTime max_duration);
+GstClockTime gst_timecodelog_get_max_duration (Gsttimecodelog * log);
+void gst_timecodelog_set_video_info (Gsttimecodelog * log, gint width,
+    gint height, gint fps_n, gint fps_d);
+
+void gst_timecodelog_set_stream_id (Gsttimecodelog * log,
+    const gchar * stream_id);
+gchar *gst_timecodelog_dup_stream_id (Gsttimecodelog * log);
+
+void gst_timecodelog_set_full_policy (Gsttimecodelog * log,
+    GsttimecodelogFullPolicy policy);
+GsttimecodelogFullPolicy gst_timecodelog_get_full_policy (Gsttimecodelog * log);
+guint64 gst_timecodelog_get_dropped (Gsttimecodelog * log);
+
+gboolean gst_timecodelog_set_shm_name (Gsttimecodelog * log,
+    const gchar * name);
+gchar *gst_timecodelog_dup_shm_name (Gsttimecodelog * log);
+
+gboolean gst_timecodelog_push (Gsttimecodelog * log,
+    const GsttimecodelogRecord * record);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODELOG_H__ */
@@ -0,0 +1,360 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecodemeta.h"
+
+GType
+gst_timecode_mode_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIMECODE_MODE_PIXELS, "Draw the code into the frame", "pixels"},
+    {GST_TIMECODE_MODE_META, "Attach the values as buffer meta", "meta"},
+    {GST_TIMECODE_MODE_AUTO, "Meta if downstream reads it, else pixels", "auto"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodeMode");
+    if (!t)
+      t = g_enum_register_static ("GsttimecodeMode", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+GType
+gst_timecode_meta_api_get_type (void)
+{
+  static gsize type = 0;
+  /* No tags: the values stay valid whatever happens to the pixels */
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    /* Both plugins carry a copy of this file, only register the type once */
+    GType t = g_type_from_name ("GsttimecodeMetaAPI");
+    if (!t)
+      t = gst_meta_api_type_register ("GsttimecodeMetaAPI", tags);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+static gboolean
+gst_timecode_meta_init (GstMeta *meta, gpointer params, GstBuffer *buffer)
+{
+  GsttimecodeMeta *tmeta = (GsttimecodeMeta *) meta;
+
+  tmeta->hop = 0;
+  tmeta->fields = 0;
+  tmeta->interval_log2 = 0;
+  tmeta->sec_offset = 0;
+  tmeta->time_s = 0;
+  tmeta->frame_nr = 0;
+  memset (tmeta->values, 0, sizeof (tmeta->values));
+  return TRUE;
+}
+
+static gboolean
+gst_timecode_meta_transform (GstBuffer *dest, GstMeta *meta, GstBuffer *buffer,
+    GQuark type, gpointer data)
+{
+  GsttimecodeMeta *src = (GsttimecodeMeta *) meta;
+
+  /* Copies, scaling and conversions all keep the values */
+  GsttimecodeMeta *tmeta = gst_timecode_meta_add (dest, src->hop);
+  if (!tmeta)
+    return FALSE;
+  memcpy ((guint8 *) tmeta + sizeof (GstMeta), (guint8 *) src + sizeof (GstMeta),
+      sizeof (GsttimecodeMeta) - sizeof (GstMeta));
+  return TRUE;
+}
+
+static const GstMetaInfo *
+gst_timecode_meta_get_info (void)
+{
+  static gsize info = 0;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *i = gst_meta_get_info ("GsttimecodeMeta");
+    if (!i)
+      i = gst_meta_register (GST_TIMECODE_META_API_TYPE, "GsttimecodeMeta",
+          sizeof (GsttimecodeMeta), gst_timecode_meta_init, NULL,
+          gst_timecode_meta_transform);
+    g_once_init_leave (&info, (gsize) i);
+  }
+  return (const GstMetaInfo *) info;
+}
+
+GsttimecodeMeta *
+gst_timecode_meta_add (GstBuffer *buffer, guint hop)
+{
+  GsttimecodeMeta *meta = (GsttimecodeMeta *) gst_buffer_add_meta (buffer,
+      gst_timecode_meta_get_info (), NULL);
+
+  if (meta)
+    meta->hop = hop;
+  return meta;
+}
+
+GsttimecodeMeta *
+gst_timecode_meta_get (GstBuffer *buffer, guint hop)
+{
+  gpointer state = NULL;
+  GstMeta *meta;
+
+  while ((meta = gst_buffer_iterate_meta_filtered (buffer, &state,
+              GST_TIMECODE_META_API_TYPE))) {
+    if (((GsttimecodeMeta *) meta)->hop == hop)
+      return (GsttimecodeMeta *) meta;
+  }
+  return NULL;
+}
+
+GType
+gst_timecode_render_meta_api_get_type (void)
+{
+  static gsize type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodeRenderMetaAPI");
+    if (!t)
+      t = gst_meta_api_type_register ("GsttimecodeRenderMetaAPI", tags);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+struct _GsttimecodeRenderPending {
+  gint refcount;
+  gint done;
+  gpointer parse;
+  GsttimecodelogRecord records[GST_TIMECODE_MAX_HOPS];
+  guint n_records;
+  GsttimecodeRenderExpired expired;
+};
+
+static const GstMetaInfo *gst_timecode_render_meta_get_info (void);
+
+static gboolean
+gst_timecode_render_meta_init (GstMeta *meta, gpointer params, GstBuffer *buffer)
+{
+  GsttimecodeRenderMeta *rmeta = (GsttimecodeRenderMeta *) meta;
+
+  rmeta->parse = NULL;
+  rmeta->records = NULL;
+  rmeta->n_records = 0;
+  rmeta->pending = NULL;
+  return TRUE;
+}
+
+static void
+gst_timecode_render_meta_free (GstMeta *meta, GstBuffer *buffer)
+{
+  GsttimecodeRenderPending *pending = ((GsttimecodeRenderMeta *) meta)->pending;
+
+  if (!pending || !g_atomic_int_dec_and_test (&pending->refcount))
+    return;
+  /* Dropped, flushed or stripped of the meta on the way to the sink */
+  if (!g_atomic_int_get (&pending->done))
+    pending->expired (pending->parse, pending->records, pending->n_records);
+  gst_object_unref (pending->parse);
+  g_free (pending);
+}
+
+static GsttimecodeRenderMeta *
+gst_timecode_render_meta_add_pending (GstBuffer *buffer,
+    GsttimecodeRenderPending *pending)
+{
+  GsttimecodeRenderMeta *meta = (GsttimecodeRenderMeta *) gst_buffer_add_meta (
+      buffer, gst_timecode_render_meta_get_info (), NULL);
+
+  if (meta) {
+    meta->parse = pending->parse;
+    meta->records = pending->records;
+    meta->n_records = pending->n_records;
+    meta->pending = pending;
+    g_atomic_int_inc (&pending->refcount);
+  }
+  return meta;
+}
+
+static gboolean
+gst_timecode_render_meta_transform (GstBuffer *dest, GstMeta *meta,
+    GstBuffer *buffer, GQuark type, gpointer data)
+{
+  GsttimecodeRenderMeta *src = (GsttimecodeRenderMeta *) meta;
+
+  /* Converters between timecodeparse and the sink must not lose it */
+  return gst_timecode_render_meta_add_pending (dest, src->pending) != NULL;
+}
+
+static const GstMetaInfo *
+gst_timecode_render_meta_get_info (void)
+{
+  static gsize info = 0;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *i = gst_meta_get_info ("GsttimecodeRenderMeta");
+    if (!i)
+      i = gst_meta_register (GST_TIMECODE_RENDER_META_API_TYPE,
+          "GsttimecodeRenderMeta", sizeof (GsttimecodeRenderMeta),
+          gst_timecode_render_meta_init, gst_timecode_render_meta_free,
+          gst_timecode_render_meta_transform);
+    g_once_init_leave (&info, (gsize) i);
+  }
+  return (const GstMetaInfo *) info;
+}
+
+GsttimecodeRenderMeta *
+gst_timecode_render_meta_add (GstBuffer *buffer, gpointer parse,
+    const GsttimecodelogRecord *records, guint n_records,
+    GsttimecodeRenderExpired expired)
+{
+  g_return_val_if_fail (n_records > 0 && n_records <= GST_TIMECODE_MAX_HOPS,
+      NULL);
+
+  GsttimecodeRenderPending *pending = g_new0 (GsttimecodeRenderPending, 1);
+  pending->parse = gst_object_ref (parse);
+  memcpy (pending->records, records, n_records * sizeof (*records));
+  pending->n_records = n_records;
+  pending->expired = expired;
+
+  GsttimecodeRenderMeta *meta =
+      gst_timecode_render_meta_add_pending (buffer, pending);
+  if (!meta) {
+    gst_object_unref (pending->parse);
+    g_free (pending);
+  }
+  return meta;
+}
+
+gboolean
+gst_timecode_render_meta_complete (GsttimecodeRenderMeta *meta)
+{
+  return g_atomic_int_compare_and_exchange (&meta->pending->done, 0, 1);
+}
+
+GsttimecodeRenderMeta *
+gst_timecode_render_meta_get (GstBuffer *buffer, gpointer parse)
+{
+  gpointer state = NULL;
+  GstMeta *meta;
+
+  while ((meta = gst_buffer_iterate_meta_filtered (buffer, &state,
+              GST_TIMECODE_RENDER_META_API_TYPE))) {
+    if (((GsttimecodeRenderMeta *) meta)->parse == parse)
+      return (GsttimecodeRenderMeta *) meta;
+  }
+  return NULL;
+}
+
+GType
+gst_timecode_trace_meta_api_get_type (void)
+{
+  static gsize type = 0;
+  /* Encoders and payloaders pass it on, the frame stays the same */
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodeTraceMetaAPI");
+    if (!t)
+      t = gst_meta_api_type_register ("GsttimecodeTraceMetaAPI", tags);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
+
+static gboolean
+gst_timecode_trace_meta_init (GstMeta *meta, gpointer params, GstBuffer *buffer)
+{
+  GsttimecodeTraceMeta *tmeta = (GsttimecodeTraceMeta *) meta;
+
+  tmeta->sec_offset = 0;
+  tmeta->frame_nr = 0;
+  return TRUE;
+}
+
+static gboolean
+gst_timecode_trace_meta_transform (GstBuffer *dest, GstMeta *meta,
+    GstBuffer *buffer, GQuark type, gpointer data)
+{
+  GsttimecodeTraceMeta *src = (GsttimecodeTraceMeta *) meta;
+
+  return gst_timecode_trace_meta_add (dest, src->sec_offset, src->frame_nr) != NULL;
+}
+
+static const GstMetaInfo *
+gst_timecode_trace_meta_get_info (void)
+{
+  static gsize info = 0;
+
+  if (g_once_init_enter (&info)) {
+    const GstMetaInfo *i = gst_meta_get_info ("GsttimecodeTraceMeta");
+    if (!i)
+      i = gst_meta_register (GST_TIMECODE_TRACE_META_API_TYPE,
+          "GsttimecodeTraceMeta", sizeof (GsttimecodeTraceMeta),
+          gst_timecode_trace_meta_init, NULL,
+          gst_timecode_trace_meta_transform);
+    g_once_init_leave (&info, (gsize) i);
+  }
+  return (const GstMetaInfo *) info;
+}
+
+GsttimecodeTraceMeta *
+gst_timecode_trace_meta_add (GstBuffer *buffer, guint64 sec_offset,
+    guint64 frame_nr)
+{
+  GsttimecodeTraceMeta *meta = (GsttimecodeTraceMeta *) gst_buffer_add_meta (
+      buffer, gst_timecode_trace_meta_get_info (), NULL);
+
+  if (meta) {
+    meta->sec_offset = sec_offset;
+    meta->frame_nr = frame_nr;
+  }
+  return meta;
+}
+
+/* Tracers are set up in gst_init(), so the answer does not change. The
+ * tracer lives in a plugin of its own and is recognized by its type name. */
+gboolean
+gst_timecode_trace_active (void)
+{
+  static gsize active = 0;
+
+  if (g_once_init_enter (&active)) {
+    gsize found = 1;
+    GList *tracers = gst_tracing_get_active_tracers ();
+    for (GList *l = tracers; l; l = l->next)
+      if (g_strcmp0 (G_OBJECT_TYPE_NAME (l->data), "GsttimecodeTracer") == 0)
+        found = 2;
+    g_list_free_full (tracers, gst_object_unref);
+    g_once_init_leave (&active, found);
+  }
+  return active == 2;
+}
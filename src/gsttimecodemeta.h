@@ -0,0 +1,128 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODE_META_H__
+#define __GST_TIMECODE_META_H__
+
+#include <gst/gst.h>
+
+#include "gsttimecodelayout.h"
+#include "gsttimecodelog.h"
+
+G_BEGIN_DECLS
+
+/* The values timecodeoverlay would draw, attached to the buffer instead.
+ * Used when the frames reach timecodeparse without passing a lossy codec,
+ * which saves making the frame writable and thus copying it. One meta per
+ * hop. */
+typedef struct {
+  GstMeta meta;
+
+  guint hop;
+  guint fields;
+  guint interval_log2;
+  guint64 sec_offset;
+  guint64 time_s;
+  guint64 frame_nr;
+  /* Indexed by field bit, only the enabled ones are set */
+  guint64 values[GST_TIMECODE_N_FIELDS];
+} GsttimecodeMeta;
+
+#define GST_TIMECODE_META_API_TYPE (gst_timecode_meta_api_get_type())
+GType gst_timecode_meta_api_get_type (void);
+
+/* Where timecodeoverlay puts the code */
+typedef enum {
+  GST_TIMECODE_MODE_PIXELS,     /* draw it */
+  GST_TIMECODE_MODE_META,       /* attach a GsttimecodeMeta */
+  GST_TIMECODE_MODE_AUTO,       /* meta if downstream reads it, else pixels */
+} GsttimecodeMode;
+
+#define GST_TYPE_TIMECODE_MODE (gst_timecode_mode_get_type())
+GType gst_timecode_mode_get_type (void);
+
+/* Adds a meta for hop, buffer must be writable */
+GsttimecodeMeta *gst_timecode_meta_add (GstBuffer * buffer, guint hop);
+/* The meta of hop, or NULL */
+GsttimecodeMeta *gst_timecode_meta_get (GstBuffer * buffer, guint hop);
+
+/* The log records of a frame timecodeparse decoded, one per hop, carried
+ * along to the sink with measure-at=render so the record of hop 0 can be
+ * completed once the frame is rendered. The records of the later hops wait
+ * with it, so all of a frame's records reach the log together and hop 0
+ * first. parse only tells the metas of several timecodeparse apart. The
+ * copies a buffer's meta is transformed into share pending: the records are
+ * logged once, by whoever completes them, or through expired when the last
+ * copy is freed without the frame having been shown. */
+typedef struct _GsttimecodeRenderPending GsttimecodeRenderPending;
+
+typedef void (*GsttimecodeRenderExpired) (gpointer parse,
+    const GsttimecodelogRecord * records, guint n_records);
+
+typedef struct {
+  GstMeta meta;
+
+  gpointer parse;
+  /* Owned by pending, records[0] is the one of hop 0 */
+  const GsttimecodelogRecord *records;
+  guint n_records;
+  GsttimecodeRenderPending *pending;
+} GsttimecodeRenderMeta;
+
+#define GST_TIMECODE_RENDER_META_API_TYPE (gst_timecode_render_meta_api_get_type())
+GType gst_timecode_render_meta_api_get_type (void);
+
+/* Adds a meta for parse, a GstObject it keeps alive until expired is called,
+ * buffer must be writable */
+GsttimecodeRenderMeta *gst_timecode_render_meta_add (GstBuffer * buffer,
+    gpointer parse, const GsttimecodelogRecord * records, guint n_records,
+    GsttimecodeRenderExpired expired);
+/* The meta of parse, or NULL */
+GsttimecodeRenderMeta *gst_timecode_render_meta_get (GstBuffer * buffer,
+    gpointer parse);
+/* TRUE for the first copy of the meta to be completed, which logs it */
+gboolean gst_timecode_render_meta_complete (GsttimecodeRenderMeta * meta);
+
+/* Which frame a buffer is, for timecodetracer. The elements only attach it
+ * while the tracer is active and the frame carries no GsttimecodeMeta, e.g.
+ * to frames the code is drawn into. */
+typedef struct {
+  GstMeta meta;
+
+  guint64 sec_offset;
+  guint64 frame_nr;
+} GsttimecodeTraceMeta;
+
+#define GST_TIMECODE_TRACE_META_API_TYPE (gst_timecode_trace_meta_api_get_type())
+GType gst_timecode_trace_meta_api_get_type (void);
+
+/* Adds a meta, buffer must be writable */
+GsttimecodeTraceMeta *gst_timecode_trace_meta_add (GstBuffer * buffer,
+    guint64 sec_offset, guint64 frame_nr);
+#define gst_timecode_trace_meta_get(buffer) ((GsttimecodeTraceMeta *) \
+    gst_buffer_get_meta ((buffer), GST_TIMECODE_TRACE_META_API_TYPE))
+
+/* Whether timecodetracer is among the tracers of the process */
+gboolean gst_timecode_trace_active (void);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_META_H__ */
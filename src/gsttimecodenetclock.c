@@ -0,0 +1,243 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsttimecodenetclock.h"
+#include "gsttimecodelog.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_timecode_netclock_debug);
+#define GST_CAT_DEFAULT gst_timecode_netclock_debug
+
+void
+gst_timecode_netclock_init (GsttimecodeNetclock * netclock)
+{
+  static gsize debug_once = 0;
+
+  if (g_once_init_enter (&debug_once)) {
+    GST_DEBUG_CATEGORY_INIT (gst_timecode_netclock_debug, "timecodenetclock",
+        0, "Wall clock shared over the network");
+    g_once_init_leave (&debug_once, 1);
+  }
+
+  g_mutex_init (&netclock->lock);
+  netclock->address = NULL;
+  netclock->port = GST_TIMECODE_NETCLOCK_DEFAULT_PORT;
+  netclock->client = NULL;
+  netclock->error = -1;
+  netclock->serve_port = 0;
+  netclock->provider = NULL;
+}
+
+void
+gst_timecode_netclock_clear (GsttimecodeNetclock * netclock)
+{
+  gst_timecode_netclock_stop (netclock);
+  gst_timecode_netclock_set_serve_port (netclock, 0);
+  g_free (netclock->address);
+  g_mutex_clear (&netclock->lock);
+}
+
+/* The client clock posts its statistics after each exchange with the
+ * provider. Runs on the thread of the client clock. */
+static GstBusSyncReply
+gst_timecode_netclock_statistics (GstBus * bus, GstMessage * message,
+    gpointer user_data)
+{
+  GsttimecodeNetclock *netclock = user_data;
+  const GstStructure *s = gst_message_get_structure (message);
+  gboolean synced;
+  guint64 rtt;
+
+  if (s && gst_structure_has_name (s, "gst-netclock-statistics") &&
+      gst_structure_get_boolean (s, "synchronised", &synced) &&
+      gst_structure_get_uint64 (s, "rtt-average", &rtt)) {
+    g_mutex_lock (&netclock->lock);
+    netclock->error = synced ? (gint64) (rtt / 2 / GST_USECOND) : -1;
+    g_mutex_unlock (&netclock->lock);
+    GST_LOG ("synchronised=%d rtt-average=%" G_GUINT64_FORMAT " ns", synced,
+        rtt);
+  }
+  return GST_BUS_DROP;
+}
+
+void
+gst_timecode_netclock_set_address (GsttimecodeNetclock * netclock,
+    const gchar * address)
+{
+  g_mutex_lock (&netclock->lock);
+  g_free (netclock->address);
+  netclock->address = g_strdup (address);
+  g_mutex_unlock (&netclock->lock);
+}
+
+void
+gst_timecode_netclock_set_port (GsttimecodeNetclock * netclock, gint port)
+{
+  g_mutex_lock (&netclock->lock);
+  netclock->port = port;
+  g_mutex_unlock (&netclock->lock);
+}
+
+void
+gst_timecode_netclock_start (GsttimecodeNetclock * netclock)
+{
+  gchar *address = gst_timecode_netclock_dup_address (netclock);
+  gint port = gst_timecode_netclock_get_port (netclock);
+
+  gst_timecode_netclock_stop (netclock);
+  if (!address)
+    return;
+
+  GstClock *client = gst_net_client_clock_new ("timecodenetclock", address,
+      port, 0);
+  GstBus *bus = gst_bus_new ();
+  gst_bus_set_sync_handler (bus, gst_timecode_netclock_statistics, netclock,
+      NULL);
+  g_object_set (client, "bus", bus, NULL);
+  gst_object_unref (bus);
+  GST_INFO ("Following the wall clock of %s:%d", address, port);
+  g_free (address);
+
+  g_mutex_lock (&netclock->lock);
+  netclock->client = client;
+  netclock->error = -1;
+  g_mutex_unlock (&netclock->lock);
+}
+
+void
+gst_timecode_netclock_stop (GsttimecodeNetclock * netclock)
+{
+  g_mutex_lock (&netclock->lock);
+  GstClock *old = netclock->client;
+  netclock->client = NULL;
+  netclock->error = -1;
+  g_mutex_unlock (&netclock->lock);
+
+  if (old) {
+    /* The bus must not call back into a netclock that is gone */
+    g_object_set (old, "bus", NULL, NULL);
+    gst_object_unref (old);
+  }
+}
+
+gboolean
+gst_timecode_netclock_synced (GsttimecodeNetclock * netclock)
+{
+  gint64 offset, error;
+
+  g_mutex_lock (&netclock->lock);
+  gboolean following = netclock->client != NULL;
+  g_mutex_unlock (&netclock->lock);
+  if (!following)
+    return TRUE;
+
+  gst_timecode_netclock_realtime (netclock, &offset, &error);
+  return error >= 0;
+}
+
+gchar *
+gst_timecode_netclock_dup_address (GsttimecodeNetclock * netclock)
+{
+  g_mutex_lock (&netclock->lock);
+  gchar *address = g_strdup (netclock->address);
+  g_mutex_unlock (&netclock->lock);
+  return address;
+}
+
+gint
+gst_timecode_netclock_get_port (GsttimecodeNetclock * netclock)
+{
+  g_mutex_lock (&netclock->lock);
+  gint port = netclock->port;
+  g_mutex_unlock (&netclock->lock);
+  return port;
+}
+
+gboolean
+gst_timecode_netclock_set_serve_port (GsttimecodeNetclock * netclock,
+    gint port)
+{
+  /* The old provider must let go of its socket before the port is taken
+   * again */
+  g_mutex_lock (&netclock->lock);
+  GstNetTimeProvider *old = netclock->provider;
+  netclock->provider = NULL;
+  netclock->serve_port = 0;
+  g_mutex_unlock (&netclock->lock);
+  if (old)
+    gst_object_unref (old);
+
+  if (port == 0)
+    return TRUE;
+
+  GstClock *realtime = g_object_new (GST_TYPE_SYSTEM_CLOCK,
+      "clock-type", GST_CLOCK_TYPE_REALTIME, NULL);
+  GstNetTimeProvider *provider = gst_net_time_provider_new (realtime, NULL,
+      port);
+  gst_object_unref (realtime);
+  if (!provider) {
+    GST_ERROR ("Failed to serve the wall clock on port %d", port);
+    return FALSE;
+  }
+  GST_INFO ("Serving the wall clock on port %d", port);
+
+  g_mutex_lock (&netclock->lock);
+  netclock->provider = provider;
+  netclock->serve_port = port;
+  g_mutex_unlock (&netclock->lock);
+  return TRUE;
+}
+
+gint
+gst_timecode_netclock_get_serve_port (GsttimecodeNetclock * netclock)
+{
+  g_mutex_lock (&netclock->lock);
+  gint port = netclock->serve_port;
+  g_mutex_unlock (&netclock->lock);
+  return port;
+}
+
+gint64
+gst_timecode_netclock_realtime (GsttimecodeNetclock * netclock,
+    gint64 * offset, gint64 * error)
+{
+  g_mutex_lock (&netclock->lock);
+  GstClock *client = netclock->client ? gst_object_ref (netclock->client) : NULL;
+  *error = netclock->error;
+  g_mutex_unlock (&netclock->lock);
+
+  gint64 realtime = gst_timecodelog_realtime ();
+  *offset = 0;
+  if (!client)
+    return realtime;
+
+  /* Until it is synced the client clock runs from 0 */
+  if (*error >= 0 && gst_clock_is_synced (client))
+    *offset = (gint64) (gst_clock_get_time (client) / GST_USECOND) - realtime;
+  else
+    *error = -1;
+  gst_object_unref (client);
+  return realtime + *offset;
+}
@@ -0,0 +1,88 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __GST_TIMECODE_NETCLOCK_H__
+#define __GST_TIMECODE_NETCLOCK_H__
+
+#include <gst/gst.h>
+#include <gst/net/net.h>
+
+G_BEGIN_DECLS
+
+/* Default UDP port of the time provider */
+#define GST_TIMECODE_NETCLOCK_DEFAULT_PORT 5637
+
+/* The wall clock the elements stamp and measure with. Without a client it
+ * is the local wall clock. With one it is the wall clock of the host that
+ * serves it, estimated by a GstNetClientClock, so sender and receiver
+ * measure against the same clock whatever NTP does on either side.
+ *
+ * Either element can serve its local wall clock with a GstNetTimeProvider
+ * for the other side to follow. */
+typedef struct {
+  GMutex lock;
+  /* Provider to follow, NULL to use the local wall clock */
+  gchar *address;
+  gint port;
+  GstClock *client;
+  /* Half the averaged round trip to the provider in µs, -1 until known */
+  gint64 error;
+  /* Port the local wall clock is served on, 0 if it is not */
+  gint serve_port;
+  GstNetTimeProvider *provider;
+} GsttimecodeNetclock;
+
+void gst_timecode_netclock_init (GsttimecodeNetclock * netclock);
+void gst_timecode_netclock_clear (GsttimecodeNetclock * netclock);
+
+/* The provider to follow from the next start, NULL for the local wall
+ * clock */
+void gst_timecode_netclock_set_address (GsttimecodeNetclock * netclock,
+    const gchar * address);
+gchar *gst_timecode_netclock_dup_address (GsttimecodeNetclock * netclock);
+void gst_timecode_netclock_set_port (GsttimecodeNetclock * netclock, gint port);
+gint gst_timecode_netclock_get_port (GsttimecodeNetclock * netclock);
+
+/* Starts following the provider set, if any, from when the element starts
+ * until it stops */
+void gst_timecode_netclock_start (GsttimecodeNetclock * netclock);
+void gst_timecode_netclock_stop (GsttimecodeNetclock * netclock);
+
+/* Whether the wall clock is usable: always without a client, once synced
+ * with one */
+gboolean gst_timecode_netclock_synced (GsttimecodeNetclock * netclock);
+
+/* Serves the local wall clock on port on all interfaces, or stops if port
+ * is 0 */
+gboolean gst_timecode_netclock_set_serve_port (GsttimecodeNetclock * netclock,
+    gint port);
+gint gst_timecode_netclock_get_serve_port (GsttimecodeNetclock * netclock);
+
+/* The wall-clock time in µs since the epoch, see gst_timecodelog_realtime().
+ * offset is what was added to the local wall clock, error how far off the
+ * result may be, -1 while it follows the local clock or is not synced. */
+gint64 gst_timecode_netclock_realtime (GsttimecodeNetclock * netclock,
+    gint64 * offset, gint64 * error);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_NETCLOCK_H__ */
@@ -39,40 +39,74 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
-#include <sys/time.h>
-#include <time.h>
 #include <glib/gstdio.h>
 
 #include "gsttimecodeoverlay.h"
+#include "gsttimecodebinlog.h"
+#include "gsttimecodedense.h"
+#include "gsttimecoderegion.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_timecodeoverlay_debug);
 #define GST_CAT_DEFAULT gst_timecodeoverlay_debug
 
 /* Filter signals and args */
+enum
+{
+  SIGNAL_FEEDBACK,
+  LAST_SIGNAL
+};
 
 enum
 {
   PROP_0,
-  PROP_LOCATION
+  PROP_LOCATION,
+  PROP_LOG_FULL_POLICY,
+  PROP_LOG_DROPPED,
+  PROP_LOG_FORMAT,
+  PROP_ANCHOR,
+  PROP_MARGIN_X,
+  PROP_MARGIN_Y,
+  PROP_CELL_SIZE,
+  PROP_FEEDBACK_CHANNEL,
+  PROP_FEEDBACK_LATENCY,
+  PROP_FEEDBACK_LOSS,
+  PROP_FIELDS,
+  PROP_HOP,
+  PROP_ENCODING,
+  PROP_ALIGN,
+  PROP_MODE,
+  PROP_INTERVAL,
+  PROP_ADAPTIVE,
+  PROP_CURRENT_INTERVAL,
+  PROP_NET_CLOCK_ADDRESS,
+  PROP_NET_CLOCK_PORT,
+  PROP_NET_CLOCK_SERVE_PORT,
+  PROP_SHM_NAME,
+  PROP_STREAM_ID,
+  PROP_LOG_COMPRESSION,
+  PROP_MAX_SIZE,
+  PROP_MAX_DURATION,
 };
 
+static guint signals[LAST_SIGNAL] = { 0 };
+
 
 static const char *default_path = "/tmp/gsttime_sndr.csv";
-static const char *logfile_columns = "ts\tframe_nr\ttime_s\tsec_offset\n";
-static const char *fmt_string = "%s\t%lu\t%lu\t%lu\n";
+static const char *logfile_columns = "ts\tframe_nr\ttime_s\tsec_offset\tclock_offset\tclock_error\n";
+static const char *fmt_string = "%s\t%lu\t%lu\t%lu\t%ld\t%ld\n";
 
 /* the capabilities of the inputs and outputs.
  */
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("video/x-raw, format=(string) { I420 }")
+    GST_STATIC_CAPS (GST_TIMECODE_VIDEO_CAPS)
 );
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("video/x-raw, format=(string) { I420 }")
+    GST_STATIC_CAPS (GST_TIMECODE_VIDEO_CAPS)
 );
 
 #define gst_timecodeoverlay_parent_class parent_class
@@ -82,14 +116,22 @@ GST_ELEMENT_REGISTER_DEFINE (timecodeoverlay, "timecodeoverlay", GST_RANK_NONE,
     GST_TYPE_TIMECODEOVERLAY);
 
 static void gst_timecodeoverlay_dispose (GObject *object);
+static void gst_timecodeoverlay_finalize (GObject *object);
+static gboolean gst_timecodeoverlay_set_info (GstVideoFilter * filter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
+static gint gst_timecodeoverlay_format_record (const GsttimecodelogRecord * record,
+    const gchar * ts, gchar * buf, gsize size);
 static void gst_timecodeoverlay_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
 static void gst_timecodeoverlay_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
 
 static gboolean gst_timecodeoverlay_src_event (GstBaseTransform * basetransform, GstEvent * event);
-static GstFlowReturn gst_timecodeoverlay_transform_frame_ip (GstVideoFilter * filter,
-    GstVideoFrame * frame);
+static gboolean gst_timecodeoverlay_start (GstBaseTransform * trans);
+static gboolean gst_timecodeoverlay_stop (GstBaseTransform * trans);
+static GstFlowReturn gst_timecodeoverlay_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buf);
 
 /* GObject vmethod implementations */
 
@@ -107,10 +149,150 @@ gst_timecodeoverlay_class_init (GsttimecodeoverlayClass * klass)
   gobject_class->get_property = gst_timecodeoverlay_get_property;
 
   gobject_class->dispose = gst_timecodeoverlay_dispose;
+  gobject_class->finalize = gst_timecodeoverlay_finalize;
 
   g_object_class_install_property (gobject_class, PROP_LOCATION,
-      g_param_spec_string ("location", "Location", "Path to log file", default_path,
+      g_param_spec_string ("location", "Location",
+                           "Path to log file, shared by the elements of the process "
+                           "that write to the same path", default_path,
                            G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE));
+  g_object_class_install_property (gobject_class, PROP_LOG_FULL_POLICY,
+      g_param_spec_enum ("log-full-policy", "Log full policy",
+                         "What to do when the log writer falls behind",
+                         GST_TYPE_TIMECODELOG_FULL_POLICY, GST_TIMECODELOG_FULL_POLICY_DROP,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_LOG_DROPPED,
+      g_param_spec_uint64 ("log-dropped", "Log dropped",
+                           "Number of log records dropped because the writer fell behind",
+                           0, G_MAXUINT64, 0, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_LOG_FORMAT,
+      g_param_spec_enum ("log-format", "Log format",
+                         "Format of the log file",
+                         GST_TYPE_TIMECODELOG_FORMAT, GST_TIMECODELOG_FORMAT_TEXT,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ANCHOR,
+      g_param_spec_enum ("anchor", "Anchor",
+                         "Corner of the frame the code is placed relative to",
+                         GST_TYPE_TIMECODE_ANCHOR, GST_TIMECODE_ANCHOR_TOP_LEFT,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MARGIN_X,
+      g_param_spec_uint ("margin-x", "Margin X",
+                         "Horizontal distance of the code from the anchor corner, "
+                         "in 1920x1080 reference pixels if cell-size is 0",
+                         0, G_MAXINT, GST_TIMECODE_DEFAULT_MARGIN_X, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MARGIN_Y,
+      g_param_spec_uint ("margin-y", "Margin Y",
+                         "Vertical distance of the code from the anchor corner, "
+                         "in 1920x1080 reference pixels if cell-size is 0",
+                         0, G_MAXINT, GST_TIMECODE_DEFAULT_MARGIN_Y, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_CELL_SIZE,
+      g_param_spec_uint ("cell-size", "Cell size",
+                         "Edge length of one bit in pixels (0 = scale with the frame size)",
+                         0, 256, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_FEEDBACK_CHANNEL,
+      g_param_spec_string ("feedback-channel", "Feedback channel",
+                           "Also take feedback from the timecodeparse publishing on this "
+                           "in-process channel", NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_FEEDBACK_LATENCY,
+      g_param_spec_int64 ("feedback-latency", "Feedback latency",
+                          "Smoothed latency in µs last reported by timecodeparse (-1 = none yet)",
+                          -1, G_MAXINT64, -1, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_FEEDBACK_LOSS,
+      g_param_spec_double ("feedback-loss", "Feedback loss",
+                           "Smoothed fraction of frames lost last reported by timecodeparse",
+                           0, 1, 0, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_FIELDS,
+      g_param_spec_flags ("fields", "Fields",
+                          "Timing values to encode in addition to the wall-clock time, "
+                          "one row each",
+                          GST_TYPE_TIMECODE_FIELDS, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_HOP,
+      g_param_spec_uint ("hop", "Hop",
+                         "Code block to write when several timecodeoverlay elements "
+                         "stamp the same frames, stacked away from the anchor corner",
+                         0, GST_TIMECODE_MAX_HOPS - 1, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ENCODING,
+      g_param_spec_enum ("encoding", "Encoding",
+                         "How the words are drawn into the cells",
+                         GST_TYPE_TIMECODE_ENCODING, GST_TIMECODE_ENCODING_BINARY,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ALIGN,
+      g_param_spec_uint ("align", "Align",
+                         "Snap the code to codec blocks of this size, a power of two such as "
+                         "16 for H.264 or 64 for HEVC and AV1 (0 = off)",
+                         0, GST_TIMECODE_MAX_ALIGN, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+                         "Draw the code, or attach it as meta for a timecodeparse that is "
+                         "reached without a lossy codec, which avoids copying shared frames",
+                         GST_TYPE_TIMECODE_MODE, GST_TIMECODE_MODE_PIXELS,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_INTERVAL,
+      g_param_spec_uint ("interval", "Interval",
+                         "Stamp only every Nth frame, rounded down to a power of two. "
+                         "Frames in between still count in frame_nr",
+                         1, GST_TIMECODE_MAX_INTERVAL, 1, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ADAPTIVE,
+      g_param_spec_boolean ("adaptive", "Adaptive",
+                            "Stamp every frame while the feedback from timecodeparse "
+                            "shows latency jitter or loss, and back off to interval "
+                            "while it does not", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_CURRENT_INTERVAL,
+      g_param_spec_uint ("current-interval", "Current interval",
+                         "Frames from one stamped frame to the next",
+                         1, GST_TIMECODE_MAX_INTERVAL, 1, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_NET_CLOCK_ADDRESS,
+      g_param_spec_string ("net-clock-address", "Net clock address",
+                           "Stamp and measure with the wall clock of the GstNetTimeProvider "
+                           "at this address instead of the local one (NULL = local)",
+                           NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_NET_CLOCK_PORT,
+      g_param_spec_int ("net-clock-port", "Net clock port",
+                        "UDP port of the GstNetTimeProvider at net-clock-address",
+                        1, G_MAXUINT16, GST_TIMECODE_NETCLOCK_DEFAULT_PORT,
+                        G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_NET_CLOCK_SERVE_PORT,
+      g_param_spec_int ("net-clock-serve-port", "Net clock serve port",
+                        "Serve the local wall clock on this UDP port for the other "
+                        "element's net-clock-address (0 = off)",
+                        0, G_MAXUINT16, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SHM_NAME,
+      g_param_spec_string ("shm-name", "Shared memory name",
+                           "Also publish the log records live in the POSIX shared memory "
+                           "object of this name, see gsttimecodeshmring.h (NULL = off)",
+                           NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_STREAM_ID,
+      g_param_spec_string ("stream-id", "Stream ID",
+                           "Tags the log records, so elements can share a location "
+                           "(NULL = the element name)", NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_LOG_COMPRESSION,
+      g_param_spec_enum ("log-compression", "Log compression",
+                         "Compress the log file as it is written",
+                         GST_TYPE_TIMECODELOG_COMPRESSION, GST_TIMECODELOG_COMPRESSION_NONE,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE,
+      g_param_spec_uint64 ("max-size", "Max size",
+                           "Continue the log in a new segment file once it has "
+                           "this many bytes on disk (0 = unlimited)",
+                           0, G_MAXUINT64, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_DURATION,
+      g_param_spec_uint64 ("max-duration", "Max duration",
+                           "Continue the log in a new segment file after this many "
+                           "nanoseconds (0 = unlimited)",
+                           0, G_MAXUINT64, 0, G_PARAM_READWRITE));
+
+  /**
+   * Gsttimecodeoverlay::feedback:
+   * @latency: smoothed latency in µs
+   * @loss: smoothed fraction of frames lost
+   *
+   * Emitted on the streaming thread whenever timecodeparse reports back,
+   * either in an upstream event or on feedback-channel.
+   */
+  signals[SIGNAL_FEEDBACK] = g_signal_new ("feedback",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+      G_TYPE_NONE, 2, G_TYPE_INT64, G_TYPE_DOUBLE);
 
   gst_element_class_set_details_simple (gstelement_class,
       "timecodeoverlay",
@@ -123,11 +305,17 @@ gst_timecodeoverlay_class_init (GsttimecodeoverlayClass * klass)
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&sink_template));
 
-  GST_VIDEO_FILTER_CLASS (klass)->transform_frame_ip =
-      GST_DEBUG_FUNCPTR (gst_timecodeoverlay_transform_frame_ip);
+  GST_VIDEO_FILTER_CLASS (klass)->set_info =
+      GST_DEBUG_FUNCPTR (gst_timecodeoverlay_set_info);
 
   GST_BASE_TRANSFORM_CLASS (klass)->src_event =
       GST_DEBUG_FUNCPTR (gst_timecodeoverlay_src_event);
+  GST_BASE_TRANSFORM_CLASS (klass)->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_timecodeoverlay_transform_ip);
+  GST_BASE_TRANSFORM_CLASS (klass)->start =
+      GST_DEBUG_FUNCPTR (gst_timecodeoverlay_start);
+  GST_BASE_TRANSFORM_CLASS (klass)->stop =
+      GST_DEBUG_FUNCPTR (gst_timecodeoverlay_stop);
 
 
   /* debug category for fltering log messages
@@ -142,36 +330,136 @@ gst_timecodeoverlay_class_init (GsttimecodeoverlayClass * klass)
 static void
 gst_timecodeoverlay_init (Gsttimecodeoverlay * overlay)
 {
-  struct timeval tv;
-  gettimeofday(&tv,NULL);
-  overlay->sec_offset = tv.tv_sec;
+  overlay->sec_offset = 0;
   overlay->frame_nr = 0;
   overlay->latency = GST_CLOCK_TIME_NONE;
 
-  char *path = malloc(sizeof(default_path));
-  strcpy(path, default_path);
-  overlay->logfile_path = path;
-  overlay->logfile = g_fopen(overlay->logfile_path, "w");
-  if (!overlay->logfile) {
-    GST_ERROR_OBJECT (overlay, "Failed opening logfile at %s", overlay->logfile_path);
-    return;
-  }
+  overlay->feedback_channel = NULL;
+  overlay->feedback_seqnum = 0;
+  overlay->have_feedback = FALSE;
+
+  overlay->geometry = (GsttimecodeGeometry) GST_TIMECODE_GEOMETRY_INIT;
+  overlay->hop = 0;
+  overlay->layout_valid = FALSE;
+  overlay->layout_dirty = FALSE;
+
+  overlay->mode = GST_TIMECODE_MODE_PIXELS;
+  overlay->meta_query_pending = TRUE;
+  overlay->downstream_meta = FALSE;
+
+  gst_timecode_sampler_configure (&overlay->sampler, 1, FALSE);
+  overlay->until_stamp = 0;
+
+  gst_timecode_netclock_init (&overlay->netclock);
+
+  overlay->log = gst_timecodelog_new (GST_OBJECT (overlay),
+      GST_TIMECODE_BINLOG_KIND_SENDER, logfile_columns,
+      gst_timecodeoverlay_format_record);
+  gst_timecodelog_set_location (overlay->log, default_path);
 }
 
 static void
 gst_timecodeoverlay_dispose (GObject *object)
 {
   Gsttimecodeoverlay *filter = GST_TIMECODEOVERLAY (object);
-  GST_INFO_OBJECT(filter, "Closing logfile");
-  g_free(filter->logfile_path);
-  if (filter->logfile)
-    fclose(filter->logfile);
+  g_clear_pointer (&filter->log, gst_timecodelog_free);
+  g_clear_pointer (&filter->code_line, g_free);
+  g_clear_pointer (&filter->feedback_channel, g_free);
+  filter->code_line_size = 0;
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+gst_timecodeoverlay_finalize (GObject *object)
+{
+  Gsttimecodeoverlay *filter = GST_TIMECODEOVERLAY (object);
+  gst_timecode_netclock_clear (&filter->netclock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/* Called from the streaming thread */
+static void
+gst_timecodeoverlay_update_layout (Gsttimecodeoverlay * overlay,
+    const GstVideoInfo * info)
+{
+  GsttimecodeGeometry geometry;
+  guint hop;
+
+  GST_OBJECT_LOCK (overlay);
+  geometry = overlay->geometry;
+  hop = overlay->hop;
+  g_atomic_int_set (&overlay->layout_dirty, FALSE);
+  GST_OBJECT_UNLOCK (overlay);
+
+  overlay->layout_valid = gst_timecode_layout_compute (&overlay->layout,
+      &geometry, hop, GST_VIDEO_INFO_WIDTH (info), GST_VIDEO_INFO_HEIGHT (info));
+  if (!overlay->layout_valid)
+    GST_WARNING_OBJECT (overlay, "Can't draw timestamps: code of hop %u does "
+        "not fit into %dx%d frames", hop, GST_VIDEO_INFO_WIDTH (info),
+        GST_VIDEO_INFO_HEIGHT (info));
+}
+
+static gboolean
+gst_timecodeoverlay_set_info (GstVideoFilter * filter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  Gsttimecodeoverlay *overlay = GST_TIMECODEOVERLAY (filter);
+
+  if (!gst_timecode_format_init (&overlay->format, in_info)) {
+    GST_ERROR_OBJECT (overlay, "Unsupported format %s",
+        GST_VIDEO_INFO_NAME (in_info));
+    return FALSE;
+  }
+
+  gst_timecodelog_set_video_info (overlay->log, GST_VIDEO_INFO_WIDTH (in_info),
+      GST_VIDEO_INFO_HEIGHT (in_info), GST_VIDEO_INFO_FPS_N (in_info),
+      GST_VIDEO_INFO_FPS_D (in_info));
+  gst_timecodeoverlay_update_layout (overlay, in_info);
+  g_atomic_int_set (&overlay->meta_query_pending, TRUE);
+  return TRUE;
+}
+
+/* Runs on the log writer thread */
+static gint
+gst_timecodeoverlay_format_record (const GsttimecodelogRecord *record,
+    const gchar *ts, gchar *buf, gsize size)
+{
+  return g_snprintf (buf, size, fmt_string, ts, record->frame_nr,
+      record->time_s, record->sec_offset, record->clock_offset,
+      record->clock_error);
+}
+
+static void
+gst_timecodeoverlay_set_feedback (Gsttimecodeoverlay * overlay,
+    const GsttimecodeFeedback * feedback)
+{
+  GST_OBJECT_LOCK (overlay);
+  overlay->feedback = *feedback;
+  overlay->have_feedback = TRUE;
+  gst_timecode_sampler_update (&overlay->sampler, feedback->latency,
+      feedback->loss, gst_timecodelog_realtime ());
+  GST_OBJECT_UNLOCK (overlay);
+
+  GST_LOG_OBJECT (overlay, "Feedback up to frame %lu: latency %ld µs, loss %f",
+      feedback->frame_nr, feedback->latency, feedback->loss);
+  g_signal_emit (overlay, signals[SIGNAL_FEEDBACK], 0, feedback->latency,
+      feedback->loss);
 }
 
 static gboolean
 gst_timecodeoverlay_src_event (GstBaseTransform * basetransform, GstEvent * event)
 {
   Gsttimecodeoverlay *overlay = GST_TIMECODEOVERLAY (basetransform);
+  GsttimecodeFeedback feedback;
+
+  /* Passed on as well, an encoder upstream may want it too */
+  if (gst_timecode_feedback_event_parse (event, &feedback))
+    gst_timecodeoverlay_set_feedback (overlay, &feedback);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_RECONFIGURE)
+    g_atomic_int_set (&overlay->meta_query_pending, TRUE);
 
   if (GST_EVENT_TYPE (event) == GST_EVENT_LATENCY) {
     GstClockTime latency = GST_CLOCK_TIME_NONE;
@@ -195,23 +483,127 @@ gst_timecodeoverlay_set_property (GObject * object, guint prop_id,
   Gsttimecodeoverlay *filter = GST_TIMECODEOVERLAY (object);
 
   switch (prop_id) {
-    case PROP_LOCATION: {
-      gchar *path_old = filter->logfile_path;
-      FILE *logfile_old = filter->logfile;
-      gchar *path_new = g_value_dup_string (value);
-      FILE *logfile_new = g_fopen(path_new, "w");
-      if (!logfile_new) {
-        GST_ERROR_OBJECT (filter, "Failed opening logfile at %s", path_new);
-        return;
+    case PROP_LOCATION:
+      gst_timecodelog_set_location (filter->log, g_value_get_string (value));
+      break;
+    case PROP_LOG_FULL_POLICY:
+      gst_timecodelog_set_full_policy (filter->log, g_value_get_enum (value));
+      break;
+    case PROP_LOG_FORMAT:
+      gst_timecodelog_set_format (filter->log, g_value_get_enum (value));
+      break;
+    case PROP_ANCHOR:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.anchor = g_value_get_enum (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_X:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.margin_x = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_Y:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.margin_y = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_CELL_SIZE:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.cell_size = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK_CHANNEL:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->feedback_channel);
+      filter->feedback_channel = g_value_dup_string (value);
+      filter->feedback_seqnum = 0;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FIELDS:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.fields = g_value_get_flags (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_HOP:
+      GST_OBJECT_LOCK (filter);
+      filter->hop = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ENCODING:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.encoding = g_value_get_enum (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ALIGN: {
+      guint align = g_value_get_uint (value);
+      if (align & (align - 1)) {
+        GST_ELEMENT_WARNING (filter, LIBRARY, SETTINGS, (NULL),
+            ("align %u is not a power of two", align));
+        break;
       }
-      fputs(logfile_columns, logfile_new);
-      filter->logfile_path = path_new;
-      filter->logfile = logfile_new;
-      g_free(path_old);
-      if (logfile_old)
-        fclose(logfile_old);
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.align = align;
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
       break;
     }
+    case PROP_MODE:
+      GST_OBJECT_LOCK (filter);
+      filter->mode = g_value_get_enum (value);
+      g_atomic_int_set (&filter->meta_query_pending, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      gst_timecode_sampler_configure (&filter->sampler, g_value_get_uint (value),
+          filter->sampler.adaptive);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ADAPTIVE:
+      GST_OBJECT_LOCK (filter);
+      gst_timecode_sampler_configure (&filter->sampler, filter->sampler.max_interval,
+          g_value_get_boolean (value));
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_NET_CLOCK_ADDRESS:
+      gst_timecode_netclock_set_address (&filter->netclock, g_value_get_string (value));
+      break;
+    case PROP_NET_CLOCK_PORT:
+      gst_timecode_netclock_set_port (&filter->netclock, g_value_get_int (value));
+      break;
+    case PROP_NET_CLOCK_SERVE_PORT:
+      if (!gst_timecode_netclock_set_serve_port (&filter->netclock,
+              g_value_get_int (value)))
+        GST_ELEMENT_WARNING (filter, RESOURCE, OPEN_READ_WRITE, (NULL),
+            ("Failed to serve the wall clock on port %d", g_value_get_int (value)));
+      break;
+    case PROP_SHM_NAME:
+      if (!gst_timecodelog_set_shm_name (filter->log, g_value_get_string (value)))
+        GST_ELEMENT_WARNING (filter, RESOURCE, OPEN_WRITE, (NULL),
+            ("Failed to publish in shared memory %s", g_value_get_string (value)));
+      break;
+    case PROP_STREAM_ID:
+      gst_timecodelog_set_stream_id (filter->log, g_value_get_string (value));
+      break;
+    case PROP_LOG_COMPRESSION:
+      if (!gst_timecodelog_set_compression (filter->log, g_value_get_enum (value)))
+        GST_ELEMENT_WARNING (filter, LIBRARY, SETTINGS, (NULL),
+            ("Log compression %d is not available in this build",
+                g_value_get_enum (value)));
+      break;
+    case PROP_MAX_SIZE:
+      gst_timecodelog_set_max_size (filter->log, g_value_get_uint64 (value));
+      break;
+    case PROP_MAX_DURATION:
+      gst_timecodelog_set_max_duration (filter->log, g_value_get_uint64 (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -226,7 +618,117 @@ gst_timecodeoverlay_get_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_LOCATION:
-      g_value_set_string (value, filter->logfile_path);
+      g_value_take_string (value, gst_timecodelog_dup_location (filter->log));
+      break;
+    case PROP_LOG_FULL_POLICY:
+      g_value_set_enum (value, gst_timecodelog_get_full_policy (filter->log));
+      break;
+    case PROP_LOG_DROPPED:
+      g_value_set_uint64 (value, gst_timecodelog_get_dropped (filter->log));
+      break;
+    case PROP_LOG_FORMAT:
+      g_value_set_enum (value, gst_timecodelog_get_format (filter->log));
+      break;
+    case PROP_ANCHOR:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->geometry.anchor);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_X:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.margin_x);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_Y:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.margin_y);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_CELL_SIZE:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.cell_size);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK_CHANNEL:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->feedback_channel);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK_LATENCY:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_int64 (value, filter->have_feedback ? filter->feedback.latency : -1);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK_LOSS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_double (value, filter->have_feedback ? filter->feedback.loss : 0);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FIELDS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_flags (value, filter->geometry.fields);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_HOP:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->hop);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ENCODING:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->geometry.encoding);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ALIGN:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.align);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MODE:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->mode);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->sampler.max_interval);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ADAPTIVE:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_boolean (value, filter->sampler.adaptive);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_CURRENT_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->sampler.interval);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_NET_CLOCK_ADDRESS:
+      g_value_take_string (value,
+          gst_timecode_netclock_dup_address (&filter->netclock));
+      break;
+    case PROP_NET_CLOCK_PORT:
+      g_value_set_int (value, gst_timecode_netclock_get_port (&filter->netclock));
+      break;
+    case PROP_NET_CLOCK_SERVE_PORT:
+      g_value_set_int (value,
+          gst_timecode_netclock_get_serve_port (&filter->netclock));
+      break;
+    case PROP_SHM_NAME:
+      g_value_take_string (value, gst_timecodelog_dup_shm_name (filter->log));
+      break;
+    case PROP_STREAM_ID:
+      g_value_take_string (value, gst_timecodelog_dup_stream_id (filter->log));
+      break;
+    case PROP_LOG_COMPRESSION:
+      g_value_set_enum (value, gst_timecodelog_get_compression (filter->log));
+      break;
+    case PROP_MAX_SIZE:
+      g_value_set_uint64 (value, gst_timecodelog_get_max_size (filter->log));
+      break;
+    case PROP_MAX_DURATION:
+      g_value_set_uint64 (value, gst_timecodelog_get_max_duration (filter->log));
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -234,106 +736,341 @@ gst_timecodeoverlay_get_property (GObject * object, guint prop_id,
   }
 }
 
-static gchar
-*get_ts()
+/* Neutral chroma under the code only serves the chroma check of the binary
+ * encoding. The dense one is protected by its CRC, so the chroma planes are
+ * left alone. */
+static guint
+gst_timecodeoverlay_n_neutral (Gsttimecodeoverlay * overlay)
 {
-  GDateTime *dt = g_date_time_new_now_utc();
-  if (dt == NULL)
-    return NULL;
-  gchar *ts = g_date_time_format(dt, "%Y-%m-%d %H:%M:%S");
-  int ms = g_date_time_get_microsecond(dt);
-  int size = sizeof("2011-10-08 07:07:09.000000Z");
-  char *buf = malloc(size);
-  g_snprintf(buf, size, "%s.%06dZ", ts, ms);
-  g_free(ts);
-  g_date_time_unref(dt);
-  return buf;
+  if (overlay->layout.encoding == GST_TIMECODE_ENCODING_DENSE)
+    return 0;
+  return overlay->format.n_neutral;
 }
 
+/* Every pixel row of a word is the same, so the word is rendered once into
+ * code_line with the fill kernel of the negotiated format and then copied to
+ * all rows of the word's layout row. In the binary encoding the other planes
+ * are set to neutral chroma, once per row of theirs the word covers. With
+ * two bits per cell the symbols are Gray coded onto the four levels, see
+ * gst_timecode_decode_word(). */
 static void
-draw_timestamp(int lineoffset, GstClockTime timestamp, Gsttimecodeoverlay *overlay, GstVideoFrame *frame)
+draw_timestamp(int lineoffset, GstClockTime timestamp, Gsttimecodeoverlay *overlay,
+    const GsttimecodeRegion *region)
 {
-  guchar *y = frame->data[0];
-  guchar *u = y + frame->info.offset[1];
-  guchar *v = y + frame->info.offset[2];
-
-  // TODO: Should be properties
-  guint y_pos = 52;
-  guint x_pos = 1920 - 896;
-  guint pxsize = 16; // 1
-
-  guint y_offset = (y_pos + lineoffset * pxsize) * frame->info.stride[0]   + x_pos*8;
-  guint u_offset = (y_pos + lineoffset * pxsize) * frame->info.stride[1]/2 + x_pos*4;
-  guint v_offset = (y_pos + lineoffset * pxsize) * frame->info.stride[2]/2 + x_pos*4;
-
-  for (int line = 0; line < pxsize; line++) {
-    if (line % 2 == 0) {
-      memset(u + u_offset + frame->info.stride[1] * (line/2-2), 128, pxsize/2 * 64);
-      memset(v + v_offset + frame->info.stride[2] * (line/2-2), 128, pxsize/2 * 64);
-    }
-    for (int bit = 0; bit < 64; bit++) {
-      char y_color = ((timestamp >> (63 - bit)) & 1) * 255;
-      memset(y + y_offset + frame->info.stride[0] * line + bit * pxsize, y_color, pxsize);
-    }
+  const GsttimecodeFormat *format = &overlay->format;
+  const GsttimecodeLayout *layout = &overlay->layout;
+  const GsttimecodePlane *code = &format->code;
+
+  guint x0 = layout->x[0];
+  guint x_end = layout->x[layout->cells];
+  guint line_size = (x_end - x0) * code->pixel_size;
+  if (overlay->code_line_size < line_size) {
+    g_free (overlay->code_line);
+    overlay->code_line = g_malloc (line_size);
+    overlay->code_line_size = line_size;
+  }
+
+  guint8 *code_line = overlay->code_line;
+  guint bits = layout->bits_per_cell;
+  for (guint cell = 0; cell < layout->cells; cell++) {
+    guint symbol = (timestamp >> (64 - bits * (cell + 1))) & ((1 << bits) - 1);
+    guint level = bits == 1 ? symbol * (GST_TIMECODE_LEVELS - 1) : symbol ^ (symbol >> 1);
+    code->fill (code_line + (layout->x[cell] - x0) * code->pixel_size,
+        format->levels[level], layout->x[cell + 1] - layout->x[cell]);
+  }
+
+  guint8 *data = region->data[code->plane];
+  gint stride = region->stride[code->plane];
+  for (guint line = layout->y[lineoffset]; line < layout->y[lineoffset + 1]; line++)
+    memcpy(data + line * stride + x0 * code->pixel_size, code_line, line_size);
+
+  // Rows of subsampled planes are split between words by rounding up, so
+  // rows shared by two words are written once.
+  for (guint n = 0; n < gst_timecodeoverlay_n_neutral (overlay); n++) {
+    const GsttimecodePlane *plane = &format->neutral[n];
+    guint first = GST_VIDEO_SUB_SCALE (plane->h_sub, layout->y[lineoffset]);
+    guint last = GST_VIDEO_SUB_SCALE (plane->h_sub, layout->y[lineoffset + 1]);
+    guint x = x0 >> plane->w_sub;
+    guint width = GST_VIDEO_SUB_SCALE (plane->w_sub, x_end) - x;
+
+    data = region->data[plane->plane];
+    stride = region->stride[plane->plane];
+    for (guint line = first; line < last; line++)
+      plane->fill (data + line * stride + x * plane->pixel_size,
+          format->neutral_pixel[n], width);
   }
 }
 
 
-/* this function does the actual processing
- */
-static GstFlowReturn
-gst_timecodeoverlay_transform_frame_ip (GstVideoFilter * filter, GstVideoFrame * frame)
+/* Converts a time of the pipeline clock to µs since sec_offset, given that
+ * the clock read now when the wall clock read time_ms */
+static guint64
+clock_to_realtime (GstClockTime t, GstClockTime now, guint64 time_ms)
 {
-  Gsttimecodeoverlay *overlay = GST_TIMECODEOVERLAY (filter);
+  if (!GST_CLOCK_TIME_IS_VALID (t) || !GST_CLOCK_TIME_IS_VALID (now))
+    return 0;
+  gint64 realtime = (gint64) time_ms + GST_CLOCK_DIFF (now, t) / 1000;
+  return MAX (realtime, 0);
+}
+
+/* Fills values, indexed by field bit, with the optional timing fields */
+static void
+get_fields (Gsttimecodeoverlay *overlay, GstBuffer *buffer,
+    GstClockTime latency, guint64 time_ms, guint64 values[GST_TIMECODE_N_FIELDS])
+{
+  GstSegment *segment = &GST_BASE_TRANSFORM (overlay)->segment;
+  GstClockTime buffer_time = GST_BUFFER_TIMESTAMP (buffer);
+  GstClockTime stream_time = gst_segment_to_stream_time (segment, GST_FORMAT_TIME, buffer_time);
+  GstClockTime running_time = gst_segment_to_running_time (segment, GST_FORMAT_TIME, buffer_time);
+  GstClockTime clock_time = GST_CLOCK_TIME_NONE;
+  GstClockTime render_time = GST_CLOCK_TIME_NONE;
+  GstClockTime now = GST_CLOCK_TIME_NONE;
+
+  GstClock *clock = gst_element_get_clock (GST_ELEMENT (overlay));
+  if (clock) {
+    now = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+    if (GST_CLOCK_TIME_IS_VALID (running_time))
+      clock_time = running_time + gst_element_get_base_time (GST_ELEMENT (overlay));
+  }
+
+  // The sink renders the frame latency after its clock time
+  render_time = clock_time;
+  if (GST_CLOCK_TIME_IS_VALID (clock_time) && GST_CLOCK_TIME_IS_VALID (latency))
+    render_time = clock_time + latency;
+
+  values[0] = buffer_time;
+  values[1] = stream_time;
+  values[2] = running_time;
+  values[3] = clock_to_realtime (clock_time, now, time_ms);
+  values[4] = clock_to_realtime (render_time, now, time_ms);
+}
+
+
+/* Asks downstream whether it takes the meta, which timecodeparse announces
+ * in the allocation query. A tee only keeps metas all its branches take, so
+ * a branch through an encoder keeps the pixels. */
+static gboolean
+gst_timecodeoverlay_query_meta (Gsttimecodeoverlay * overlay)
+{
+  GstPad *srcpad = GST_BASE_TRANSFORM_SRC_PAD (overlay);
+  GstCaps *caps = gst_pad_get_current_caps (srcpad);
+  gboolean ret = FALSE;
+
+  if (!caps)
+    return FALSE;
+
+  GstQuery *query = gst_query_new_allocation (caps, FALSE);
+  if (gst_pad_peer_query (srcpad, query))
+    ret = gst_query_find_allocation_meta (query, GST_TIMECODE_META_API_TYPE, NULL);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  GST_INFO_OBJECT (overlay, "Downstream %s the timecode meta",
+      ret ? "takes" : "does not take");
+  return ret;
+}
+
+/* Draws the code into the mapped rows */
+static void
+gst_timecodeoverlay_draw (Gsttimecodeoverlay * overlay,
+    const GsttimecodeRegion * region, guint fields, guint interval_log2,
+    guint64 time_ms, const guint64 values[GST_TIMECODE_N_FIELDS])
+{
+  if (overlay->layout.encoding == GST_TIMECODE_ENCODING_DENSE) {
+    GsttimecodeDense dense = {
+      .fields = fields,
+      .interval_log2 = interval_log2,
+      .sec_offset = overlay->sec_offset,
+      .time_s = time_ms,
+      .frame_nr = overlay->frame_nr++,
+    };
+    guint64 words[GST_TIMECODE_DENSE_ROWS];
+    memcpy (dense.values, values, sizeof (dense.values));
+    guint n_rows = gst_timecode_dense_pack (&dense, words);
+    for (guint row = 0; row < n_rows; row++)
+      draw_timestamp (row, words[row], overlay, region);
+    return;
+  }
+
+  for (guint i = 0; i < GST_TIMECODE_N_FIELDS; i++)
+    if (fields & (1 << i))
+      draw_timestamp (gst_timecode_field_row (fields, 1 << i), values[i], overlay, region);
 
-  GstClockTime buffer_time = GST_BUFFER_TIMESTAMP (frame->buffer);
+  draw_timestamp(5, overlay->sec_offset | (guint64) fields << GST_TIMECODE_FIELDS_SHIFT |
+                 (guint64) interval_log2 << GST_TIMECODE_INTERVAL_SHIFT, overlay, region);
+  draw_timestamp(6, time_ms, overlay, region);
+  draw_timestamp(7, overlay->frame_nr++, overlay, region);
+}
+
+/* Stamps buffer. With draw the code is drawn into it, otherwise it is
+ * attached as meta. */
+static GstFlowReturn
+gst_timecodeoverlay_stamp (Gsttimecodeoverlay * overlay, GstBuffer * buffer,
+    gboolean draw)
+{
+  GstClockTime buffer_time = GST_BUFFER_TIMESTAMP (buffer);
+  const GstVideoInfo *info = &GST_VIDEO_FILTER (overlay)->in_info;
 
   if (!GST_CLOCK_TIME_IS_VALID (buffer_time)) {
     GST_DEBUG_OBJECT (overlay, "Can't draw timestamps: buffer timestamp is invalid");
     return GST_FLOW_OK;
   }
 
-  if (frame->info.stride[0] < (8 * frame->info.finfo->pixel_stride[0] * 64)) {
-    GST_WARNING_OBJECT (overlay, "Can't draw timestamps: video-frame is to narrow");
+  /* The offset of a client clock is only known once it is synced */
+  if (!gst_timecode_netclock_synced (&overlay->netclock)) {
+    GST_DEBUG_OBJECT (overlay, "Can't draw timestamps: net clock is not synced");
     return GST_FLOW_OK;
   }
 
-  /* GstSegment *segment = &GST_BASE_TRANSFORM (overlay)->segment; */
-  /* GstClockTime stream_time = gst_segment_to_stream_time (segment, GST_FORMAT_TIME, buffer_time); */
-  /* GstClockTime running_time = gst_segment_to_running_time (segment, GST_FORMAT_TIME, buffer_time); */
-  /* GstClockTime clock_time = running_time + gst_element_get_base_time (GST_ELEMENT (overlay)); */
+  GsttimecodeFeedback feedback;
+  gboolean have_feedback = FALSE;
+  GST_OBJECT_LOCK (overlay);
+  if (overlay->feedback_channel)
+    have_feedback = gst_timecode_feedback_poll (overlay->feedback_channel,
+        &overlay->feedback_seqnum, &feedback);
+  guint fields = overlay->geometry.fields;
+  guint hop = overlay->hop;
+  GstClockTime latency = overlay->latency;
+  guint interval = overlay->sampler.interval;
+  GST_OBJECT_UNLOCK (overlay);
+  if (have_feedback)
+    gst_timecodeoverlay_set_feedback (overlay, &feedback);
 
-  /* GstClockTime latency = overlay->latency; */
-  /* GstClockTime render_time = clock_time; */
-  /* if (GST_CLOCK_TIME_IS_VALID (latency)) */
-  /*   render_time = clock_time + latency; */
+  GsttimecodeMeta *meta = NULL;
+  if (!draw && !(meta = gst_timecode_meta_add (buffer, hop))) {
+    GST_WARNING_OBJECT (overlay, "Failed to attach the meta, drawing the code");
+    draw = TRUE;
+  }
 
-  /* draw_timestamp (0, buffer_time, overlay, frame); */
-  /* draw_timestamp (1, stream_time, overlay, frame); */
-  /* draw_timestamp (2, running_time, overlay, frame); */
-  /* draw_timestamp (3, clock_time, overlay, frame); */
-  /* draw_timestamp (4, render_time, overlay, frame); */
-  struct timeval tv;
-  gettimeofday(&tv,NULL);
-  guint64 time_ms = 1000000 * (tv.tv_sec - overlay->sec_offset) + tv.tv_usec;
+  if (draw && g_atomic_int_get (&overlay->layout_dirty))
+    gst_timecodeoverlay_update_layout (overlay, info);
 
-  gchar *ts = get_ts();
+  if (draw && !overlay->layout_valid) {
+    GST_DEBUG_OBJECT (overlay, "Can't draw timestamps: code does not fit");
+    return GST_FLOW_OK;
+  }
+
+  /* A dense block only has rows for the fields it was laid out with, and
+   * the property may have been set again since it was read */
+  if (draw && overlay->layout.encoding == GST_TIMECODE_ENCODING_DENSE)
+    fields = overlay->layout.fields;
+
+  /* Only the rows of the block and the planes drawn into are mapped */
+  GsttimecodeRegion region;
+  if (draw) {
+    const GsttimecodeFormat *format = &overlay->format;
+    guint planes = 1 << format->code.plane;
+    for (guint n = 0; n < gst_timecodeoverlay_n_neutral (overlay); n++)
+      planes |= 1 << format->neutral[n].plane;
+
+    if (!gst_timecode_region_map (&region, buffer, info, planes,
+            overlay->layout.y[0], overlay->layout.y[overlay->layout.rows],
+            GST_MAP_WRITE)) {
+      GST_ELEMENT_WARNING (overlay, CORE, NOT_IMPLEMENTED, (NULL),
+          ("invalid video buffer received"));
+      return GST_FLOW_OK;
+    }
+  }
+
+  overlay->until_stamp = interval - 1;
+  guint interval_log2 = gst_timecode_sampler_log2 (interval);
+
+  gint64 clock_offset, clock_error;
+  gint64 realtime = gst_timecode_netclock_realtime (&overlay->netclock,
+      &clock_offset, &clock_error);
+  /* Taken from the clock stamped with, so time_ms never runs below it */
+  if (overlay->sec_offset == 0)
+    overlay->sec_offset = realtime / G_USEC_PER_SEC;
+  guint64 time_ms = realtime - overlay->sec_offset * G_USEC_PER_SEC;
 
+  GsttimecodelogRecord record = {
+    .realtime = realtime,
+    .frame_nr = overlay->frame_nr,
+    .time_s = time_ms,
+    .sec_offset = overlay->sec_offset,
+    .hop = hop,
+    .hop_delta = -1,
+    .clock_offset = clock_offset,
+    .clock_error = clock_error,
+    .render_latency = -1,
+  };
+  gst_timecodelog_push (overlay->log, &record);
 
-  #define LOG_LINE_LEN 256
-  char log_line[LOG_LINE_LEN] = {0};
-  snprintf (log_line, LOG_LINE_LEN, fmt_string, ts, overlay->frame_nr, time_ms, overlay->sec_offset);
-  GST_LOG_OBJECT (overlay,          fmt_string, ts, overlay->frame_nr, time_ms, overlay->sec_offset);
-  fputs(log_line, overlay->logfile);
-  g_free(ts);
+  guint64 values[GST_TIMECODE_N_FIELDS] = { 0 };
+  if (fields)
+    get_fields (overlay, buffer, latency, time_ms, values);
 
-  draw_timestamp(5, overlay->sec_offset, overlay, frame);
-  draw_timestamp(6, time_ms, overlay, frame);
-  draw_timestamp(7, overlay->frame_nr++, overlay, frame);
+  if (draw) {
+    gst_timecodeoverlay_draw (overlay, &region, fields, interval_log2, time_ms,
+        values);
+    gst_timecode_region_unmap (&region);
+    /* The tracer cannot read the pixels */
+    if (gst_timecode_trace_active ())
+      gst_timecode_trace_meta_add (buffer, record.sec_offset, record.frame_nr);
+    return GST_FLOW_OK;
+  }
 
+  meta->fields = fields;
+  meta->interval_log2 = interval_log2;
+  meta->sec_offset = overlay->sec_offset;
+  meta->time_s = time_ms;
+  meta->frame_nr = overlay->frame_nr++;
+  memcpy (meta->values, values, sizeof (values));
   return GST_FLOW_OK;
 }
 
+/* this function does the actual processing. GstVideoFilter would map the
+ * whole frame, so the element maps the rows it draws into itself. Attaching
+ * the meta does not touch the pixels at all; a buffer upstream still holds
+ * is then only copied shallowly by GstBaseTransform, sharing the memory
+ * instead of copying the frame. */
+static GstFlowReturn
+gst_timecodeoverlay_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  Gsttimecodeoverlay *overlay = GST_TIMECODEOVERLAY (trans);
+
+  if (!GST_VIDEO_FILTER (trans)->negotiated) {
+    GST_ELEMENT_ERROR (overlay, CORE, NOT_IMPLEMENTED, (NULL), ("unknown format"));
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  /* Frames between two sampled ones are passed on untouched */
+  if (overlay->until_stamp > 0) {
+    overlay->until_stamp--;
+    overlay->frame_nr++;
+    return GST_FLOW_OK;
+  }
+
+  GST_OBJECT_LOCK (overlay);
+  GsttimecodeMode mode = overlay->mode;
+  GST_OBJECT_UNLOCK (overlay);
+
+  if (mode == GST_TIMECODE_MODE_AUTO &&
+      g_atomic_int_compare_and_exchange (&overlay->meta_query_pending, TRUE, FALSE))
+    overlay->downstream_meta = gst_timecodeoverlay_query_meta (overlay);
+
+  gboolean use_meta = mode == GST_TIMECODE_MODE_META ||
+      (mode == GST_TIMECODE_MODE_AUTO && overlay->downstream_meta);
+  return gst_timecodeoverlay_stamp (overlay, buf, !use_meta);
+}
+
+/* The net clock client is applied here rather than in the setters, so
+ * setting its address and port makes one client clock */
+static gboolean
+gst_timecodeoverlay_start (GstBaseTransform * trans)
+{
+  gst_timecode_netclock_start (&GST_TIMECODEOVERLAY (trans)->netclock);
+  return TRUE;
+}
+
+static gboolean
+gst_timecodeoverlay_stop (GstBaseTransform * trans)
+{
+  gst_timecode_netclock_stop (&GST_TIMECODEOVERLAY (trans)->netclock);
+  return TRUE;
+}
+
 
 /* entry point to initialize the plug-in
  * initialize the plug-in itself
@@ -342,6 +1079,7 @@ gst_timecodeoverlay_transform_frame_ip (GstVideoFilter * filter, GstVideoFrame *
 static gboolean
 timecodeoverlay_init (GstPlugin * timecodeoverlay)
 {
+  gst_timecodelog_init ();
   return GST_ELEMENT_REGISTER (timecodeoverlay, timecodeoverlay);
 }
 
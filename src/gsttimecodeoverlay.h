@@ -26,6 +26,14 @@
 #include <gst/gst.h>
 #include <gst/video/gstvideofilter.h>
 
+#include "gsttimecodelog.h"
+#include "gsttimecodelayout.h"
+#include "gsttimecodeformat.h"
+#include "gsttimecodefeedback.h"
+#include "gsttimecodemeta.h"
+#include "gsttimecodenetclock.h"
+#include "gsttimecodesampler.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_TIMECODEOVERLAY (gst_timecodeoverlay_get_type())
@@ -35,12 +43,50 @@ G_DECLARE_FINAL_TYPE (Gsttimecodeoverlay, gst_timecodeoverlay,
 struct _Gsttimecodeoverlay {
   GstVideoFilter element;
 
-  FILE *logfile;
-  gchar *logfile_path;
+  Gsttimecodelog *log;
+
+  /* The negotiated format, set in set_info */
+  GsttimecodeFormat format;
+
+  /* geometry, which holds the GsttimecodeFields to draw, and hop are
+   * protected by the object lock. Setting them raises layout_dirty, and the
+   * streaming thread recomputes layout. */
+  GsttimecodeGeometry geometry;
+  guint hop;
+  GsttimecodeLayout layout;
+  gboolean layout_valid;
+  gint layout_dirty;
+
+  /* GsttimecodeMode, protected by the object lock. In auto mode the
+   * streaming thread asks downstream whether it reads the meta whenever
+   * meta_query_pending is raised. */
+  GsttimecodeMode mode;
+  gint meta_query_pending;
+  gboolean downstream_meta;
 
+  /* Only every sampler.interval-th frame is stamped, the sampler is
+   * protected by the object lock. until_stamp counts down the frames that
+   * are passed on untouched, which still count in frame_nr. */
+  GsttimecodeSampler sampler;
+  guint until_stamp;
+
+  /* One pixel row of an encoded word, see draw_timestamp() */
+  guint8 *code_line;
+  gsize code_line_size;
+
+  /* Last feedback from timecodeparse, protected by the object lock */
+  gchar *feedback_channel;
+  guint64 feedback_seqnum;
+  GsttimecodeFeedback feedback;
+  gboolean have_feedback;
+
+  /* The pipeline latency, protected by the object lock */
   GstClockTime latency;
   guint64 sec_offset;
   guint64 frame_nr;
+
+  /* The wall clock the stamps are taken from */
+  GsttimecodeNetclock netclock;
 };
 
 G_END_DECLS
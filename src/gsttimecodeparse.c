@@ -39,11 +39,14 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
-#include <sys/time.h>
-#include <time.h>
+#include <gst/base/gstbasesink.h>
 #include <glib/gstdio.h>
 
 #include "gsttimecodeparse.h"
+#include "gsttimecodebinlog.h"
+#include "gsttimecodedecode.h"
+#include "gsttimecodefeedback.h"
+#include "gsttimecodemeta.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_timecodeparse_debug);
 #define GST_CAT_DEFAULT gst_timecodeparse_debug
@@ -53,26 +56,78 @@ GST_DEBUG_CATEGORY_STATIC (gst_timecodeparse_debug);
 enum
 {
   PROP_0,
-  PROP_LOCATION
+  PROP_LOCATION,
+  PROP_LOG_FULL_POLICY,
+  PROP_LOG_DROPPED,
+  PROP_LOG_FORMAT,
+  PROP_MIN_CONFIDENCE,
+  PROP_ANCHOR,
+  PROP_MARGIN_X,
+  PROP_MARGIN_Y,
+  PROP_CELL_SIZE,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_GAP_THRESHOLD,
+  PROP_FEEDBACK,
+  PROP_FEEDBACK_CHANNEL,
+  PROP_HOPS,
+  PROP_ENCODING,
+  PROP_ALIGN,
+  PROP_FIELDS,
+  PROP_INTERVAL,
+  PROP_ADAPTIVE,
+  PROP_CURRENT_INTERVAL,
+  PROP_NET_CLOCK_ADDRESS,
+  PROP_NET_CLOCK_PORT,
+  PROP_NET_CLOCK_SERVE_PORT,
+  PROP_MEASURE_AT,
+  PROP_SHM_NAME,
+  PROP_STREAM_ID,
+  PROP_LOG_COMPRESSION,
+  PROP_MAX_SIZE,
+  PROP_MAX_DURATION,
 };
 
 static const char *default_path = "/tmp/gsttime_rcvr.csv";
+#define DEFAULT_STATS_INTERVAL 1000
+#define DEFAULT_GAP_THRESHOLD 1
+
+/* The stages a frame's latency is broken down into, see measure(). With
+ * measure-at=render decode-to-render is measured by the render probe,
+ * otherwise it is estimated from the pipeline latency. */
+enum
+{
+  COMPONENT_CAPTURE_TO_OVERLAY,
+  COMPONENT_OVERLAY_TO_NETWORK,
+  COMPONENT_NETWORK_TO_DECODE,
+  COMPONENT_DECODE_TO_RENDER,
+};
+
+static const gchar *component_names[GST_TIMECODEPARSE_N_COMPONENTS] = {
+  "capture-to-overlay",
+  "overlay-to-network",
+  "network-to-decode",
+  "decode-to-render",
+};
+
+/* Weight of a new sample in the smoothed feedback values, as for the TCP
+ * round-trip time */
+#define FEEDBACK_LATENCY_GAIN (1.0 / 8)
+#define FEEDBACK_LOSS_GAIN (1.0 / 16)
 
-static const char *logfile_columns = "ts\tframe_nr\tlatency\ttime_s\ttime_p\tsec_offset\n";
-static const char *fmt_string = "%s\t%lu\t%ld\t%lu\t%lu\t%lu\n";
 
 /* the capabilities of the inputs and outputs.
  */
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("video/x-raw, format=(string) { I420 }")
+    GST_STATIC_CAPS (GST_TIMECODE_VIDEO_CAPS)
 );
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("video/x-raw, format=(string) { I420 }")
+    GST_STATIC_CAPS (GST_TIMECODE_VIDEO_CAPS)
 );
 
 #define gst_timecodeparse_parent_class parent_class
@@ -86,8 +141,38 @@ static void gst_timecodeparse_set_property (GObject * object,
 static void gst_timecodeparse_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec);
 static void gst_timecodeparse_dispose (GObject *object);
-static GstFlowReturn gst_timecodeparse_transform_frame_ip (GstVideoFilter * filter,
-                                                           GstVideoFrame * frame);
+static void gst_timecodeparse_finalize (GObject *object);
+static gboolean gst_timecodeparse_set_info (GstVideoFilter * filter,
+    GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
+    GstVideoInfo * out_info);
+static GstFlowReturn gst_timecodeparse_transform_ip (GstBaseTransform * trans,
+                                                     GstBuffer * buf);
+static gboolean gst_timecodeparse_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query);
+static gboolean gst_timecodeparse_start (GstBaseTransform * trans);
+static gboolean gst_timecodeparse_stop (GstBaseTransform * trans);
+static void gst_timecodeparse_unwatch_render (Gsttimecodeparse * overlay);
+
+GType
+gst_timecodeparse_measure_at_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_TIMECODEPARSE_MEASURE_AT_DECODE, "When the frame passes timecodeparse",
+        "decode"},
+    {GST_TIMECODEPARSE_MEASURE_AT_RENDER, "When the sink downstream shows the frame",
+        "render"},
+    {0, NULL, NULL},
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType t = g_type_from_name ("GsttimecodeparseMeasureAt");
+    if (!t)
+      t = g_enum_register_static ("GsttimecodeparseMeasureAt", values);
+    g_once_init_leave (&type, t);
+  }
+  return type;
+}
 
 /* GObject vmethod implementations */
 
@@ -105,10 +190,151 @@ gst_timecodeparse_class_init (GsttimecodeparseClass * klass)
   gobject_class->get_property = gst_timecodeparse_get_property;
 
   gobject_class->dispose = gst_timecodeparse_dispose;
+  gobject_class->finalize = gst_timecodeparse_finalize;
 
   g_object_class_install_property (gobject_class, PROP_LOCATION,
-      g_param_spec_string ("location", "Location", "Path to log file", default_path,
+      g_param_spec_string ("location", "Location",
+                           "Path to log file, shared by the elements of the process "
+                           "that write to the same path", default_path,
                            G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE));
+  g_object_class_install_property (gobject_class, PROP_LOG_FULL_POLICY,
+      g_param_spec_enum ("log-full-policy", "Log full policy",
+                         "What to do when the log writer falls behind",
+                         GST_TYPE_TIMECODELOG_FULL_POLICY, GST_TIMECODELOG_FULL_POLICY_DROP,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_LOG_DROPPED,
+      g_param_spec_uint64 ("log-dropped", "Log dropped",
+                           "Number of log records dropped because the writer fell behind",
+                           0, G_MAXUINT64, 0, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_LOG_FORMAT,
+      g_param_spec_enum ("log-format", "Log format",
+                         "Format of the log file",
+                         GST_TYPE_TIMECODELOG_FORMAT, GST_TIMECODELOG_FORMAT_TEXT,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MIN_CONFIDENCE,
+      g_param_spec_uint ("min-confidence", "Minimum confidence",
+                         "Discard words whose least certain bit is closer to mid-grey than this "
+                         "(0-100, binary encoding only)",
+                         0, 100, GST_TIMECODE_READER_DEFAULT_MIN_CONFIDENCE,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ANCHOR,
+      g_param_spec_enum ("anchor", "Anchor",
+                         "Corner of the frame the code is placed relative to",
+                         GST_TYPE_TIMECODE_ANCHOR, GST_TIMECODE_ANCHOR_TOP_LEFT,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MARGIN_X,
+      g_param_spec_uint ("margin-x", "Margin X",
+                         "Horizontal distance of the code from the anchor corner, "
+                         "in 1920x1080 reference pixels if cell-size is 0",
+                         0, G_MAXINT, GST_TIMECODE_DEFAULT_MARGIN_X, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MARGIN_Y,
+      g_param_spec_uint ("margin-y", "Margin Y",
+                         "Vertical distance of the code from the anchor corner, "
+                         "in 1920x1080 reference pixels if cell-size is 0",
+                         0, G_MAXINT, GST_TIMECODE_DEFAULT_MARGIN_Y, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_CELL_SIZE,
+      g_param_spec_uint ("cell-size", "Cell size",
+                         "Edge length of one bit in pixels (0 = scale with the frame size)",
+                         0, 256, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+                          "Latency distribution (in µs), decode failures and lost frames",
+                          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+                         "Post the statistics as element message every this many ms (0 = never)",
+                         0, G_MAXUINT, DEFAULT_STATS_INTERVAL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_GAP_THRESHOLD,
+      g_param_spec_uint ("gap-threshold", "Gap threshold",
+                         "Post a message when at least this many consecutive frames are missing (0 = never)",
+                         0, G_MAXUINT, DEFAULT_GAP_THRESHOLD, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_FEEDBACK,
+      g_param_spec_boolean ("feedback", "Feedback",
+                            "Send the smoothed latency and loss upstream in a custom event "
+                            "for timecodeoverlay", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_FEEDBACK_CHANNEL,
+      g_param_spec_string ("feedback-channel", "Feedback channel",
+                           "Also publish the feedback on this in-process channel, for a "
+                           "timecodeoverlay in another pipeline", NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_HOPS,
+      g_param_spec_uint ("hops", "Hops",
+                         "Number of code blocks to read, one per chained timecodeoverlay "
+                         "(see its hop property)",
+                         1, GST_TIMECODE_MAX_HOPS, 1, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ENCODING,
+      g_param_spec_enum ("encoding", "Encoding",
+                         "How the words are drawn into the cells",
+                         GST_TYPE_TIMECODE_ENCODING, GST_TIMECODE_ENCODING_BINARY,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ALIGN,
+      g_param_spec_uint ("align", "Align",
+                         "Snap the code to codec blocks of this size, a power of two such as "
+                         "16 for H.264 or 64 for HEVC and AV1 (0 = off)",
+                         0, GST_TIMECODE_MAX_ALIGN, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_FIELDS,
+      g_param_spec_flags ("fields", "Fields",
+                          "Timing values the dense code carries, as set on "
+                          "timecodeoverlay, one row each",
+                          GST_TYPE_TIMECODE_FIELDS, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_INTERVAL,
+      g_param_spec_uint ("interval", "Interval",
+                         "Read only every Nth frame, rounded down to a power of two. A "
+                         "timecodeoverlay that samples itself is followed in any case",
+                         1, GST_TIMECODE_MAX_INTERVAL, 1, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ADAPTIVE,
+      g_param_spec_boolean ("adaptive", "Adaptive",
+                            "Read every frame while the latency jitters or frames are "
+                            "lost, and back off to interval while they are not",
+                            FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_CURRENT_INTERVAL,
+      g_param_spec_uint ("current-interval", "Current interval",
+                         "Frames from one read to the next, without the sender's interval",
+                         1, GST_TIMECODE_MAX_INTERVAL, 1, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_NET_CLOCK_ADDRESS,
+      g_param_spec_string ("net-clock-address", "Net clock address",
+                           "Stamp and measure with the wall clock of the GstNetTimeProvider "
+                           "at this address instead of the local one (NULL = local)",
+                           NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_NET_CLOCK_PORT,
+      g_param_spec_int ("net-clock-port", "Net clock port",
+                        "UDP port of the GstNetTimeProvider at net-clock-address",
+                        1, G_MAXUINT16, GST_TIMECODE_NETCLOCK_DEFAULT_PORT,
+                        G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_NET_CLOCK_SERVE_PORT,
+      g_param_spec_int ("net-clock-serve-port", "Net clock serve port",
+                        "Serve the local wall clock on this UDP port for the other "
+                        "element's net-clock-address (0 = off)",
+                        0, G_MAXUINT16, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SHM_NAME,
+      g_param_spec_string ("shm-name", "Shared memory name",
+                           "Also publish the log records live in the POSIX shared memory "
+                           "object of this name, see gsttimecodeshmring.h (NULL = off)",
+                           NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_STREAM_ID,
+      g_param_spec_string ("stream-id", "Stream ID",
+                           "Tags the log records, so elements can share a location "
+                           "(NULL = the element name)", NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_LOG_COMPRESSION,
+      g_param_spec_enum ("log-compression", "Log compression",
+                         "Compress the log file as it is written",
+                         GST_TYPE_TIMECODELOG_COMPRESSION, GST_TIMECODELOG_COMPRESSION_NONE,
+                         G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE,
+      g_param_spec_uint64 ("max-size", "Max size",
+                           "Continue the log in a new segment file once it has "
+                           "this many bytes on disk (0 = unlimited)",
+                           0, G_MAXUINT64, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_DURATION,
+      g_param_spec_uint64 ("max-duration", "Max duration",
+                           "Continue the log in a new segment file after this many "
+                           "nanoseconds (0 = unlimited)",
+                           0, G_MAXUINT64, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MEASURE_AT,
+      g_param_spec_enum ("measure-at", "Measure at",
+                         "When the receive time is taken. With render the sink downstream "
+                         "must be reachable through elements with one source pad",
+                         GST_TYPE_TIMECODEPARSE_MEASURE_AT, GST_TIMECODEPARSE_MEASURE_AT_DECODE,
+                         G_PARAM_READWRITE));
 
   gst_element_class_set_details_simple (gstelement_class,
       "timecodeparse",
@@ -123,14 +349,23 @@ gst_timecodeparse_class_init (GsttimecodeparseClass * klass)
 
   GST_BASE_TRANSFORM_CLASS (klass)->src_event =
       GST_DEBUG_FUNCPTR (gst_timecodeparse_src_event);
+  GST_BASE_TRANSFORM_CLASS (klass)->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_timecodeparse_transform_ip);
+  GST_BASE_TRANSFORM_CLASS (klass)->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_timecodeparse_propose_allocation);
+  GST_BASE_TRANSFORM_CLASS (klass)->start =
+      GST_DEBUG_FUNCPTR (gst_timecodeparse_start);
+  GST_BASE_TRANSFORM_CLASS (klass)->stop =
+      GST_DEBUG_FUNCPTR (gst_timecodeparse_stop);
 
-  GST_VIDEO_FILTER_CLASS (klass)->transform_frame_ip =
-      GST_DEBUG_FUNCPTR (gst_timecodeparse_transform_frame_ip);
+  GST_VIDEO_FILTER_CLASS (klass)->set_info =
+      GST_DEBUG_FUNCPTR (gst_timecodeparse_set_info);
 
   /* debug category for fltering log messages
    */
   GST_DEBUG_CATEGORY_INIT (gst_timecodeparse_debug, "timecodeparse", 0,
       "Parse the time code from frames");
+  GST_INFO ("Decoding with the %s kernel", gst_timecode_decode_kernel_name ());
 }
 
 /* initialize the new element
@@ -139,24 +374,110 @@ gst_timecodeparse_class_init (GsttimecodeparseClass * klass)
 static void
 gst_timecodeparse_init (Gsttimecodeparse * filter)
 {
-  char *path = malloc(sizeof(default_path));
-  strcpy(path, default_path);
-  filter->logfile_path = path;
-  filter->logfile = g_fopen(filter->logfile_path, "w");
-  if (!filter->logfile) {
-    GST_ERROR_OBJECT (filter, "Failed opening logfile at %s", filter->logfile_path);
-    return;
-  }
+  filter->log = gst_timecodelog_new (GST_OBJECT (filter),
+      GST_TIMECODE_BINLOG_KIND_RECEIVER, gst_timecode_reader_log_columns,
+      gst_timecode_reader_format_record);
+  gst_timecodelog_set_location (filter->log, default_path);
+
+  filter->geometry = (GsttimecodeGeometry) GST_TIMECODE_GEOMETRY_INIT;
+  filter->hops = 1;
+  filter->layout_valid = FALSE;
+  filter->layout_dirty = FALSE;
+  gst_timecode_reader_init (&filter->reader);
+
+  gst_timecodehistogram_reset (&filter->latency_hist);
+  for (guint i = 0; i < GST_TIMECODEPARSE_N_COMPONENTS; i++)
+    gst_timecodehistogram_reset (&filter->component_hist[i]);
+  filter->latency = GST_CLOCK_TIME_NONE;
+  filter->decode_failures = 0;
+  gst_timecodesequence_reset (&filter->sequence);
+  filter->gap_threshold = DEFAULT_GAP_THRESHOLD;
+  filter->stats_interval = DEFAULT_STATS_INTERVAL;
+  filter->next_stats = 0;
+
+  filter->feedback = FALSE;
+  filter->feedback_channel = NULL;
+  filter->have_smoothed = FALSE;
+
+  gst_timecode_sampler_configure (&filter->sampler, 1, FALSE);
+  filter->sender_interval = 1;
+  filter->skip = 0;
+  filter->passed = 0;
+  filter->resync = FALSE;
+
+  gst_timecode_netclock_init (&filter->netclock);
+
+  filter->measure_at = GST_TIMECODEPARSE_MEASURE_AT_DECODE;
+  gst_timecodehistogram_reset (&filter->render_latency_hist);
+  filter->render_sink = NULL;
+  filter->render_pad = NULL;
+  filter->render_probe = 0;
+  filter->render_searched = FALSE;
+  g_mutex_init (&filter->log_lock);
 }
 
 static void
 gst_timecodeparse_dispose (GObject *object)
 {
   Gsttimecodeparse *filter = GST_TIMECODEPARSE (object);
-  GST_INFO_OBJECT(filter, "Closing logfile");
-  g_free(filter->logfile_path);
-  if (filter->logfile)
-    fclose(filter->logfile);
+  gst_timecodeparse_unwatch_render (filter);
+  g_clear_pointer (&filter->log, gst_timecodelog_free);
+  g_clear_pointer (&filter->feedback_channel, g_free);
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+gst_timecodeparse_finalize (GObject *object)
+{
+  Gsttimecodeparse *filter = GST_TIMECODEPARSE (object);
+  gst_timecode_netclock_clear (&filter->netclock);
+  g_mutex_clear (&filter->log_lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/* Called from the streaming thread */
+static void
+gst_timecodeparse_update_layout (Gsttimecodeparse * overlay,
+    const GstVideoInfo * info)
+{
+  GsttimecodeGeometry geometry;
+  guint hops;
+
+  GST_OBJECT_LOCK (overlay);
+  geometry = overlay->geometry;
+  hops = overlay->hops;
+  g_atomic_int_set (&overlay->layout_dirty, FALSE);
+  GST_OBJECT_UNLOCK (overlay);
+
+  guint n_hops = gst_timecode_reader_set_layout (&overlay->reader, &geometry,
+      hops, GST_VIDEO_INFO_WIDTH (info), GST_VIDEO_INFO_HEIGHT (info));
+
+  overlay->layout_valid = n_hops > 0;
+  if (n_hops < hops)
+    GST_WARNING_OBJECT (overlay, "Can't read timestamps: code of hop %u does "
+        "not fit into %dx%d frames", n_hops,
+        GST_VIDEO_INFO_WIDTH (info), GST_VIDEO_INFO_HEIGHT (info));
+}
+
+static gboolean
+gst_timecodeparse_set_info (GstVideoFilter * filter, GstCaps * incaps,
+    GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
+{
+  Gsttimecodeparse *overlay = GST_TIMECODEPARSE (filter);
+
+  if (!gst_timecode_reader_set_format (&overlay->reader, in_info)) {
+    GST_ERROR_OBJECT (overlay, "Unsupported format %s",
+        GST_VIDEO_INFO_NAME (in_info));
+    return FALSE;
+  }
+
+  gst_timecodelog_set_video_info (overlay->log, GST_VIDEO_INFO_WIDTH (in_info),
+      GST_VIDEO_INFO_HEIGHT (in_info), GST_VIDEO_INFO_FPS_N (in_info),
+      GST_VIDEO_INFO_FPS_D (in_info));
+  gst_timecodeparse_update_layout (overlay, in_info);
+  return TRUE;
 }
 
 static gboolean
@@ -167,6 +488,9 @@ gst_timecodeparse_src_event (GstBaseTransform * basetransform, GstEvent * event)
   if (GST_EVENT_TYPE (event) == GST_EVENT_LATENCY) {
     GstClockTime latency = GST_CLOCK_TIME_NONE;
     gst_event_parse_latency (event, &latency);
+    GST_OBJECT_LOCK (overlay);
+    overlay->latency = latency;
+    GST_OBJECT_UNLOCK (overlay);
     GST_INFO_OBJECT (overlay, "Latency is now %f ms (%lu ns)", latency/1e6, latency);
   }
 
@@ -176,6 +500,177 @@ gst_timecodeparse_src_event (GstBaseTransform * basetransform, GstEvent * event)
       (basetransform, event);
 }
 
+/* Must be called with the object lock held */
+static GstStructure *
+gst_timecodeparse_create_stats (Gsttimecodeparse * overlay)
+{
+  const Gsttimecodehistogram *hist = &overlay->latency_hist;
+
+  GstStructure *stats = gst_structure_new ("timecodeparse-stats",
+      "frames", G_TYPE_UINT64, hist->total,
+      "latency-min", G_TYPE_UINT64, hist->total ? hist->min : 0,
+      "latency-max", G_TYPE_UINT64, hist->max,
+      "latency-mean", G_TYPE_DOUBLE, gst_timecodehistogram_mean (hist),
+      "latency-p50", G_TYPE_UINT64, gst_timecodehistogram_percentile (hist, 50),
+      "latency-p90", G_TYPE_UINT64, gst_timecodehistogram_percentile (hist, 90),
+      "latency-p95", G_TYPE_UINT64, gst_timecodehistogram_percentile (hist, 95),
+      "latency-p99", G_TYPE_UINT64, gst_timecodehistogram_percentile (hist, 99),
+      "latency-p999", G_TYPE_UINT64, gst_timecodehistogram_percentile (hist, 99.9),
+      "decode-failures", G_TYPE_UINT64, overlay->decode_failures,
+      "frames-lost", G_TYPE_UINT64, overlay->sequence.lost,
+      "frames-duplicated", G_TYPE_UINT64, overlay->sequence.duplicated,
+      "frames-reordered", G_TYPE_UINT64, overlay->sequence.reordered,
+      "loss-bursts", G_TYPE_UINT64, overlay->sequence.bursts,
+      "max-loss-burst", G_TYPE_UINT64, overlay->sequence.max_burst,
+      "sequence-restarts", G_TYPE_UINT64, overlay->sequence.restarts,
+      NULL);
+
+  const Gsttimecodehistogram *render = &overlay->render_latency_hist;
+  if (render->total > 0)
+    gst_structure_set (stats,
+        "render-latency-min", G_TYPE_UINT64, render->min,
+        "render-latency-max", G_TYPE_UINT64, render->max,
+        "render-latency-mean", G_TYPE_DOUBLE, gst_timecodehistogram_mean (render),
+        "render-latency-p50", G_TYPE_UINT64, gst_timecodehistogram_percentile (render, 50),
+        "render-latency-p95", G_TYPE_UINT64, gst_timecodehistogram_percentile (render, 95),
+        "render-latency-p99", G_TYPE_UINT64, gst_timecodehistogram_percentile (render, 99),
+        NULL);
+
+  for (guint i = 0; i < GST_TIMECODEPARSE_N_COMPONENTS; i++) {
+    const Gsttimecodehistogram *component = &overlay->component_hist[i];
+    if (component->total == 0)
+      continue;
+
+    gchar *mean = g_strconcat (component_names[i], "-mean", NULL);
+    gchar *p50 = g_strconcat (component_names[i], "-p50", NULL);
+    gchar *p95 = g_strconcat (component_names[i], "-p95", NULL);
+    gst_structure_set (stats,
+        mean, G_TYPE_DOUBLE, gst_timecodehistogram_mean (component),
+        p50, G_TYPE_UINT64, gst_timecodehistogram_percentile (component, 50),
+        p95, G_TYPE_UINT64, gst_timecodehistogram_percentile (component, 95),
+        NULL);
+    g_free (mean);
+    g_free (p50);
+    g_free (p95);
+  }
+
+  return stats;
+}
+
+/* Must be called with the object lock held. Smooths the latency and the
+ * fraction of frames lost, where each of the gap frames missing before
+ * frame_nr counts as a lost sample and each of the passed frames that were
+ * not read as a received one. Returns the upstream event to send, if
+ * enabled. */
+static GstEvent *
+gst_timecodeparse_update_feedback (Gsttimecodeparse * overlay, gint64 latency,
+    guint64 gap, guint64 passed, guint64 frame_nr)
+{
+  if (!overlay->have_smoothed) {
+    overlay->smoothed_latency = latency;
+    overlay->smoothed_loss = 0;
+    overlay->have_smoothed = TRUE;
+  } else {
+    overlay->smoothed_latency +=
+        (latency - overlay->smoothed_latency) * FEEDBACK_LATENCY_GAIN;
+  }
+  /* After a few hundred samples the estimate has converged to 1 anyway */
+  for (guint64 i = 0; i < MIN (gap, 256); i++)
+    overlay->smoothed_loss += (1 - overlay->smoothed_loss) * FEEDBACK_LOSS_GAIN;
+  for (guint64 i = 0; i < MIN (passed, 256) + 1; i++)
+    overlay->smoothed_loss -= overlay->smoothed_loss * FEEDBACK_LOSS_GAIN;
+
+  if (!overlay->feedback && !overlay->feedback_channel)
+    return NULL;
+
+  GsttimecodeFeedback feedback = {
+    .latency = (gint64) overlay->smoothed_latency,
+    .loss = overlay->smoothed_loss,
+    .frame_nr = frame_nr,
+  };
+  if (overlay->feedback_channel)
+    gst_timecode_feedback_publish (overlay->feedback_channel, &feedback);
+  return overlay->feedback ? gst_timecode_feedback_event_new (&feedback) : NULL;
+}
+
+/* Updates the statistics with one frame, passed frames after the previous
+ * read having been skipped. decoded tells whether frame_nr was read. latency
+ * and the components are -1 if they could not be determined. */
+static void
+gst_timecodeparse_update_stats (Gsttimecodeparse * overlay, gint64 realtime,
+    gboolean decoded, gint64 latency, guint64 frame_nr, guint64 passed,
+    const gint64 * components)
+{
+  GstStructure *stats = NULL;
+  GstStructure *sequence = NULL;
+  GstEvent *feedback = NULL;
+
+  GST_OBJECT_LOCK (overlay);
+  for (guint i = 0; i < GST_TIMECODEPARSE_N_COMPONENTS; i++)
+    if (components[i] >= 0)
+      gst_timecodehistogram_record (&overlay->component_hist[i], components[i]);
+
+  if (!decoded) {
+    overlay->decode_failures++;
+  } else {
+    if (latency >= 0)
+      gst_timecodehistogram_record (&overlay->latency_hist, latency);
+
+    guint64 gap = 0;
+    GsttimecodesequenceEvent event =
+        gst_timecodesequence_push (&overlay->sequence, frame_nr, passed, &gap);
+    switch (event) {
+      case GST_TIMECODESEQUENCE_GAP:
+        GST_DEBUG_OBJECT (overlay, "%lu frames missing before frame %lu",
+            gap, frame_nr);
+        if (overlay->gap_threshold > 0 && gap >= overlay->gap_threshold)
+          sequence = gst_structure_new ("timecodeparse-gap",
+              "frame-nr", G_TYPE_UINT64, frame_nr,
+              "gap", G_TYPE_UINT64, gap,
+              "frames-lost", G_TYPE_UINT64, overlay->sequence.lost,
+              NULL);
+        break;
+      case GST_TIMECODESEQUENCE_DUPLICATE:
+        GST_DEBUG_OBJECT (overlay, "Frame %lu is a duplicate", frame_nr);
+        break;
+      case GST_TIMECODESEQUENCE_REORDERED:
+        GST_DEBUG_OBJECT (overlay, "Frame %lu arrived out of order", frame_nr);
+        break;
+      case GST_TIMECODESEQUENCE_RESTART:
+        GST_INFO_OBJECT (overlay, "Frame numbers restarted at %lu", frame_nr);
+        sequence = gst_structure_new ("timecodeparse-restart",
+            "frame-nr", G_TYPE_UINT64, frame_nr, NULL);
+        break;
+      default:
+        break;
+    }
+
+    if (event != GST_TIMECODESEQUENCE_DUPLICATE && latency >= 0) {
+      feedback = gst_timecodeparse_update_feedback (overlay, latency, gap,
+          passed, frame_nr);
+      gst_timecode_sampler_update (&overlay->sampler, latency,
+          overlay->smoothed_loss, realtime);
+    }
+  }
+
+  if (overlay->stats_interval > 0 && realtime >= overlay->next_stats) {
+    if (overlay->next_stats != 0)
+      stats = gst_timecodeparse_create_stats (overlay);
+    overlay->next_stats = realtime + (gint64) overlay->stats_interval * 1000;
+  }
+  GST_OBJECT_UNLOCK (overlay);
+
+  if (feedback && !gst_pad_push_event (GST_BASE_TRANSFORM_SINK_PAD (overlay),
+          feedback))
+    GST_LOG_OBJECT (overlay, "Nobody upstream handled the feedback event");
+  if (sequence)
+    gst_element_post_message (GST_ELEMENT (overlay),
+        gst_message_new_element (GST_OBJECT (overlay), sequence));
+  if (stats)
+    gst_element_post_message (GST_ELEMENT (overlay),
+        gst_message_new_element (GST_OBJECT (overlay), stats));
+}
+
 static void
 gst_timecodeparse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -183,23 +678,144 @@ gst_timecodeparse_set_property (GObject * object, guint prop_id,
   Gsttimecodeparse *filter = GST_TIMECODEPARSE (object);
 
   switch (prop_id) {
-    case PROP_LOCATION: {
-      gchar *path_old = filter->logfile_path;
-      FILE *logfile_old = filter->logfile;
-      gchar *path_new = g_value_dup_string (value);
-      FILE *logfile_new = g_fopen(path_new, "w");
-      if (!logfile_new) {
-        GST_ERROR_OBJECT (filter, "Failed opening logfile at %s", path_new);
-        return;
+    case PROP_LOCATION:
+      gst_timecodelog_set_location (filter->log, g_value_get_string (value));
+      break;
+    case PROP_LOG_FULL_POLICY:
+      gst_timecodelog_set_full_policy (filter->log, g_value_get_enum (value));
+      break;
+    case PROP_LOG_FORMAT:
+      gst_timecodelog_set_format (filter->log, g_value_get_enum (value));
+      break;
+    case PROP_MIN_CONFIDENCE:
+      filter->reader.min_confidence = g_value_get_uint (value);
+      break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      filter->stats_interval = g_value_get_uint (value);
+      filter->next_stats = 0;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_GAP_THRESHOLD:
+      GST_OBJECT_LOCK (filter);
+      filter->gap_threshold = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK:
+      GST_OBJECT_LOCK (filter);
+      filter->feedback = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK_CHANNEL:
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->feedback_channel);
+      filter->feedback_channel = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_HOPS:
+      GST_OBJECT_LOCK (filter);
+      filter->hops = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ENCODING:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.encoding = g_value_get_enum (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ALIGN: {
+      guint align = g_value_get_uint (value);
+      if (align & (align - 1)) {
+        GST_ELEMENT_WARNING (filter, LIBRARY, SETTINGS, (NULL),
+            ("align %u is not a power of two", align));
+        break;
       }
-      fputs(logfile_columns, logfile_new);
-      filter->logfile_path = path_new;
-      filter->logfile = logfile_new;
-      g_free(path_old);
-      if (logfile_old)
-        fclose(logfile_old);
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.align = align;
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
       break;
     }
+    case PROP_FIELDS:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.fields = g_value_get_flags (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ANCHOR:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.anchor = g_value_get_enum (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_X:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.margin_x = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_Y:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.margin_y = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_CELL_SIZE:
+      GST_OBJECT_LOCK (filter);
+      filter->geometry.cell_size = g_value_get_uint (value);
+      g_atomic_int_set (&filter->layout_dirty, TRUE);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      gst_timecode_sampler_configure (&filter->sampler, g_value_get_uint (value),
+          filter->sampler.adaptive);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ADAPTIVE:
+      GST_OBJECT_LOCK (filter);
+      gst_timecode_sampler_configure (&filter->sampler, filter->sampler.max_interval,
+          g_value_get_boolean (value));
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_NET_CLOCK_ADDRESS:
+      gst_timecode_netclock_set_address (&filter->netclock, g_value_get_string (value));
+      break;
+    case PROP_NET_CLOCK_PORT:
+      gst_timecode_netclock_set_port (&filter->netclock, g_value_get_int (value));
+      break;
+    case PROP_NET_CLOCK_SERVE_PORT:
+      if (!gst_timecode_netclock_set_serve_port (&filter->netclock,
+              g_value_get_int (value)))
+        GST_ELEMENT_WARNING (filter, RESOURCE, OPEN_READ_WRITE, (NULL),
+            ("Failed to serve the wall clock on port %d", g_value_get_int (value)));
+      break;
+    case PROP_SHM_NAME:
+      if (!gst_timecodelog_set_shm_name (filter->log, g_value_get_string (value)))
+        GST_ELEMENT_WARNING (filter, RESOURCE, OPEN_WRITE, (NULL),
+            ("Failed to publish in shared memory %s", g_value_get_string (value)));
+      break;
+    case PROP_STREAM_ID:
+      gst_timecodelog_set_stream_id (filter->log, g_value_get_string (value));
+      break;
+    case PROP_LOG_COMPRESSION:
+      if (!gst_timecodelog_set_compression (filter->log, g_value_get_enum (value)))
+        GST_ELEMENT_WARNING (filter, LIBRARY, SETTINGS, (NULL),
+            ("Log compression %d is not available in this build",
+                g_value_get_enum (value)));
+      break;
+    case PROP_MAX_SIZE:
+      gst_timecodelog_set_max_size (filter->log, g_value_get_uint64 (value));
+      break;
+    case PROP_MAX_DURATION:
+      gst_timecodelog_set_max_duration (filter->log, g_value_get_uint64 (value));
+      break;
+    case PROP_MEASURE_AT:
+      GST_OBJECT_LOCK (filter);
+      filter->measure_at = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -214,7 +830,130 @@ gst_timecodeparse_get_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_LOCATION:
-      g_value_set_string (value, filter->logfile_path);
+      g_value_take_string (value, gst_timecodelog_dup_location (filter->log));
+      break;
+    case PROP_LOG_FULL_POLICY:
+      g_value_set_enum (value, gst_timecodelog_get_full_policy (filter->log));
+      break;
+    case PROP_LOG_DROPPED:
+      g_value_set_uint64 (value, gst_timecodelog_get_dropped (filter->log));
+      break;
+    case PROP_LOG_FORMAT:
+      g_value_set_enum (value, gst_timecodelog_get_format (filter->log));
+      break;
+    case PROP_MIN_CONFIDENCE:
+      g_value_set_uint (value, filter->reader.min_confidence);
+      break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (filter);
+      g_value_take_boxed (value, gst_timecodeparse_create_stats (filter));
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->stats_interval);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_GAP_THRESHOLD:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->gap_threshold);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_boolean (value, filter->feedback);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FEEDBACK_CHANNEL:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->feedback_channel);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_HOPS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->hops);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ENCODING:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->geometry.encoding);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ALIGN:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.align);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_FIELDS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_flags (value, filter->geometry.fields);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ANCHOR:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->geometry.anchor);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_X:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.margin_x);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_MARGIN_Y:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.margin_y);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_CELL_SIZE:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->geometry.cell_size);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->sampler.max_interval);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_ADAPTIVE:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_boolean (value, filter->sampler.adaptive);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_CURRENT_INTERVAL:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->sampler.interval);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_NET_CLOCK_ADDRESS:
+      g_value_take_string (value,
+          gst_timecode_netclock_dup_address (&filter->netclock));
+      break;
+    case PROP_NET_CLOCK_PORT:
+      g_value_set_int (value, gst_timecode_netclock_get_port (&filter->netclock));
+      break;
+    case PROP_NET_CLOCK_SERVE_PORT:
+      g_value_set_int (value,
+          gst_timecode_netclock_get_serve_port (&filter->netclock));
+      break;
+    case PROP_SHM_NAME:
+      g_value_take_string (value, gst_timecodelog_dup_shm_name (filter->log));
+      break;
+    case PROP_STREAM_ID:
+      g_value_take_string (value, gst_timecodelog_dup_stream_id (filter->log));
+      break;
+    case PROP_LOG_COMPRESSION:
+      g_value_set_enum (value, gst_timecodelog_get_compression (filter->log));
+      break;
+    case PROP_MAX_SIZE:
+      g_value_set_uint64 (value, gst_timecodelog_get_max_size (filter->log));
+      break;
+    case PROP_MAX_DURATION:
+      g_value_set_uint64 (value, gst_timecodelog_get_max_duration (filter->log));
+      break;
+    case PROP_MEASURE_AT:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->measure_at);
+      GST_OBJECT_UNLOCK (filter);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -222,135 +961,369 @@ gst_timecodeparse_get_property (GObject * object, guint prop_id,
   }
 }
 
-static gchar
-*get_ts()
+/* Logs the records of one frame, hop 0 first, without records of other
+ * frames in between */
+static void
+gst_timecodeparse_push (Gsttimecodeparse * overlay,
+    const GsttimecodelogRecord * records, guint n_records)
 {
-  GDateTime *dt = g_date_time_new_now_utc();
-  if (dt == NULL)
-    return NULL;
-  gchar *ts = g_date_time_format(dt, "%Y-%m-%d %H:%M:%S");
-  int ms = g_date_time_get_microsecond(dt);
-  int size = sizeof("2011-10-08 07:07:09.000000Z");
-  char *buf = malloc(size);
-  g_snprintf(buf, size, "%s.%06dZ", ts, ms);
-  g_free(ts);
-  g_date_time_unref(dt);
-  return buf;
+  g_mutex_lock (&overlay->log_lock);
+  for (guint i = 0; i < n_records; i++)
+    gst_timecodelog_push (overlay->log, &records[i]);
+  g_mutex_unlock (&overlay->log_lock);
+}
+
+/* Takes the values of hop from its meta, if the buffer has one */
+static gboolean
+read_meta (Gsttimecodeparse * overlay, guint hop, GstBuffer * buffer,
+    GsttimecodeTimestamps * timestamps)
+{
+  GsttimecodeMeta *meta = gst_timecode_meta_get (buffer, hop);
+  if (!meta)
+    return FALSE;
+
+  GstClockTime *values[GST_TIMECODE_N_FIELDS] = {
+    &timestamps->buffer_time,
+    &timestamps->stream_time,
+    &timestamps->running_time,
+    &timestamps->clock_time,
+    &timestamps->render_time,
+  };
+  for (guint i = 0; i < GST_TIMECODE_N_FIELDS; i++)
+    if (meta->fields & (1 << i))
+      *values[i] = meta->values[i];
+
+  timestamps->fields = meta->fields;
+  timestamps->interval_log2 = meta->interval_log2;
+  timestamps->sec_offset = meta->sec_offset;
+  timestamps->render_realtime = meta->time_s;
+  timestamps->frame_nr = meta->frame_nr;
+  timestamps->have_frame_nr = TRUE;
+  for (guint i = 0; i < G_N_ELEMENTS (timestamps->confidence); i++)
+    timestamps->confidence[i] = 100;
+  for (guint i = 0; i < GST_TIMECODE_N_FIELDS; i++)
+    timestamps->field_confidence[i] = 100;
+  timestamps->from_meta = TRUE;
+  return TRUE;
 }
 
-static GstClockTime
-read_timestamp(int lineoffset, GstVideoFrame *frame, Gsttimecodeparse *overlay)
-{
-  GstClockTime timestamp = 0;
-
-  guchar *y = frame->data[0];
-  guchar *u = y + frame->info.offset[1];
-  guchar *v = y + frame->info.offset[2];
-
-  uint y_pos = 52;
-  uint x_pos = 1920 - 896;
-  gint pxsize = 16; // 1
-
-  guint y_offset = (y_pos + lineoffset * pxsize) * frame->info.stride[0]   + x_pos*8;
-  guint u_offset = (y_pos + lineoffset * pxsize) * frame->info.stride[1]/2 + x_pos*4;
-  guint v_offset = (y_pos + lineoffset * pxsize) * frame->info.stride[2]/2 + x_pos*4;
-
-  // Don't look at the first pixel of each bit-pixel but at the middle of it
-  y_offset += pxsize/2 * frame->info.stride[0];
-  u_offset += pxsize/2 * frame->info.stride[1]/2;
-  v_offset += pxsize/2 * frame->info.stride[2]/2;
-
-  guint u_sum = 0;
-  guint v_sum = 0;
-  for (int bit = 0; bit < 64; bit++) {
-    guchar y_value = y[y_offset + bit   * pxsize + pxsize/2];
-    guchar u_value = u[u_offset + bit/2 * pxsize + pxsize/2/2];
-    guchar v_value = v[v_offset + bit/2 * pxsize + pxsize/2/2];
-    u_sum += u_value;
-    v_sum += v_value;
-    GST_TRACE_OBJECT(overlay, "bit=%d: %u,%u,%u", bit, y_value, u_value, v_value);
-    /* if ((y_value != 0 && y_value != 255) || u_value != 128 || v_value != 128) // corrupted */
-    /*   return 0; */
-    if (y_value > 20 && y_value < 230) {
-      GST_TRACE_OBJECT(overlay, "ts %d discarded: y_value=%u", lineoffset, y_value);
-      return 0;
+/* Reads code block hop, from its meta if there is one and otherwise from
+ * region, which is NULL if the frame was not mapped */
+static void
+read_block (Gsttimecodeparse * overlay, guint hop, GstBuffer * buffer,
+    const GsttimecodeRegion * region, GsttimecodeTimestamps * timestamps)
+{
+  if (read_meta (overlay, hop, buffer, timestamps) || !region)
+    return;
+
+  gst_timecode_reader_read (&overlay->reader, hop, region, timestamps);
+}
+
+/* Reads the blocks of the chained overlays after the first one into one
+ * record per hop that is present, and returns how many there are.
+ * hop_delta is the time between the stamps of consecutive hops, so it
+ * covers whatever lies between the two overlays. first_record is the record
+ * of hop 0, whose wall clock the hops share. */
+static guint
+read_hops (Gsttimecodeparse * overlay, GstBuffer * buffer,
+    const GsttimecodeRegion * region, guint n_hops,
+    const GsttimecodelogRecord * first_record, const GsttimecodeTimestamps * first,
+    GsttimecodelogRecord * records)
+{
+  guint n_records = 0;
+  gint64 realtime = first_record->realtime;
+  gint64 prev_stamp = -1;
+
+  if (first->sec_offset != 0 && first->render_realtime != 0)
+    prev_stamp = first->sec_offset * G_USEC_PER_SEC + first->render_realtime;
+
+  for (guint hop = 1; hop < n_hops; hop++) {
+    GsttimecodeTimestamps timestamps = { 0 };
+    read_block (overlay, hop, buffer, region, &timestamps);
+    gst_timecode_reader_complete (&overlay->reader, hop, realtime, &timestamps);
+    guint64 sec_offset = timestamps.sec_offset;
+    guint64 time_s = timestamps.render_realtime;
+    guint64 frame_nr = timestamps.frame_nr;
+    if (sec_offset == 0 || time_s == 0) {
+      GST_LOG_OBJECT (overlay, "No stamp of hop %u", hop);
+      prev_stamp = -1;
+      continue;
     }
 
-    timestamp |= (y_value >= 230) ?  (guint64) 1 << (63 - bit) : 0;
-  }
+    gint64 stamp = sec_offset * G_USEC_PER_SEC + time_s;
+    guint64 now = realtime - sec_offset * G_USEC_PER_SEC;
+    gint64 latency = now - time_s;
+    if (latency > 30 * G_USEC_PER_SEC || latency < 0)
+      latency = -1;
 
-  if ((u_sum / 64 < 100) || (u_sum /64 > 156) || (v_sum / 64 < 100) || (v_sum /64 > 156)) {
-      GST_TRACE_OBJECT(overlay, "ts %d discarded: avg u_sum=%u, avg v_sum=%u",
-                       lineoffset, u_sum/64, v_sum/64);
-      return 0;
+    GsttimecodelogRecord *record = &records[n_records++];
+    *record = (GsttimecodelogRecord) {
+      .realtime = realtime,
+      .frame_nr = frame_nr,
+      .time_s = time_s,
+      .time_p = now,
+      .latency = latency,
+      .sec_offset = sec_offset,
+      .hop = hop,
+      .hop_delta = prev_stamp < 0 ? -1 : stamp - prev_stamp,
+      .clock_offset = first_record->clock_offset,
+      .clock_error = first_record->clock_error,
+      .render_latency = -1,
+    };
+    GST_LOG_OBJECT (overlay, "Hop %u stamped frame %lu %ld µs after hop %u",
+        hop, frame_nr, record->hop_delta, hop - 1);
+    prev_stamp = stamp;
   }
+  return n_records;
+}
+
+/* µs until the local sink renders the frame: its clock time plus the
+ * pipeline latency, minus the current clock time. -1 if unknown. */
+static gint64
+decode_to_render (Gsttimecodeparse * overlay, GstClockTime buffer_time)
+{
+  GstSegment *segment = &GST_BASE_TRANSFORM (overlay)->segment;
+  GstClockTime running_time = gst_segment_to_running_time (segment, GST_FORMAT_TIME, buffer_time);
+
+  GST_OBJECT_LOCK (overlay);
+  GstClockTime latency = overlay->latency;
+  GST_OBJECT_UNLOCK (overlay);
+
+  if (!GST_CLOCK_TIME_IS_VALID (running_time) || !GST_CLOCK_TIME_IS_VALID (latency))
+    return -1;
+
+  GstClock *clock = gst_element_get_clock (GST_ELEMENT (overlay));
+  if (!clock)
+    return -1;
+  GstClockTime now = gst_clock_get_time (clock);
+  gst_object_unref (clock);
 
-  return timestamp;
+  GstClockTime render_time = running_time +
+      gst_element_get_base_time (GST_ELEMENT (overlay)) + latency;
+  return MAX (GST_CLOCK_DIFF (now, render_time) / 1000, 0);
 }
 
-typedef struct {
-  GstClockTime buffer_time;
-  GstClockTime stream_time;
-  GstClockTime running_time;
-  GstClockTime clock_time;
-  GstClockTime render_time;
-  guint64 sec_offset;
-  guint64 render_realtime;
-  guint64 frame_nr;
-} Timestamps;
-
-/* this function does the actual processing
- */
-static GstFlowReturn
-gst_timecodeparse_transform_frame_ip (GstVideoFilter * filter, GstVideoFrame * frame)
+/* µs until sink shows buffer, 0 if it does so right away. A syncing sink
+ * waits until its clock reaches the running time plus ts-offset and the
+ * latency; it wakes up render-delay earlier so the frame is on screen then. */
+static gint64
+render_wait (GstBaseSink * sink, GstBuffer * buffer)
 {
-  Gsttimecodeparse *overlay = GST_TIMECODEPARSE (filter);
+  if (!gst_base_sink_get_sync (sink))
+    return 0;
 
-  if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_TIMESTAMP (frame->buffer)))
-    gst_object_sync_values (GST_OBJECT (filter), GST_BUFFER_TIMESTAMP (frame->buffer));
+  GST_OBJECT_LOCK (sink);
+  GstClockTime running_time = gst_segment_to_running_time (&sink->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+  GstClockTime base_time = GST_ELEMENT_CAST (sink)->base_time;
+  GstClock *clock = GST_ELEMENT_CLOCK (sink);
+  if (clock)
+    gst_object_ref (clock);
+  GST_OBJECT_UNLOCK (sink);
 
-  GstClockTime buffer_time = GST_BUFFER_TIMESTAMP (frame->buffer);
+  if (!clock)
+    return 0;
+  GstClockTime now = gst_clock_get_time (clock);
+  gst_object_unref (clock);
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return 0;
 
-  if (!GST_CLOCK_TIME_IS_VALID (buffer_time)) {
-    GST_DEBUG_OBJECT (overlay, "Can't measure latency: buffer timestamp is "
-        "invalid");
-    return GST_FLOW_OK;
+  GstClockTimeDiff show = (GstClockTimeDiff) (base_time + running_time +
+      gst_base_sink_get_latency (sink)) + gst_base_sink_get_ts_offset (sink);
+  return MAX (show - (GstClockTimeDiff) now, 0) / 1000;
+}
+
+/* Completes the record of hop 0 with the time the sink shows the frame.
+ * Runs on the thread that feeds the sink, as the buffer arrives there. */
+static GstPadProbeReturn
+gst_timecodeparse_render_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  Gsttimecodeparse *overlay = GST_TIMECODEPARSE (user_data);
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GsttimecodeRenderMeta *meta = gst_timecode_render_meta_get (buffer, overlay);
+  if (!meta || !gst_timecode_render_meta_complete (meta))
+    return GST_PAD_PROBE_OK;
+
+  GsttimecodelogRecord records[GST_TIMECODE_MAX_HOPS];
+  memcpy (records, meta->records, meta->n_records * sizeof (*records));
+  GsttimecodelogRecord *record = &records[0];
+  gint64 clock_offset, clock_error;
+  gint64 realtime = gst_timecode_netclock_realtime (&overlay->netclock,
+      &clock_offset, &clock_error) +
+      render_wait (GST_BASE_SINK (overlay->render_sink), buffer);
+  record->time_r = realtime - record->sec_offset * G_USEC_PER_SEC;
+  record->render_latency = record->time_r - record->time_s;
+  if (record->render_latency > 30 * G_USEC_PER_SEC || record->render_latency < 0)
+    record->render_latency = -1;
+  GST_LOG_OBJECT (overlay, "Frame %lu is shown %ld µs after it was decoded",
+      record->frame_nr, realtime - record->realtime);
+  gst_timecodeparse_push (overlay, records, meta->n_records);
+
+  GST_OBJECT_LOCK (overlay);
+  gst_timecodehistogram_record (&overlay->component_hist[COMPONENT_DECODE_TO_RENDER],
+      MAX (realtime - record->realtime, 0));
+  if (record->render_latency >= 0)
+    gst_timecodehistogram_record (&overlay->render_latency_hist,
+        record->render_latency);
+  GST_OBJECT_UNLOCK (overlay);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Logs the decoded frame of a meta that never made it to the sink, without
+ * time_r. Runs wherever the last buffer carrying it is freed. */
+static void
+gst_timecodeparse_render_expired (gpointer parse,
+    const GsttimecodelogRecord * records, guint n_records)
+{
+  gst_timecodeparse_push (GST_TIMECODEPARSE (parse), records, n_records);
+}
+
+/* The sink pad of the GstBaseSink that pad feeds, following elements with a
+ * single source pad such as queues and converters, into and out of bins.
+ * NULL if the frames go anywhere else, e.g. into a tee. */
+static GstPad *
+find_sink_pad (GstPad * pad)
+{
+  gst_object_ref (pad);
+  for (guint depth = 0; depth < 64; depth++) {
+    GstPad *peer = gst_pad_get_peer (pad);
+    gst_object_unref (pad);
+
+    /* Into a bin */
+    while (peer && GST_IS_GHOST_PAD (peer)) {
+      GstPad *target = gst_ghost_pad_get_target (GST_GHOST_PAD (peer));
+      gst_object_unref (peer);
+      peer = target;
+    }
+    if (!peer)
+      return NULL;
+
+    /* Out of a bin, through the source ghost pad behind the internal pad */
+    if (GST_IS_PROXY_PAD (peer)) {
+      pad = GST_PAD (gst_proxy_pad_get_internal (GST_PROXY_PAD (peer)));
+      gst_object_unref (peer);
+      if (!pad)
+        return NULL;
+      continue;
+    }
+
+    GstElement *element = gst_pad_get_parent_element (peer);
+    if (!element) {
+      gst_object_unref (peer);
+      return NULL;
+    }
+    if (GST_IS_BASE_SINK (element)) {
+      gst_object_unref (element);
+      return peer;
+    }
+    gst_object_unref (peer);
+
+    GstIterator *it = gst_element_iterate_src_pads (element);
+    GValue item = G_VALUE_INIT;
+    guint n_pads = 0;
+    pad = NULL;
+    while (gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+      if (n_pads++ == 0)
+        pad = gst_object_ref (g_value_get_object (&item));
+      g_value_reset (&item);
+    }
+    g_value_unset (&item);
+    gst_iterator_free (it);
+    gst_object_unref (element);
+
+    if (n_pads != 1) {
+      g_clear_object (&pad);
+      return NULL;
+    }
   }
 
-  if (frame->info.stride[0] < (8 * frame->info.finfo->pixel_stride[0] * 64)) {
-    GST_WARNING_OBJECT (overlay, "Can't read timestamps: video-frame is to narrow");
-    return GST_FLOW_OK;
+  gst_object_unref (pad);
+  return NULL;
+}
+
+/* Puts the render probe on the sink downstream, looking for it once until
+ * the element stops. Returns whether the probe is in place. */
+static gboolean
+gst_timecodeparse_watch_render (Gsttimecodeparse * overlay)
+{
+  if (overlay->render_probe)
+    return TRUE;
+  if (overlay->render_searched)
+    return FALSE;
+  overlay->render_searched = TRUE;
+
+  GstPad *pad = find_sink_pad (GST_BASE_TRANSFORM_SRC_PAD (overlay));
+  if (!pad) {
+    GST_ELEMENT_WARNING (overlay, CORE, PAD, (NULL),
+        ("No sink found downstream, measuring when the frames are decoded"));
+    return FALSE;
   }
 
-  /* GstSegment *segment = &GST_BASE_TRANSFORM (overlay)->segment; */
-  /* GstClockTime running_time = gst_segment_to_running_time (segment, GST_FORMAT_TIME, buffer_time); */
-  /* GstClockTime clock_time = running_time + gst_element_get_base_time (GST_ELEMENT (overlay)); */
-
-  Timestamps timestamps;
-  /* timestamps.buffer_time = read_timestamp (0, frame, overlay); */
-  /* timestamps.stream_time = read_timestamp (1, frame, overlay); */
-  /* timestamps.running_time = read_timestamp (2, frame, overlay); */
-  /* timestamps.clock_time = read_timestamp (3, frame, overlay); */
-  /* timestamps.render_time = read_timestamp (4, frame, overlay); */
-  timestamps.sec_offset = read_timestamp (5, frame, overlay);
-  timestamps.render_realtime = read_timestamp (6, frame, overlay);
-  timestamps.frame_nr = read_timestamp (7, frame, overlay);
-
-  /* GST_LOG_OBJECT (overlay, "Read timestamps: buffer_time = %" GST_TIME_FORMAT */
-  /*     ", stream_time = %" GST_TIME_FORMAT ", running_time = %" GST_TIME_FORMAT */
-  /*     ", clock_time = %" GST_TIME_FORMAT ", render_time = %" GST_TIME_FORMAT */
-  /*     ", render_realtime = %lu", */
-  /*     GST_TIME_ARGS(timestamps.buffer_time), */
-  /*     GST_TIME_ARGS(timestamps.stream_time), */
-  /*     GST_TIME_ARGS(timestamps.running_time), */
-  /*     GST_TIME_ARGS(timestamps.clock_time), */
-  /*     GST_TIME_ARGS(timestamps.render_time), */
-  /*     timestamps.render_realtime); */
-
-  struct timeval tv;
-  gettimeofday(&tv,NULL);
-  guint64 now = 1000000 * (tv.tv_sec - timestamps.sec_offset) + tv.tv_usec;
-  gchar *ts = get_ts();
+  overlay->render_sink = gst_pad_get_parent_element (pad);
+  overlay->render_pad = pad;
+  overlay->render_probe = gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      gst_timecodeparse_render_probe, overlay, NULL);
+  GST_INFO_OBJECT (overlay, "Measuring when %s shows the frames",
+      GST_OBJECT_NAME (overlay->render_sink));
+  return TRUE;
+}
+
+static void
+gst_timecodeparse_unwatch_render (Gsttimecodeparse * overlay)
+{
+  if (overlay->render_probe)
+    gst_pad_remove_probe (overlay->render_pad, overlay->render_probe);
+  overlay->render_probe = 0;
+  g_clear_object (&overlay->render_pad);
+  g_clear_object (&overlay->render_sink);
+  overlay->render_searched = FALSE;
+}
+
+/* Plans the next read after one that succeeded or not. The sender announces
+ * in each stamp how many frames it skips until the next one, so as many
+ * frames are skipped here, or a multiple of them to keep to the own
+ * interval; both are powers of two. If a read fails while sampling, a frame
+ * was probably lost and the next ones are off the stamps, so every frame
+ * is tried until one is read again. */
+static void
+gst_timecodeparse_schedule_read (Gsttimecodeparse * overlay, gboolean read,
+    guint interval_log2)
+{
+  GST_OBJECT_LOCK (overlay);
+  guint interval = overlay->sampler.interval;
+  GST_OBJECT_UNLOCK (overlay);
+
+  if (read) {
+    overlay->sender_interval = 1 << interval_log2;
+    overlay->skip = MAX (interval, overlay->sender_interval) - 1;
+    overlay->passed = 0;
+    overlay->resync = FALSE;
+  } else if (MAX (interval, overlay->sender_interval) > 1) {
+    overlay->passed++;
+    overlay->resync = TRUE;
+  }
+}
+
+/* Reads the first n_hops code blocks of buffer. region is NULL if the frame
+ * was not mapped, then only blocks that come as meta are read. */
+static void
+gst_timecodeparse_measure (Gsttimecodeparse * overlay, GstBuffer * buffer,
+    const GsttimecodeRegion * region, guint n_hops)
+{
+  GstClockTime buffer_time = GST_BUFFER_TIMESTAMP (buffer);
+
+  GsttimecodeTimestamps timestamps = GST_TIMECODE_TIMESTAMPS_INIT;
+  read_block (overlay, 0, buffer, region, &timestamps);
+  gint64 clock_offset, clock_error;
+  gint64 realtime = gst_timecode_netclock_realtime (&overlay->netclock,
+      &clock_offset, &clock_error);
+  gst_timecode_reader_complete (&overlay->reader, 0, realtime, &timestamps);
+  GST_LOG_OBJECT (overlay, "Read frame_nr %lu, confidence sec_offset=%u "
+      "render_realtime=%u frame_nr=%u", timestamps.frame_nr,
+      timestamps.confidence[0], timestamps.confidence[1], timestamps.confidence[2]);
+  guint64 now = realtime - timestamps.sec_offset * G_USEC_PER_SEC;
   long latency = -1;
   if (timestamps.sec_offset == 0 || timestamps.render_realtime == 0) {
     GST_DEBUG_OBJECT(overlay, "Failed to read sec_offset or render_realtime");
@@ -361,16 +1334,172 @@ gst_timecodeparse_transform_frame_ip (GstVideoFilter * filter, GstVideoFrame * f
     GST_DEBUG_OBJECT(overlay, "Discard unlikely latency (<0s or >30s): %ld", latency);
     latency = -1;
   }
-  #define LOG_LINE_LEN 256
-  char log_line[LOG_LINE_LEN] = {0};
-  snprintf (log_line, LOG_LINE_LEN, fmt_string, ts, timestamps.frame_nr, latency, timestamps.render_realtime, now, timestamps.sec_offset);
-  GST_LOG_OBJECT (overlay,          fmt_string, ts, timestamps.frame_nr, latency, timestamps.render_realtime, now, timestamps.sec_offset);
-  fputs(log_line, overlay->logfile);
-  g_free(ts);
+
+  /* Most likely a frame the sender did not stamp, see schedule_read() */
+  if (!timestamps.have_frame_nr && overlay->resync) {
+    overlay->passed++;
+    return;
+  }
+
+  GST_OBJECT_LOCK (overlay);
+  gboolean at_render = overlay->measure_at == GST_TIMECODEPARSE_MEASURE_AT_RENDER;
+  GST_OBJECT_UNLOCK (overlay);
+  /* Frames without a stamp are logged right away */
+  at_render = at_render && latency >= 0 && gst_buffer_is_writable (buffer) &&
+      gst_timecodeparse_watch_render (overlay);
+
+  /* All hops of the frame are logged together, see read_hops() */
+  GsttimecodelogRecord records[GST_TIMECODE_MAX_HOPS];
+  records[0] = (GsttimecodelogRecord) {
+    .realtime = realtime,
+    .frame_nr = timestamps.frame_nr,
+    .time_s = timestamps.render_realtime,
+    .time_p = now,
+    .latency = latency,
+    .sec_offset = timestamps.sec_offset,
+    .hop_delta = -1,
+    .clock_offset = clock_offset,
+    .clock_error = clock_error,
+    .render_latency = -1,
+  };
+  guint n_records = 1;
+  if (n_hops > 1)
+    n_records += read_hops (overlay, buffer, region, n_hops, &records[0],
+        &timestamps, &records[1]);
+  if (!at_render || !gst_timecode_render_meta_add (buffer, overlay, records,
+          n_records, gst_timecodeparse_render_expired))
+    gst_timecodeparse_push (overlay, records, n_records);
+  /* Lets the tracer follow the decoded frame on to the sink */
+  if (latency >= 0 && gst_timecode_trace_active () &&
+      !gst_timecode_trace_meta_get (buffer) && gst_buffer_is_writable (buffer))
+    gst_timecode_trace_meta_add (buffer, timestamps.sec_offset, timestamps.frame_nr);
+
+  gint64 components[GST_TIMECODEPARSE_N_COMPONENTS] = { -1, -1, -1, -1 };
+  if (latency >= 0 && timestamps.clock_time != 0)
+    components[COMPONENT_CAPTURE_TO_OVERLAY] =
+        MAX ((gint64) (timestamps.render_realtime - timestamps.clock_time), 0);
+  if (latency >= 0 && timestamps.render_time != 0) {
+    components[COMPONENT_OVERLAY_TO_NETWORK] =
+        MAX ((gint64) (timestamps.render_time - timestamps.render_realtime), 0);
+    components[COMPONENT_NETWORK_TO_DECODE] =
+        MAX ((gint64) (now - timestamps.render_time), 0);
+  }
+  if (!at_render)
+    components[COMPONENT_DECODE_TO_RENDER] = decode_to_render (overlay, buffer_time);
+
+  gst_timecodeparse_update_stats (overlay, realtime, timestamps.have_frame_nr,
+      latency, timestamps.frame_nr, overlay->passed, components);
+  gst_timecodeparse_schedule_read (overlay, timestamps.have_frame_nr,
+      timestamps.interval_log2);
+}
+
+/* this function does the actual processing. GstVideoFilter would map the
+ * whole frame, so the element maps the rows of the code blocks itself, and
+ * nothing at all if every block comes as meta. */
+static GstFlowReturn
+gst_timecodeparse_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  Gsttimecodeparse *overlay = GST_TIMECODEPARSE (trans);
+  GstClockTime buffer_time = GST_BUFFER_TIMESTAMP (buf);
+
+  if (!GST_VIDEO_FILTER (trans)->negotiated) {
+    GST_ELEMENT_ERROR (overlay, CORE, NOT_IMPLEMENTED, (NULL), ("unknown format"));
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (buffer_time))
+    gst_object_sync_values (GST_OBJECT (overlay), buffer_time);
+
+  if (!GST_CLOCK_TIME_IS_VALID (buffer_time)) {
+    GST_DEBUG_OBJECT (overlay, "Can't measure latency: buffer timestamp is "
+        "invalid");
+    return GST_FLOW_OK;
+  }
+
+  /* The latency against a client clock is only known once it is synced.
+   * The frames are passed like skipped ones, not counted lost. */
+  if (!gst_timecode_netclock_synced (&overlay->netclock)) {
+    GST_DEBUG_OBJECT (overlay, "Can't measure latency: net clock is not synced");
+    overlay->passed++;
+    return GST_FLOW_OK;
+  }
+
+  if (overlay->skip > 0) {
+    overlay->skip--;
+    overlay->passed++;
+    return GST_FLOW_OK;
+  }
+
+  GST_OBJECT_LOCK (overlay);
+  guint hops = overlay->hops;
+  GST_OBJECT_UNLOCK (overlay);
+
+  guint hop;
+  for (hop = 0; hop < hops; hop++)
+    if (!gst_timecode_meta_get (buf, hop))
+      break;
+  if (hop == hops) {
+    gst_timecodeparse_measure (overlay, buf, NULL, hops);
+    return GST_FLOW_OK;
+  }
+
+  if (g_atomic_int_get (&overlay->layout_dirty))
+    gst_timecodeparse_update_layout (overlay, &GST_VIDEO_FILTER (overlay)->in_info);
+
+  if (!overlay->layout_valid) {
+    if (gst_timecode_meta_get (buf, 0))
+      gst_timecodeparse_measure (overlay, buf, NULL, 1);
+    else
+      GST_DEBUG_OBJECT (overlay, "Can't read timestamps: code does not fit");
+    return GST_FLOW_OK;
+  }
+
+  guint n_hops = overlay->reader.n_hops;
+  guint first, last;
+  guint planes = gst_timecode_reader_get_region (&overlay->reader, n_hops,
+      &first, &last);
+  GsttimecodeRegion region;
+  if (!gst_timecode_region_map (&region, buf, &GST_VIDEO_FILTER (overlay)->in_info,
+          planes, first, last, GST_MAP_READ)) {
+    GST_ELEMENT_WARNING (overlay, CORE, NOT_IMPLEMENTED, (NULL),
+        ("invalid video buffer received"));
+    return GST_FLOW_OK;
+  }
+  gst_timecodeparse_measure (overlay, buf, &region, n_hops);
+  gst_timecode_region_unmap (&region);
 
   return GST_FLOW_OK;
 }
 
+/* Tells timecodeoverlay in mode=auto that the code can come as meta */
+static gboolean
+gst_timecodeparse_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  if (!GST_BASE_TRANSFORM_CLASS (parent_class)->propose_allocation (trans,
+          decide_query, query))
+    return FALSE;
+
+  gst_query_add_allocation_meta (query, GST_TIMECODE_META_API_TYPE, NULL);
+  return TRUE;
+}
+
+/* Like timecodeoverlay, the net clock client is applied on start */
+static gboolean
+gst_timecodeparse_start (GstBaseTransform * trans)
+{
+  gst_timecode_netclock_start (&GST_TIMECODEPARSE (trans)->netclock);
+  return TRUE;
+}
+
+static gboolean
+gst_timecodeparse_stop (GstBaseTransform * trans)
+{
+  gst_timecodeparse_unwatch_render (GST_TIMECODEPARSE (trans));
+  gst_timecode_netclock_stop (&GST_TIMECODEPARSE (trans)->netclock);
+  return TRUE;
+}
+
 
 /* entry point to initialize the plug-in
  * initialize the plug-in itself
@@ -379,6 +1508,7 @@ gst_timecodeparse_transform_frame_ip (GstVideoFilter * filter, GstVideoFrame * f
 static gboolean
 timecodeparse_init (GstPlugin * timecodeparse)
 {
+  gst_timecodelog_init ();
   return GST_ELEMENT_REGISTER (timecodeparse, timecodeparse);
 }
 
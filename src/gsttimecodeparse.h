@@ -26,8 +26,28 @@
 #include <gst/gst.h>
 #include <gst/video/gstvideofilter.h>
 
+#include "gsttimecodelog.h"
+#include "gsttimecodereader.h"
+#include "gsttimecodehistogram.h"
+#include "gsttimecodesequence.h"
+#include "gsttimecodefeedback.h"
+#include "gsttimecodenetclock.h"
+#include "gsttimecodesampler.h"
+
 G_BEGIN_DECLS
 
+/* capture-to-overlay, overlay-to-network, network-to-decode, decode-to-render */
+#define GST_TIMECODEPARSE_N_COMPONENTS 4
+
+/* When the receive time of a frame is taken */
+typedef enum {
+  GST_TIMECODEPARSE_MEASURE_AT_DECODE,  /* as it passes timecodeparse */
+  GST_TIMECODEPARSE_MEASURE_AT_RENDER,  /* as the sink downstream shows it */
+} GsttimecodeparseMeasureAt;
+
+#define GST_TYPE_TIMECODEPARSE_MEASURE_AT (gst_timecodeparse_measure_at_get_type())
+GType gst_timecodeparse_measure_at_get_type (void);
+
 #define GST_TYPE_TIMECODEPARSE (gst_timecodeparse_get_type())
 G_DECLARE_FINAL_TYPE (Gsttimecodeparse, gst_timecodeparse,
     GST, TIMECODEPARSE, GstVideoFilter)
@@ -35,8 +55,67 @@ G_DECLARE_FINAL_TYPE (Gsttimecodeparse, gst_timecodeparse,
 struct _Gsttimecodeparse {
   GstVideoFilter element;
 
-  FILE *logfile;
-  gchar *logfile_path;
+  Gsttimecodelog *log;
+
+  /* The negotiated format and the layout of the blocks, set in set_info
+   * and on the streaming thread */
+  GsttimecodeReader reader;
+
+  /* See Gsttimecodeoverlay. hops is the number of code blocks to read,
+   * reader.n_hops how many of them fit into the frame. */
+  GsttimecodeGeometry geometry;
+  guint hops;
+  gboolean layout_valid;
+  gint layout_dirty;
+
+  /* The pipeline latency, protected by the object lock */
+  GstClockTime latency;
+
+  /* Statistics, protected by the object lock. Latencies are in µs. */
+  Gsttimecodehistogram latency_hist;
+  Gsttimecodehistogram component_hist[GST_TIMECODEPARSE_N_COMPONENTS];
+  guint64 decode_failures;
+  Gsttimecodesequence sequence;
+  guint gap_threshold;
+  guint stats_interval;
+  gint64 next_stats;
+
+  /* Feedback to timecodeoverlay, protected by the object lock */
+  gboolean feedback;
+  gchar *feedback_channel;
+  gdouble smoothed_latency;
+  gdouble smoothed_loss;
+  gboolean have_smoothed;
+
+  /* Sampling. The sampler is protected by the object lock, the rest belongs
+   * to the streaming thread. After a read the frames up to the next stamp
+   * to read are skipped; passed counts the frames that arrived since the
+   * last read without being read. resync is set while a sampled stream was
+   * lost track of and every frame is tried. */
+  GsttimecodeSampler sampler;
+  guint sender_interval;
+  guint skip;
+  guint64 passed;
+  gboolean resync;
+
+  /* The wall clock the latency is measured with */
+  GsttimecodeNetclock netclock;
+
+  /* With measure-at=render the record of hop 0 travels to the sink as
+   * GsttimecodeRenderMeta and is logged from a probe on its sink pad.
+   * measure_at and render_latency_hist are protected by the object lock,
+   * the sink and the probe belong to the streaming thread. render_searched
+   * is set once the sink was looked for, until the element stops. */
+  GsttimecodeparseMeasureAt measure_at;
+  Gsttimecodehistogram render_latency_hist;
+  GstElement *render_sink;
+  GstPad *render_pad;
+  gulong render_probe;
+  gboolean render_searched;
+
+  /* The log takes a single producer, which the streaming thread and the
+   * render probe take turns at */
+  GMutex log_lock;
 };
 
 G_END_DECLS
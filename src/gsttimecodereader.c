@@ -0,0 +1,292 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecodereader.h"
+#include "gsttimecodedense.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_timecode_reader_debug);
+#define GST_CAT_DEFAULT gst_timecode_reader_debug
+
+const gchar *gst_timecode_reader_log_columns =
+    "ts\tframe_nr\tlatency\ttime_s\ttime_p\tsec_offset\thop\thop_delta"
+    "\tclock_offset\tclock_error\ttime_r\trender_latency\n";
+
+void
+gst_timecode_reader_init (GsttimecodeReader * reader)
+{
+  static gsize debug_once = 0;
+
+  if (g_once_init_enter (&debug_once)) {
+    GST_DEBUG_CATEGORY_INIT (gst_timecode_reader_debug, "timecodereader", 0,
+        "Read the time code from frames");
+    g_once_init_leave (&debug_once, 1);
+  }
+
+  memset (reader, 0, sizeof (*reader));
+  reader->min_confidence = GST_TIMECODE_READER_DEFAULT_MIN_CONFIDENCE;
+}
+
+gboolean
+gst_timecode_reader_set_format (GsttimecodeReader * reader,
+    const GstVideoInfo * info)
+{
+  return gst_timecode_format_init (&reader->format, info);
+}
+
+guint
+gst_timecode_reader_set_layout (GsttimecodeReader * reader,
+    const GsttimecodeGeometry * geometry, guint hops, gint width, gint height)
+{
+  reader->n_hops = 0;
+  while (reader->n_hops < hops &&
+      gst_timecode_layout_compute (&reader->layout[reader->n_hops],
+          geometry, reader->n_hops, width, height)) {
+    for (guint row = 0; row < reader->layout[reader->n_hops].rows; row++)
+      gst_timecode_cells_init (&reader->cells[reader->n_hops][row],
+          &reader->layout[reader->n_hops], row, &reader->format.luma);
+    reader->n_hops++;
+  }
+  return reader->n_hops;
+}
+
+guint
+gst_timecode_reader_get_region (const GsttimecodeReader * reader, guint n_hops,
+    guint * first, guint * last)
+{
+  const GsttimecodeFormat *format = &reader->format;
+  guint planes = 1 << format->luma.plane;
+
+  *first = G_MAXUINT;
+  *last = 0;
+  for (guint hop = 0; hop < n_hops; hop++) {
+    const GsttimecodeLayout *layout = &reader->layout[hop];
+    *first = MIN (*first, layout->y[0]);
+    *last = MAX (*last, layout->y[layout->rows]);
+    if (layout->encoding == GST_TIMECODE_ENCODING_BINARY)
+      for (guint c = 0; c < format->n_chroma; c++)
+        planes |= 1 << format->chroma[c].plane;
+  }
+  return planes;
+}
+
+/* Reads one word into timestamp. Returns FALSE and sets it to 0 if the word
+ * is discarded. */
+static gboolean
+read_timestamp (GsttimecodeReader * reader, guint hop, int lineoffset,
+    const GsttimecodeRegion * region, guint64 * timestamp, guint * confidence)
+{
+  *timestamp = 0;
+
+  const GsttimecodeFormat *format = &reader->format;
+  const GsttimecodeLayout *layout = &reader->layout[hop];
+  const GsttimecodeComponent *luma = &format->luma;
+
+  *confidence = gst_timecode_decode_word (
+      region->data[luma->plane], region->stride[luma->plane],
+      region->width * luma->pstride,
+      &reader->cells[hop][lineoffset], timestamp);
+  if (*confidence < reader->min_confidence) {
+    GST_TRACE ("ts %u/%d discarded: confidence=%u", hop, lineoffset, *confidence);
+    *timestamp = 0;
+    return FALSE;
+  }
+
+  // Look at the chroma sample in the middle of each bit-pixel
+  guint center_y = (layout->y[lineoffset] + layout->y[lineoffset + 1]) / 2;
+  for (guint c = 0; c < format->n_chroma; c++) {
+    const GsttimecodeComponent *comp = &format->chroma[c];
+    const guint8 *data = region->data[comp->plane];
+    gint stride = region->stride[comp->plane];
+
+    guint sum = 0;
+    for (int bit = 0; bit < 64; bit++) {
+      guint center_x = (layout->x[bit] + layout->x[bit + 1]) / 2;
+      guint value = gst_timecode_component_read (comp, data, stride,
+          center_x, center_y);
+      sum += value;
+      GST_TRACE ("bit=%d: chroma %u = %u", bit, c, value);
+    }
+
+    if ((sum / 64 < 100) || (sum / 64 > 156)) {
+      GST_TRACE ("ts %u/%d discarded: avg chroma %u = %u",
+                 hop, lineoffset, c, sum/64);
+      *timestamp = 0;
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Reads the optional timing fields announced in the sec_offset word. clock
+ * and render time are wall-clock µs since sec_offset, like render_realtime. */
+static void
+read_fields (GsttimecodeReader * reader, const GsttimecodeRegion * region,
+    GsttimecodeTimestamps * timestamps)
+{
+  GstClockTime *values[GST_TIMECODE_N_FIELDS] = {
+    &timestamps->buffer_time,
+    &timestamps->stream_time,
+    &timestamps->running_time,
+    &timestamps->clock_time,
+    &timestamps->render_time,
+  };
+
+  for (guint i = 0; i < GST_TIMECODE_N_FIELDS; i++) {
+    if (!(timestamps->fields & (1 << i)))
+      continue;
+    guint64 value;
+    if (read_timestamp (reader, 0,
+            gst_timecode_field_row (timestamps->fields, 1 << i), region,
+            &value, &timestamps->field_confidence[i]))
+      *values[i] = value;
+  }
+
+  GST_LOG ("Field confidence %u/%u/%u/%u/%u", timestamps->field_confidence[0],
+      timestamps->field_confidence[1], timestamps->field_confidence[2],
+      timestamps->field_confidence[3], timestamps->field_confidence[4]);
+  GST_LOG ("Read timestamps: buffer_time = %" GST_TIME_FORMAT
+      ", stream_time = %" GST_TIME_FORMAT ", running_time = %" GST_TIME_FORMAT
+      ", clock_time = %lu, render_time = %lu, render_realtime = %lu",
+      GST_TIME_ARGS(timestamps->buffer_time),
+      GST_TIME_ARGS(timestamps->stream_time),
+      GST_TIME_ARGS(timestamps->running_time),
+      timestamps->clock_time, timestamps->render_time,
+      timestamps->render_realtime);
+}
+
+/* Reads the rows of the dense block of hop, as many as row 1 announces. The
+ * CRC decides whether the block is valid, so neither min-confidence nor the
+ * chroma check of read_timestamp() apply. render_realtime is left cut to its
+ * low bits, see gst_timecode_reader_complete(). */
+static void
+read_dense (GsttimecodeReader * reader, guint hop,
+    const GsttimecodeRegion * region, GsttimecodeTimestamps * timestamps)
+{
+  const GsttimecodeComponent *luma = &reader->format.luma;
+  const guint8 *data = region->data[luma->plane];
+  gint stride = region->stride[luma->plane];
+  gsize row_bytes = region->width * luma->pstride;
+  guint64 words[GST_TIMECODE_DENSE_ROWS];
+  guint confidence[GST_TIMECODE_DENSE_ROWS];
+  GsttimecodeDense dense;
+
+  for (guint row = 0, n_rows = 2; row < n_rows; row++) {
+    confidence[row] = gst_timecode_decode_word (data, stride, row_bytes,
+        &reader->cells[hop][row], &words[row]);
+    if (row == 1)
+      n_rows = gst_timecode_dense_rows (words[1]);
+    /* Rows past the layout were not mapped */
+    if (n_rows > reader->layout[hop].rows) {
+      GST_TRACE ("Block %u discarded: %u rows announced, %u laid out",
+          hop, n_rows, reader->layout[hop].rows);
+      return;
+    }
+  }
+  timestamps->confidence[0] = confidence[0];
+  timestamps->confidence[1] = timestamps->confidence[2] = confidence[1];
+
+  if (!gst_timecode_dense_unpack (words, &dense)) {
+    GST_TRACE ("Block %u discarded: CRC mismatch, confidence=%u/%u",
+        hop, confidence[0], confidence[1]);
+    return;
+  }
+
+  GstClockTime *values[GST_TIMECODE_N_FIELDS] = {
+    &timestamps->buffer_time,
+    &timestamps->stream_time,
+    &timestamps->running_time,
+    &timestamps->clock_time,
+    &timestamps->render_time,
+  };
+  for (guint i = 0; i < GST_TIMECODE_N_FIELDS; i++)
+    if (dense.fields & (1 << i))
+      *values[i] = dense.values[i];
+
+  /* A new sec_offset means the sender restarted its frame numbers */
+  if (dense.sec_offset != reader->last_sec_offset[hop])
+    reader->last_frame_nr[hop] = 0;
+  reader->last_frame_nr[hop] = gst_timecode_dense_unwrap (dense.frame_nr,
+      GST_TIMECODE_DENSE_FRAME_NR_BITS, reader->last_frame_nr[hop]);
+  reader->last_sec_offset[hop] = dense.sec_offset;
+
+  timestamps->fields = dense.fields;
+  timestamps->interval_log2 = dense.interval_log2;
+  timestamps->sec_offset = dense.sec_offset;
+  timestamps->render_realtime = dense.time_s;
+  timestamps->frame_nr = reader->last_frame_nr[hop];
+  timestamps->have_frame_nr = TRUE;
+}
+
+void
+gst_timecode_reader_read (GsttimecodeReader * reader, guint hop,
+    const GsttimecodeRegion * region, GsttimecodeTimestamps * timestamps)
+{
+  if (reader->layout[hop].encoding == GST_TIMECODE_ENCODING_DENSE) {
+    read_dense (reader, hop, region, timestamps);
+    return;
+  }
+
+  read_timestamp (reader, hop, 5, region, &timestamps->sec_offset,
+      &timestamps->confidence[0]);
+  timestamps->fields = (timestamps->sec_offset >> GST_TIMECODE_FIELDS_SHIFT) &
+      ((1 << GST_TIMECODE_N_FIELDS) - 1);
+  timestamps->interval_log2 = timestamps->sec_offset >> GST_TIMECODE_INTERVAL_SHIFT;
+  timestamps->sec_offset &= GST_TIMECODE_SEC_OFFSET_MASK;
+  read_timestamp (reader, hop, 6, region, &timestamps->render_realtime,
+      &timestamps->confidence[1]);
+  timestamps->have_frame_nr = read_timestamp (reader, hop, 7, region,
+      &timestamps->frame_nr, &timestamps->confidence[2]);
+
+  if (hop == 0 && timestamps->sec_offset != 0 && timestamps->fields)
+    read_fields (reader, region, timestamps);
+}
+
+void
+gst_timecode_reader_complete (const GsttimecodeReader * reader, guint hop,
+    gint64 realtime, GsttimecodeTimestamps * timestamps)
+{
+  if (reader->layout[hop].encoding != GST_TIMECODE_ENCODING_DENSE ||
+      timestamps->from_meta || timestamps->sec_offset == 0)
+    return;
+
+  gint64 now = realtime - (gint64) timestamps->sec_offset * G_USEC_PER_SEC;
+  timestamps->render_realtime = gst_timecode_dense_unwrap (
+      timestamps->render_realtime, GST_TIMECODE_DENSE_TIME_S_BITS, MAX (now, 0));
+}
+
+gint
+gst_timecode_reader_format_record (const GsttimecodelogRecord * record,
+    const gchar * ts, gchar * buf, gsize size)
+{
+  return g_snprintf (buf, size,
+      "%s\t%lu\t%ld\t%lu\t%lu\t%lu\t%u\t%ld\t%ld\t%ld\t%lu\t%ld\n",
+      ts, record->frame_nr, record->latency, record->time_s, record->time_p,
+      record->sec_offset, record->hop, record->hop_delta, record->clock_offset,
+      record->clock_error, record->time_r, record->render_latency);
+}
@@ -0,0 +1,118 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODE_READER_H__
+#define __GST_TIMECODE_READER_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "gsttimecodedecode.h"
+#include "gsttimecodeformat.h"
+#include "gsttimecodelayout.h"
+#include "gsttimecodelog.h"
+#include "gsttimecoderegion.h"
+
+G_BEGIN_DECLS
+
+/* The reading side of the code, shared by timecodeparse and
+ * gst-timecode-analyze */
+
+#define GST_TIMECODE_READER_DEFAULT_MIN_CONFIDENCE 50
+
+/* The values read from one code block. Values that could not be read are
+ * left as they are, 0 for sec_offset, render_realtime and frame_nr. */
+typedef struct {
+  GstClockTime buffer_time;
+  GstClockTime stream_time;
+  GstClockTime running_time;
+  GstClockTime clock_time;
+  GstClockTime render_time;
+  guint64 sec_offset;
+  guint64 render_realtime;
+  guint64 frame_nr;
+  /* frame_nr was read, which it can be when the latency cannot */
+  gboolean have_frame_nr;
+  guint confidence[3];
+  /* Of the optional fields of the binary encoding, by field bit. Fields
+   * below min_confidence are not read. */
+  guint field_confidence[GST_TIMECODE_N_FIELDS];
+  guint fields;
+  guint interval_log2;
+  /* Read from a GsttimecodeMeta, so nothing was cut to its low bits */
+  gboolean from_meta;
+} GsttimecodeTimestamps;
+
+#define GST_TIMECODE_TIMESTAMPS_INIT { GST_CLOCK_TIME_NONE, \
+    GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, }
+
+/* Where the blocks lie in frames of one format and size, and what a reader
+ * needs to remember between frames */
+typedef struct {
+  GsttimecodeFormat format;
+  GsttimecodeLayout layout[GST_TIMECODE_MAX_HOPS];
+  GsttimecodeCells cells[GST_TIMECODE_MAX_HOPS][GST_TIMECODE_ROWS];
+  /* Blocks that fit into the frame */
+  guint n_hops;
+  guint min_confidence;
+
+  /* Last sec_offset and frame_nr read from each dense block, which only
+   * carries the low bits of frame_nr */
+  guint64 last_sec_offset[GST_TIMECODE_MAX_HOPS];
+  guint64 last_frame_nr[GST_TIMECODE_MAX_HOPS];
+} GsttimecodeReader;
+
+void gst_timecode_reader_init (GsttimecodeReader * reader);
+
+/* Sets up the format of info, FALSE if it is not supported */
+gboolean gst_timecode_reader_set_format (GsttimecodeReader * reader,
+    const GstVideoInfo * info);
+
+/* Lays out the first hops blocks in width x height frames and returns how
+ * many of them fit */
+guint gst_timecode_reader_set_layout (GsttimecodeReader * reader,
+    const GsttimecodeGeometry * geometry, guint hops, gint width, gint height);
+
+/* The planes (bit p for plane p) and rows [first, last) the first n_hops
+ * blocks cover. The chroma planes are only needed for the chroma check of
+ * the binary encoding. */
+guint gst_timecode_reader_get_region (const GsttimecodeReader * reader,
+    guint n_hops, guint * first, guint * last);
+
+/* Reads block hop from region. The optional fields of the binary encoding
+ * are only read for hop 0. */
+void gst_timecode_reader_read (GsttimecodeReader * reader, guint hop,
+    const GsttimecodeRegion * region, GsttimecodeTimestamps * timestamps);
+
+/* Dense blocks carry only the low bits of time_s. They are completed to the
+ * value closest to the wall-clock time realtime (µs since the epoch) at
+ * which the frame was received. */
+void gst_timecode_reader_complete (const GsttimecodeReader * reader, guint hop,
+    gint64 realtime, GsttimecodeTimestamps * timestamps);
+
+/* The text log of the receiving side */
+extern const gchar *gst_timecode_reader_log_columns;
+gint gst_timecode_reader_format_record (const GsttimecodelogRecord * record,
+    const gchar * ts, gchar * buf, gsize size);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_READER_H__ */
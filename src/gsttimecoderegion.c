@@ -0,0 +1,146 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecoderegion.h"
+
+/* Vertical subsampling of plane, from the first component that lies in it */
+static guint
+plane_h_sub (const GstVideoFormatInfo * finfo, guint plane)
+{
+  for (guint c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); c++)
+    if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, c) == plane)
+      return GST_VIDEO_FORMAT_INFO_H_SUB (finfo, c);
+  return 0;
+}
+
+gboolean
+gst_timecode_region_map (GsttimecodeRegion * region, GstBuffer * buffer,
+    const GstVideoInfo * info, guint planes, guint first, guint last,
+    GstMapFlags flags)
+{
+  GstVideoMeta *vmeta = gst_buffer_get_video_meta (buffer);
+  gsize buffer_size = gst_buffer_get_size (buffer);
+
+  memset (region, 0, sizeof (*region));
+  region->buffer = buffer;
+  region->width = GST_VIDEO_INFO_WIDTH (info);
+
+  for (guint p = 0; p < GST_VIDEO_INFO_N_PLANES (info); p++) {
+    if (!(planes & (1 << p)))
+      continue;
+
+    gsize offset = vmeta ? vmeta->offset[p] : GST_VIDEO_INFO_PLANE_OFFSET (info, p);
+    gint stride = vmeta ? vmeta->stride[p] : GST_VIDEO_INFO_PLANE_STRIDE (info, p);
+    guint h_sub = plane_h_sub (info->finfo, p);
+    guint plane_first = first >> h_sub;
+    guint plane_last = GST_VIDEO_SUB_SCALE (h_sub, last);
+
+    if (stride <= 0 || plane_last <= plane_first)
+      goto fail;
+
+    gsize start = offset + (gsize) plane_first * stride;
+    if (start >= buffer_size)
+      goto fail;
+    gsize size = MIN ((gsize) (plane_last - plane_first) * stride,
+        buffer_size - start);
+
+    guint idx, length;
+    gsize skip;
+    if (!gst_buffer_find_memory (buffer, start, size, &idx, &length, &skip))
+      goto fail;
+
+    /* Only the rows, if they lie in one memory that can be shared. Shared
+     * memory is read-only, and writes must go through the buffer's own
+     * memory, which the caller made writable. */
+    GstMemory *mem = length == 1 && !(flags & GST_MAP_WRITE) ?
+        gst_buffer_peek_memory (buffer, idx) : NULL;
+    if (mem && !GST_MEMORY_FLAG_IS_SET (mem, GST_MEMORY_FLAG_NO_SHARE) &&
+        (mem = gst_memory_share (mem, skip, size))) {
+      guint m = region->n_maps;
+      if (!gst_memory_map (mem, &region->maps[m], flags)) {
+        gst_memory_unref (mem);
+        goto fail;
+      }
+      region->mems[m] = mem;
+      region->n_maps++;
+      region->data[p] = region->maps[m].data - (gsize) plane_first * stride;
+      region->stride[p] = stride;
+      continue;
+    }
+
+    guint m;
+    for (m = 0; m < region->n_maps; m++)
+      if (!region->mems[m] && region->map_idx[m] == idx &&
+          region->map_length[m] == length)
+        break;
+    if (m == region->n_maps) {
+      if (!gst_buffer_map_range (buffer, idx, length, &region->maps[m], flags))
+        goto fail;
+      region->map_idx[m] = idx;
+      region->map_length[m] = length;
+      region->n_maps++;
+    }
+
+    region->data[p] = region->maps[m].data + skip -
+        (gsize) plane_first * stride;
+    region->stride[p] = stride;
+  }
+
+  return TRUE;
+
+fail:
+  gst_timecode_region_unmap (region);
+  return FALSE;
+}
+
+void
+gst_timecode_region_unmap (GsttimecodeRegion * region)
+{
+  for (guint m = 0; m < region->n_maps; m++) {
+    if (region->mems[m]) {
+      gst_memory_unmap (region->mems[m], &region->maps[m]);
+      gst_memory_unref (region->mems[m]);
+      region->mems[m] = NULL;
+    } else {
+      gst_buffer_unmap (region->buffer, &region->maps[m]);
+    }
+  }
+  region->n_maps = 0;
+}
+
+void
+gst_timecode_region_wrap (GsttimecodeRegion * region,
+    const GstVideoInfo * info, guint8 * data)
+{
+  memset (region, 0, sizeof (*region));
+  region->width = GST_VIDEO_INFO_WIDTH (info);
+  for (guint p = 0; p < GST_VIDEO_INFO_N_PLANES (info); p++) {
+    region->data[p] = data + GST_VIDEO_INFO_PLANE_OFFSET (info, p);
+    region->stride[p] = GST_VIDEO_INFO_PLANE_STRIDE (info, p);
+  }
+}
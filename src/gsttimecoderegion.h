@@ -0,0 +1,67 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODE_REGION_H__
+#define __GST_TIMECODE_REGION_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+/* The planes of a video buffer, mapped only over the rows of the code
+ * blocks. Mapping a whole frame of DMABuf or other device memory can mean
+ * reading back or flushing all of it for the few rows the code covers. */
+typedef struct {
+  gint width;
+  /* Addressed like a fully mapped plane: row y of plane p starts at
+   * data[p] + y * stride[p], for the rows inside the mapped region only.
+   * NULL for planes that were not asked for. */
+  guint8 *data[GST_VIDEO_MAX_PLANES];
+  gint stride[GST_VIDEO_MAX_PLANES];
+
+  /* Each map is either a sub-memory of only the rows of one plane, or for
+   * writes and where memory cannot be shared, whole memories of the buffer
+   * that planes in them share */
+  GstBuffer *buffer;
+  guint n_maps;
+  GstMapInfo maps[GST_VIDEO_MAX_PLANES];
+  GstMemory *mems[GST_VIDEO_MAX_PLANES];
+  guint map_idx[GST_VIDEO_MAX_PLANES];
+  guint map_length[GST_VIDEO_MAX_PLANES];
+} GsttimecodeRegion;
+
+/* Maps rows [first, last) of the frame, in rows of the full-size plane, in
+ * the planes set in planes (bit p for plane p). Offsets and strides come
+ * from the buffer's GstVideoMeta if it has one, otherwise from info. */
+gboolean gst_timecode_region_map (GsttimecodeRegion * region,
+    GstBuffer * buffer, const GstVideoInfo * info, guint planes,
+    guint first, guint last, GstMapFlags flags);
+void gst_timecode_region_unmap (GsttimecodeRegion * region);
+
+/* Points region at all planes of a frame of info that already lies in
+ * memory at data, e.g. a memory-mapped raw dump. Nothing to unmap. */
+void gst_timecode_region_wrap (GsttimecodeRegion * region,
+    const GstVideoInfo * info, guint8 * data);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_REGION_H__ */
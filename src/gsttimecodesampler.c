@@ -0,0 +1,74 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsttimecodesampler.h"
+
+/* The rate goes up when the jitter exceeds this fraction of the latency or
+ * the loss this fraction of the frames */
+#define JITTER_RATIO 0.25
+#define LOSS_THRESHOLD 0.01
+
+#define LATENCY_GAIN (1.0 / 8)
+#define JITTER_GAIN (1.0 / 4)
+
+void
+gst_timecode_sampler_configure (GsttimecodeSampler * sampler, guint interval,
+    gboolean adaptive)
+{
+  interval = CLAMP (interval, 1, GST_TIMECODE_MAX_INTERVAL);
+  sampler->max_interval = 1 << gst_timecode_sampler_log2 (interval);
+  sampler->adaptive = adaptive;
+  sampler->interval = sampler->max_interval;
+  sampler->have_latency = FALSE;
+  sampler->next_increase = 0;
+}
+
+void
+gst_timecode_sampler_update (GsttimecodeSampler * sampler, gint64 latency,
+    gdouble loss, gint64 now)
+{
+  if (!sampler->have_latency) {
+    sampler->latency = latency;
+    /* Not RTT's latency / 2, which would count as high jitter and drop the
+     * interval to 1 on the first sample */
+    sampler->jitter = 0;
+    sampler->have_latency = TRUE;
+  } else {
+    sampler->jitter += (ABS (latency - sampler->latency) - sampler->jitter) * JITTER_GAIN;
+    sampler->latency += (latency - sampler->latency) * LATENCY_GAIN;
+  }
+
+  if (!sampler->adaptive)
+    return;
+
+  if (sampler->jitter > sampler->latency * JITTER_RATIO || loss > LOSS_THRESHOLD) {
+    sampler->interval = 1;
+    sampler->next_increase = now + G_USEC_PER_SEC;
+  } else if (now >= sampler->next_increase && sampler->interval < sampler->max_interval) {
+    sampler->interval *= 2;
+    sampler->next_increase = now + G_USEC_PER_SEC;
+  }
+}
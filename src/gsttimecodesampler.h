@@ -0,0 +1,68 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODE_SAMPLER_H__
+#define __GST_TIMECODE_SAMPLER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Longest sampling interval. The stamps carry its log2 in three bits. */
+#define GST_TIMECODE_MAX_INTERVAL 128
+
+/* Decides how many frames lie between two sampled ones, so that the cost of
+ * stamping, reading and logging scales with the information needed rather
+ * than with the frame rate. Without adaptive the interval is fixed. With it
+ * the interval drops to 1 as soon as the latency jitter or the loss goes
+ * up, and doubles back towards the configured one for every second in
+ * which they stay low. Intervals are powers of two. */
+typedef struct {
+  guint max_interval;
+  gboolean adaptive;
+  guint interval;
+
+  /* Smoothed latency and its mean deviation in µs, as for the TCP RTT */
+  gboolean have_latency;
+  gdouble latency;
+  gdouble jitter;
+  gint64 next_increase;         /* wall-clock µs */
+} GsttimecodeSampler;
+
+/* Sets the configured interval, rounded down to a power of two, and starts
+ * over from it */
+void gst_timecode_sampler_configure (GsttimecodeSampler * sampler,
+    guint interval, gboolean adaptive);
+
+/* Takes a latency sample (µs) and the current loss fraction, at wall-clock
+ * time now (µs) */
+void gst_timecode_sampler_update (GsttimecodeSampler * sampler,
+    gint64 latency, gdouble loss, gint64 now);
+
+static inline guint
+gst_timecode_sampler_log2 (guint interval)
+{
+  return g_bit_storage (interval) - 1;
+}
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_SAMPLER_H__ */
@@ -0,0 +1,116 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gsttimecodesequence.h"
+
+#define BIT(nr) (G_GUINT64_CONSTANT (1) << ((nr) % 64))
+#define WORD(seq, nr) ((seq)->seen[((nr) / 64) % (GST_TIMECODESEQUENCE_WINDOW / 64)])
+
+void
+gst_timecodesequence_reset (Gsttimecodesequence *seq)
+{
+  memset (seq, 0, sizeof *seq);
+}
+
+static void
+start (Gsttimecodesequence *seq, guint64 frame_nr)
+{
+  memset (seq->seen, 0, sizeof seq->seen);
+  seq->highest = frame_nr;
+  seq->first = frame_nr;
+  seq->started = TRUE;
+  WORD (seq, frame_nr) |= BIT (frame_nr);
+}
+
+GsttimecodesequenceEvent
+gst_timecodesequence_push (Gsttimecodesequence *seq, guint64 frame_nr,
+    guint64 passed, guint64 *gap)
+{
+  /* Frames passed before the first one are not part of the sequence */
+  if (!seq->started) {
+    start (seq, frame_nr);
+    seq->received++;
+    return GST_TIMECODESEQUENCE_NEXT;
+  }
+
+  if (frame_nr > seq->highest) {
+    guint64 skipped = frame_nr - seq->highest - 1;
+
+    /* Forget the bits the window moves past. Each frame number is cleared
+     * once, whole words at a time for long gaps. */
+    if (skipped >= GST_TIMECODESEQUENCE_WINDOW) {
+      memset (seq->seen, 0, sizeof seq->seen);
+    } else {
+      for (guint64 nr = seq->highest + 1; nr <= frame_nr; nr++) {
+        if (nr % 64 == 0 && frame_nr - nr >= 63) {
+          WORD (seq, nr) = 0;
+          nr += 63;
+        } else {
+          WORD (seq, nr) &= ~BIT (nr);
+        }
+      }
+    }
+    WORD (seq, frame_nr) |= BIT (frame_nr);
+
+    passed = MIN (passed, skipped);
+    for (guint64 nr = seq->highest + 1; nr <= seq->highest + passed; nr++)
+      if (frame_nr - nr < GST_TIMECODESEQUENCE_WINDOW)
+        WORD (seq, nr) |= BIT (nr);
+    skipped -= passed;
+    seq->highest = frame_nr;
+    seq->received += 1 + passed;
+
+    if (skipped == 0)
+      return GST_TIMECODESEQUENCE_NEXT;
+
+    seq->lost += skipped;
+    seq->bursts++;
+    seq->max_burst = MAX (seq->max_burst, skipped);
+    if (gap)
+      *gap = skipped;
+    return GST_TIMECODESEQUENCE_GAP;
+  }
+
+  if (seq->highest - frame_nr >= GST_TIMECODESEQUENCE_WINDOW) {
+    seq->restarts++;
+    start (seq, frame_nr);
+    return GST_TIMECODESEQUENCE_RESTART;
+  }
+
+  if (WORD (seq, frame_nr) & BIT (frame_nr)) {
+    seq->duplicated++;
+    return GST_TIMECODESEQUENCE_DUPLICATE;
+  }
+
+  /* Only frames a gap skipped over were counted as lost. The ones passed
+   * on unread have their bit set and are duplicates above. */
+  WORD (seq, frame_nr) |= BIT (frame_nr);
+  seq->reordered++;
+  if (frame_nr > seq->first)
+    seq->lost--;
+  return GST_TIMECODESEQUENCE_REORDERED;
+}
@@ -0,0 +1,73 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __GST_TIMECODESEQUENCE_H__
+#define __GST_TIMECODESEQUENCE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Frame numbers this far behind the highest one seen are still classified.
+ * Anything older is taken as a restart of the sender. Must be a multiple
+ * of 64. */
+#define GST_TIMECODESEQUENCE_WINDOW 1024
+
+typedef enum {
+  GST_TIMECODESEQUENCE_NEXT,            /* the expected next frame */
+  GST_TIMECODESEQUENCE_GAP,             /* frames before this one are missing */
+  GST_TIMECODESEQUENCE_DUPLICATE,       /* seen before */
+  GST_TIMECODESEQUENCE_REORDERED,       /* a missing frame arrived late */
+  GST_TIMECODESEQUENCE_RESTART,         /* too far back, tracking started over */
+} GsttimecodesequenceEvent;
+
+/* Tracks which of the last WINDOW frame numbers arrived in a bitmap. Frames
+ * skipped over are counted as lost right away and taken back if they arrive
+ * late, so lost is exact for frames older than the window. */
+typedef struct {
+  guint64 seen[GST_TIMECODESEQUENCE_WINDOW / 64];
+  guint64 highest;
+  /* The first frame since the start, older ones were never counted lost */
+  guint64 first;
+  gboolean started;
+
+  guint64 received;
+  guint64 lost;
+  guint64 duplicated;
+  guint64 reordered;
+  guint64 bursts;               /* gaps */
+  guint64 max_burst;            /* longest gap */
+  guint64 restarts;
+} Gsttimecodesequence;
+
+void gst_timecodesequence_reset (Gsttimecodesequence * seq);
+
+/* Classifies frame_nr and updates the counters. passed frames arrived since
+ * the previous push without being read, because the receiver samples; they
+ * are taken to be the ones directly after the highest frame number and are
+ * not counted as lost. For GAP, gap is set to the number of frames missing.
+ * Amortized O(1) per frame. */
+GsttimecodesequenceEvent gst_timecodesequence_push (Gsttimecodesequence * seq,
+    guint64 frame_nr, guint64 passed, guint64 * gap);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODESEQUENCE_H__ */
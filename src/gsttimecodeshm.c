@@ -0,0 +1,197 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gsttimecodeshm.h"
+#include "gsttimecodeshmring.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_timecode_shm_debug);
+#define GST_CAT_DEFAULT gst_timecode_shm_debug
+
+G_STATIC_ASSERT ((GST_TIMECODE_SHM_N_SLOTS & (GST_TIMECODE_SHM_N_SLOTS - 1)) == 0);
+
+struct _GsttimecodeShm {
+  gchar *name;
+  gint fd;
+  gsize size;
+  GstTimecodeShmHeader *header;
+  GstTimecodeShmSlot *slots;
+  /* Records published so far, the producer's copy of header->head */
+  guint64 head;
+};
+
+/* Whether the object at path may be replaced: its writer closed it or is
+ * gone, or it is not a ring at all. Sets pid to the live writer's. */
+static gboolean
+gst_timecode_shm_stale (const gchar * path, guint32 * pid)
+{
+  gint fd = shm_open (path, O_RDONLY, 0);
+  if (fd < 0)
+    return errno == ENOENT;
+
+  struct stat st;
+  gboolean stale = TRUE;
+  if (fstat (fd, &st) == 0 && (gsize) st.st_size >= sizeof (GstTimecodeShmHeader)) {
+    GstTimecodeShmHeader *header = mmap (NULL, sizeof (GstTimecodeShmHeader),
+        PROT_READ, MAP_SHARED, fd, 0);
+    if (header != MAP_FAILED) {
+      *pid = header->pid;
+      stale = memcmp (header->magic, GST_TIMECODE_SHM_MAGIC,
+          sizeof (header->magic)) != 0 ||
+          atomic_load_explicit (&header->closed, memory_order_acquire) ||
+          (kill ((pid_t) *pid, 0) < 0 && errno == ESRCH);
+      munmap (header, sizeof (GstTimecodeShmHeader));
+    }
+  }
+  close (fd);
+  return stale;
+}
+
+GsttimecodeShm *
+gst_timecode_shm_new (const gchar * name, guint kind)
+{
+  static gsize debug_once = 0;
+
+  if (g_once_init_enter (&debug_once)) {
+    GST_DEBUG_CATEGORY_INIT (gst_timecode_shm_debug, "timecodeshm", 0,
+        "Live telemetry in shared memory");
+    g_once_init_leave (&debug_once, 1);
+  }
+
+  /* POSIX wants a single leading slash */
+  gchar *path = name[0] == '/' ? g_strdup (name) : g_strconcat ("/", name, NULL);
+  gsize size = sizeof (GstTimecodeShmHeader) +
+      GST_TIMECODE_SHM_N_SLOTS * sizeof (GstTimecodeShmSlot);
+
+  /* Only what a crashed or stopped writer left behind is replaced */
+  gint fd = shm_open (path, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0 && errno == EEXIST) {
+    guint32 pid = 0;
+    if (!gst_timecode_shm_stale (path, &pid)) {
+      GST_ERROR ("Shared memory %s is in use by process %u", path, pid);
+      g_free (path);
+      return NULL;
+    }
+    shm_unlink (path);
+    fd = shm_open (path, O_RDWR | O_CREAT | O_EXCL, 0644);
+  }
+  if (fd < 0) {
+    GST_ERROR ("Failed to create shared memory %s: %s", path, g_strerror (errno));
+    g_free (path);
+    return NULL;
+  }
+
+  /* ftruncate() zeroes the slots, so no record looks published */
+  gpointer data = MAP_FAILED;
+  if (ftruncate (fd, size) == 0)
+    data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    GST_ERROR ("Failed to map shared memory %s: %s", path, g_strerror (errno));
+    close (fd);
+    shm_unlink (path);
+    g_free (path);
+    return NULL;
+  }
+
+  GsttimecodeShm *shm = g_new0 (GsttimecodeShm, 1);
+  shm->name = path;
+  shm->fd = fd;
+  shm->size = size;
+  shm->header = data;
+  shm->slots = (GstTimecodeShmSlot *) ((guint8 *) data + sizeof (GstTimecodeShmHeader));
+  shm->head = 0;
+
+  GstTimecodeShmHeader *header = shm->header;
+  header->version = GST_TIMECODE_SHM_VERSION;
+  header->header_size = sizeof (GstTimecodeShmHeader);
+  header->slot_size = sizeof (GstTimecodeShmSlot);
+  header->n_slots = GST_TIMECODE_SHM_N_SLOTS;
+  header->kind = kind;
+  header->pid = getpid ();
+  atomic_store_explicit (&header->head, 0, memory_order_relaxed);
+  atomic_thread_fence (memory_order_release);
+  memcpy (header->magic, GST_TIMECODE_SHM_MAGIC, sizeof (header->magic));
+
+  GST_INFO ("Publishing records in shared memory %s", path);
+  return shm;
+}
+
+void
+gst_timecode_shm_free (GsttimecodeShm * shm)
+{
+  /* Readers that still have it mapped look for the next writer */
+  atomic_store_explicit (&shm->header->closed, 1, memory_order_release);
+  munmap (shm->header, shm->size);
+  close (shm->fd);
+  shm_unlink (shm->name);
+  g_free (shm->name);
+  g_free (shm);
+}
+
+const gchar *
+gst_timecode_shm_get_name (GsttimecodeShm * shm)
+{
+  return shm->name;
+}
+
+void
+gst_timecode_shm_publish (GsttimecodeShm * shm,
+    const GsttimecodelogRecord * record)
+{
+  guint64 i = shm->head++;
+  GstTimecodeShmSlot *slot = &shm->slots[i & (GST_TIMECODE_SHM_N_SLOTS - 1)];
+
+  guint32 flags = 0;
+  if (record->latency < 0)
+    flags |= GST_TIMECODE_BINLOG_FLAG_NO_LATENCY;
+  if (record->sec_offset == 0)
+    flags |= GST_TIMECODE_BINLOG_FLAG_NO_SEC_OFFSET;
+
+  /* Odd while the record is incomplete, see gst_timecode_shm_read() */
+  atomic_store_explicit (&slot->seq, 2 * i + 1, memory_order_relaxed);
+  atomic_thread_fence (memory_order_release);
+  slot->record = (GstTimecodeShmRecord) {
+    .realtime = record->realtime,
+    .frame_nr = record->frame_nr,
+    .time_s = record->time_s,
+    .time_p = record->time_p,
+    .latency = record->latency,
+    .sec_offset = record->sec_offset,
+    .hop = record->hop,
+    .flags = flags,
+    .hop_delta = record->hop_delta,
+    .clock_offset = record->clock_offset,
+    .clock_error = record->clock_error,
+    .time_r = record->time_r,
+    .render_latency = record->render_latency,
+  };
+  atomic_store_explicit (&slot->seq, 2 * i + 2, memory_order_release);
+  atomic_store_explicit (&shm->header->head, i + 1, memory_order_release);
+}
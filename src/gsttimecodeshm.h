@@ -0,0 +1,53 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_TIMECODE_SHM_H__
+#define __GST_TIMECODE_SHM_H__
+
+#include <gst/gst.h>
+
+#include "gsttimecodelog.h"
+
+G_BEGIN_DECLS
+
+/* Slots of the ring, a power of two. Enough for a reader that polls every
+ * few seconds to keep up with several streams' worth of hops. */
+#define GST_TIMECODE_SHM_N_SLOTS 8192
+
+/* Writer of the shared-memory ring of gsttimecodeshmring.h */
+typedef struct _GsttimecodeShm GsttimecodeShm;
+
+/* Creates the object name, replacing one a crashed writer left behind.
+ * kind is one of GST_TIMECODE_BINLOG_KIND_*. NULL on errors, also if a
+ * live writer still has the name. */
+GsttimecodeShm *gst_timecode_shm_new (const gchar * name, guint kind);
+/* Marks the object closed, then unmaps and removes it */
+void gst_timecode_shm_free (GsttimecodeShm * shm);
+
+const gchar *gst_timecode_shm_get_name (GsttimecodeShm * shm);
+
+/* Publishes one record. Called by a single producer at a time; a copy and
+ * a few atomic stores, no system call. */
+void gst_timecode_shm_publish (GsttimecodeShm * shm,
+    const GsttimecodelogRecord * record);
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_SHM_H__ */
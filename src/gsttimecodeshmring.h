@@ -0,0 +1,122 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Layout of the live telemetry that timecodeoverlay and timecodeparse
+ * publish with the shm-name property.
+ *
+ * The shared-memory object (shm_open(3) with that name) holds one header
+ * followed by n_slots fixed-size slots, so slot s starts at
+ * header_size + s * slot_size. Values are in host byte order; the object
+ * is only meant for readers on the same machine. Readers must use
+ * header_size and slot_size from the header rather than sizeof(), so later
+ * versions can append fields.
+ *
+ * There is one writer and any number of readers, which never write. Record
+ * i (counting from 0) goes into slot i % n_slots. head is the number of
+ * records published so far. Each slot is guarded by a sequence number:
+ * 2 * i + 1 while record i is being written and 2 * i + 2 once it is
+ * complete. A reader that falls more than n_slots records behind finds its
+ * records overwritten and continues from head - n_slots.
+ *
+ * The magic is written last, a reader must not look at anything else
+ * before it matches. The object is removed when the writer stops, after it
+ * set closed; readers that still have it mapped keep their copy and can
+ * open the name again to find the next writer's. A writer only replaces an
+ * object whose writer closed it or is gone.
+ *
+ * Like gsttimecodebinlog.h this only depends on the C library, see
+ * gst_timecode_shm_read() below for a reader.
+ */
+
+#ifndef __GST_TIMECODE_SHM_RING_H__
+#define __GST_TIMECODE_SHM_RING_H__
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "gsttimecodebinlog.h"
+
+#define GST_TIMECODE_SHM_MAGIC "GSTTCSHM"
+#define GST_TIMECODE_SHM_VERSION 1
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t slot_size;
+  uint32_t n_slots;               /* a power of two */
+  uint32_t kind;                  /* GST_TIMECODE_BINLOG_KIND_* */
+  uint32_t pid;                   /* of the writer */
+  _Atomic uint64_t head;
+  _Atomic uint32_t closed;        /* 1 once the writer stopped */
+  uint8_t reserved[20];
+} GstTimecodeShmHeader;
+
+/* The fields of a log record, see GsttimecodelogRecord */
+typedef struct {
+  int64_t realtime;               /* µs since the epoch, the ts column */
+  uint64_t frame_nr;
+  uint64_t time_s;
+  uint64_t time_p;                /* 0 in sender records */
+  int64_t latency;                /* 0 in sender records */
+  uint64_t sec_offset;
+  uint32_t hop;
+  uint32_t flags;                 /* GST_TIMECODE_BINLOG_FLAG_* */
+  int64_t hop_delta;
+  int64_t clock_offset;
+  int64_t clock_error;
+  uint64_t time_r;
+  int64_t render_latency;
+} GstTimecodeShmRecord;
+
+typedef struct {
+  _Atomic uint64_t seq;
+  GstTimecodeShmRecord record;
+} GstTimecodeShmSlot;
+
+_Static_assert (sizeof (GstTimecodeShmHeader) == 64, "shm header layout");
+_Static_assert (sizeof (GstTimecodeShmSlot) == 104, "shm slot layout");
+
+/* Copies record i into record. Returns 1 on success, 0 if it has not been
+ * published yet and -1 if it was overwritten already. */
+static inline int
+gst_timecode_shm_read (const GstTimecodeShmHeader * header, uint64_t i,
+    GstTimecodeShmRecord * record)
+{
+  const GstTimecodeShmSlot *slot = (const GstTimecodeShmSlot *)
+      ((const uint8_t *) header + header->header_size +
+      (i & (header->n_slots - 1)) * header->slot_size);
+
+  uint64_t seq = atomic_load_explicit (&slot->seq, memory_order_acquire);
+  if (seq < 2 * i + 2)
+    return 0;
+  if (seq > 2 * i + 2)
+    return -1;
+
+  memcpy (record, &slot->record, sizeof (*record));
+  /* The writer may have started on the slot meanwhile */
+  atomic_thread_fence (memory_order_acquire);
+  if (atomic_load_explicit (&slot->seq, memory_order_relaxed) != seq)
+    return -1;
+  return 1;
+}
+
+#endif /* __GST_TIMECODE_SHM_RING_H__ */
@@ -0,0 +1,672 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* timecodetracer: follows the frames timecodeoverlay stamped through every
+ * pad of the process and writes how long each element held each frame.
+ *
+ *   GST_TRACERS="timecodetracer(location=/tmp/trace.csv,interval=8)"
+ *
+ * A buffer is a stamped frame if it carries a GsttimecodeMeta, a
+ * GsttimecodeRenderMeta or a GsttimecodeTraceMeta, which the elements add
+ * while the tracer is active. Parameters:
+ *
+ *   location  where the profile is written (default /tmp/gsttime_trace.csv)
+ *   interval  only trace frames whose frame_nr is a multiple of it
+ *   window    ms after its last pad crossing a frame is written out
+ *
+ * The hooks run on the streaming threads and only copy an event into a
+ * buffer of their thread. Buffers are preallocated; threads hand them in
+ * when full and the writer thread takes them every round, so events of
+ * idle threads are not held back. When no empty buffer is left events are
+ * dropped rather than allocated. The writer gathers the events by frame
+ * and writes one line per pad a frame crossed:
+ *
+ *   frame_nr sec_offset element pad peer time latency
+ *
+ * element pushed the frame through its pad to peer at time, µs since
+ * sec_offset on the local wall clock like time_s in the logs. latency is
+ * the µs element held the frame since it was pushed into it, -1 where
+ * that was not seen, e.g. for the element that stamped it. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib/gstdio.h>
+
+#include "gsttimecodetracer.h"
+#include "gsttimecodemeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_timecode_tracer_debug);
+#define GST_CAT_DEFAULT gst_timecode_tracer_debug
+
+#define DEFAULT_LOCATION "/tmp/gsttime_trace.csv"
+#define DEFAULT_WINDOW (GST_SECOND)
+/* How often the writer collects what the threads have */
+#define GST_TIMECODE_TRACER_FLUSH_INTERVAL (G_USEC_PER_SEC / 10)
+/* Pad crossings kept per frame, beyond that a pipeline is not plausible */
+#define GST_TIMECODE_TRACER_FRAME_EVENTS 256
+
+/* The names of a pad and the elements it links, cached on the pad */
+typedef struct {
+  GstPad *peer;
+  GQuark from;
+  GQuark pad;
+  GQuark to;
+} GsttimecodeTracerPad;
+
+/* The events of a frame the writer has seen so far */
+typedef struct {
+  guint64 sec_offset;
+  guint64 frame_nr;
+  gint64 updated;
+  GArray *events;
+} GsttimecodeTracerFrame;
+
+/* What a streaming thread traces into. buffer is only replaced under the
+ * tracer lock; the thread sets busy while it writes into it, and whoever
+ * replaced it waits for that before reading the old one. tracer is cleared
+ * when the tracer goes away before the thread. */
+typedef struct {
+  GsttimecodeTracer *tracer;
+  GsttimecodeTracerBuffer *buffer;
+  gint busy;
+  /* Set when no empty buffer was left, until the writer hands one out */
+  gint starved;
+} GsttimecodeTracerThread;
+
+static void gst_timecode_tracer_thread_exit (gpointer data);
+
+static GPrivate thread_state = G_PRIVATE_INIT (gst_timecode_tracer_thread_exit);
+/* Protects GsttimecodeTracerThread.tracer, taken before the tracer lock */
+G_LOCK_DEFINE_STATIC (threads);
+static GQuark pad_quark;
+
+#define gst_timecode_tracer_parent_class parent_class
+G_DEFINE_TYPE (GsttimecodeTracer, gst_timecode_tracer, GST_TYPE_TRACER);
+
+/* The element a pad belongs to. The internal pads of a ghost pad belong to
+ * the ghost pad, and so to its bin. */
+static GQuark
+gst_timecode_tracer_element (GstPad * pad)
+{
+  GstObject *parent = GST_OBJECT_PARENT (pad);
+
+  while (parent && GST_IS_PAD (parent))
+    parent = GST_OBJECT_PARENT (parent);
+  return parent ? g_quark_from_string (GST_OBJECT_NAME (parent)) : 0;
+}
+
+/* Looked up once per pad and again when it is linked elsewhere */
+static const GsttimecodeTracerPad *
+gst_timecode_tracer_pad (GstPad * pad)
+{
+  GsttimecodeTracerPad *info = g_object_get_qdata (G_OBJECT (pad), pad_quark);
+  GstPad *peer = GST_PAD_PEER (pad);
+
+  if (info && info->peer == peer)
+    return info;
+
+  if (!info) {
+    info = g_new0 (GsttimecodeTracerPad, 1);
+    info->from = gst_timecode_tracer_element (pad);
+    info->pad = g_quark_from_string (GST_OBJECT_NAME (pad));
+    g_object_set_qdata_full (G_OBJECT (pad), pad_quark, info, g_free);
+  }
+  info->peer = peer;
+  info->to = peer ? gst_timecode_tracer_element (peer) : 0;
+  return info;
+}
+
+/* The frame buffer is, if it is a stamped one */
+static gboolean
+gst_timecode_tracer_frame (GstBuffer * buffer, guint64 * sec_offset,
+    guint64 * frame_nr)
+{
+  GsttimecodeTraceMeta *trace = gst_timecode_trace_meta_get (buffer);
+  if (trace) {
+    *sec_offset = trace->sec_offset;
+    *frame_nr = trace->frame_nr;
+    return TRUE;
+  }
+
+  GsttimecodeMeta *meta = (GsttimecodeMeta *) gst_buffer_get_meta (buffer,
+      GST_TIMECODE_META_API_TYPE);
+  if (meta) {
+    *sec_offset = meta->sec_offset;
+    *frame_nr = meta->frame_nr;
+    return TRUE;
+  }
+
+  GsttimecodeRenderMeta *render = (GsttimecodeRenderMeta *) gst_buffer_get_meta (
+      buffer, GST_TIMECODE_RENDER_META_API_TYPE);
+  if (render) {
+    *sec_offset = render->record.sec_offset;
+    *frame_nr = render->record.frame_nr;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* Hands in the thread's buffer, if any, for an empty one. Without an empty
+ * one the thread keeps what it has and drops events until the writer has
+ * one for it. */
+static void
+gst_timecode_tracer_refill (GsttimecodeTracer * self,
+    GsttimecodeTracerThread * state)
+{
+  g_mutex_lock (&self->lock);
+  GsttimecodeTracerBuffer *buffer = state->buffer;
+  if (!buffer || buffer->n == GST_TIMECODE_TRACER_BUFFER_EVENTS) {
+    if (self->pool->len > 0) {
+      GsttimecodeTracerBuffer *empty =
+          g_ptr_array_remove_index_fast (self->pool, self->pool->len - 1);
+      empty->n = 0;
+      g_atomic_pointer_set (&state->buffer, empty);
+      if (buffer) {
+        g_ptr_array_add (self->full, buffer);
+        g_cond_signal (&self->cond);
+      }
+    } else {
+      g_atomic_int_set (&state->starved, 1);
+    }
+  }
+  g_mutex_unlock (&self->lock);
+}
+
+static void
+gst_timecode_tracer_thread_exit (gpointer data)
+{
+  GsttimecodeTracerThread *state = data;
+
+  G_LOCK (threads);
+  GsttimecodeTracer *self = state->tracer;
+  if (self) {
+    g_mutex_lock (&self->lock);
+    g_ptr_array_remove_fast (self->threads, state);
+    if (state->buffer) {
+      g_ptr_array_add (state->buffer->n > 0 ? self->full : self->pool,
+          state->buffer);
+      g_cond_signal (&self->cond);
+    }
+    g_mutex_unlock (&self->lock);
+  }
+  G_UNLOCK (threads);
+  g_free (state);
+}
+
+/* Takes the buffers of all threads that have events, and gives threads
+ * without one a buffer, as far as empty ones are left. Must be called with
+ * the lock held. */
+static void
+gst_timecode_tracer_reclaim (GsttimecodeTracer * self)
+{
+  for (guint i = 0; i < self->threads->len && self->pool->len > 0; i++) {
+    GsttimecodeTracerThread *state = g_ptr_array_index (self->threads, i);
+    GsttimecodeTracerBuffer *buffer = state->buffer;
+    if (buffer && g_atomic_int_get (&buffer->n) == 0)
+      continue;
+
+    GsttimecodeTracerBuffer *empty =
+        g_ptr_array_remove_index_fast (self->pool, self->pool->len - 1);
+    empty->n = 0;
+    g_atomic_pointer_set (&state->buffer, empty);
+    g_atomic_int_set (&state->starved, 0);
+    if (buffer) {
+      /* The thread may still be writing the event it started */
+      while (g_atomic_int_get (&state->busy))
+        g_thread_yield ();
+      g_ptr_array_add (self->full, buffer);
+    }
+  }
+}
+
+/* Only the first timestamp needs the lock */
+static void
+gst_timecode_tracer_set_base (GsttimecodeTracer * self, GstClockTime ts)
+{
+  g_mutex_lock (&self->lock);
+  if (!self->based) {
+    self->ts_base = ts;
+    self->realtime_base = g_get_real_time ();
+    g_atomic_int_set (&self->based, 1);
+  }
+  g_mutex_unlock (&self->lock);
+}
+
+static void
+gst_timecode_tracer_record (GsttimecodeTracer * self, GstClockTime ts,
+    GstPad * pad, guint64 sec_offset, guint64 frame_nr)
+{
+  if (frame_nr % self->interval != 0)
+    return;
+
+  if (G_UNLIKELY (!g_atomic_int_get (&self->based)))
+    gst_timecode_tracer_set_base (self, ts);
+
+  GsttimecodeTracerThread *state = g_private_get (&thread_state);
+  if (G_UNLIKELY (!state)) {
+    state = g_new0 (GsttimecodeTracerThread, 1);
+    state->tracer = self;
+    g_private_set (&thread_state, state);
+    G_LOCK (threads);
+    g_mutex_lock (&self->lock);
+    g_ptr_array_add (self->threads, state);
+    g_mutex_unlock (&self->lock);
+    G_UNLOCK (threads);
+  } else if (state->tracer != self) {
+    return;
+  }
+
+  const GsttimecodeTracerPad *info = gst_timecode_tracer_pad (pad);
+
+  for (guint attempt = 0; attempt < 2; attempt++) {
+    g_atomic_int_set (&state->busy, 1);
+    GsttimecodeTracerBuffer *buffer = g_atomic_pointer_get (&state->buffer);
+    if (buffer && buffer->n < GST_TIMECODE_TRACER_BUFFER_EVENTS) {
+      GsttimecodeTracerEvent *event = &buffer->events[buffer->n];
+      event->sec_offset = sec_offset;
+      event->frame_nr = frame_nr;
+      event->ts = ts;
+      event->from = info->from;
+      event->pad = info->pad;
+      event->to = info->to;
+      g_atomic_int_set (&buffer->n, buffer->n + 1);
+      g_atomic_int_set (&state->busy, 0);
+      return;
+    }
+    g_atomic_int_set (&state->busy, 0);
+
+    /* The writer may wait for busy under the lock, so it is not held */
+    if (attempt > 0 || g_atomic_int_get (&state->starved))
+      break;
+    gst_timecode_tracer_refill (self, state);
+  }
+  g_atomic_int_inc (&self->dropped);
+}
+
+static void
+gst_timecode_tracer_push_pre (GObject * object, GstClockTime ts, GstPad * pad,
+    GstBuffer * buffer)
+{
+  guint64 sec_offset, frame_nr;
+
+  if (gst_timecode_tracer_frame (buffer, &sec_offset, &frame_nr))
+    gst_timecode_tracer_record (GST_TIMECODE_TRACER (object), ts, pad,
+        sec_offset, frame_nr);
+}
+
+/* The packets of a frame are recorded once per list */
+static void
+gst_timecode_tracer_push_list_pre (GObject * object, GstClockTime ts,
+    GstPad * pad, GstBufferList * list)
+{
+  guint64 sec_offset, frame_nr, last_sec_offset = 0, last_frame_nr = 0;
+  gboolean have_last = FALSE;
+
+  for (guint i = 0; i < gst_buffer_list_length (list); i++) {
+    if (!gst_timecode_tracer_frame (gst_buffer_list_get (list, i), &sec_offset,
+            &frame_nr))
+      continue;
+    if (have_last && sec_offset == last_sec_offset && frame_nr == last_frame_nr)
+      continue;
+    gst_timecode_tracer_record (GST_TIMECODE_TRACER (object), ts, pad,
+        sec_offset, frame_nr);
+    last_sec_offset = sec_offset;
+    last_frame_nr = frame_nr;
+    have_last = TRUE;
+  }
+}
+
+/* pad is the sink pad that pulled; the frame crossed the link from its peer */
+static void
+gst_timecode_tracer_pull_range_post (GObject * object, GstClockTime ts,
+    GstPad * pad, GstBuffer * buffer, GstFlowReturn res)
+{
+  guint64 sec_offset, frame_nr;
+  GstPad *peer = GST_PAD_PEER (pad);
+
+  if (res == GST_FLOW_OK && buffer && peer &&
+      gst_timecode_tracer_frame (buffer, &sec_offset, &frame_nr))
+    gst_timecode_tracer_record (GST_TIMECODE_TRACER (object), ts, peer,
+        sec_offset, frame_nr);
+}
+
+static guint
+gst_timecode_tracer_frame_hash (gconstpointer key)
+{
+  const GsttimecodeTracerFrame *frame = key;
+  return (guint) (frame->frame_nr ^ (frame->sec_offset << 20));
+}
+
+static gboolean
+gst_timecode_tracer_frame_equal (gconstpointer a, gconstpointer b)
+{
+  const GsttimecodeTracerFrame *fa = a, *fb = b;
+  return fa->frame_nr == fb->frame_nr && fa->sec_offset == fb->sec_offset;
+}
+
+static void
+gst_timecode_tracer_frame_free (gpointer data)
+{
+  GsttimecodeTracerFrame *frame = data;
+
+  g_array_unref (frame->events);
+  g_free (frame);
+}
+
+static gint
+gst_timecode_tracer_compare_events (gconstpointer a, gconstpointer b)
+{
+  const GsttimecodeTracerEvent *ea = a, *eb = b;
+  return ea->ts < eb->ts ? -1 : ea->ts > eb->ts;
+}
+
+static gint
+gst_timecode_tracer_compare_frames (gconstpointer a, gconstpointer b)
+{
+  const GsttimecodeTracerFrame *fa = *(GsttimecodeTracerFrame * const *) a;
+  const GsttimecodeTracerFrame *fb = *(GsttimecodeTracerFrame * const *) b;
+
+  if (fa->sec_offset != fb->sec_offset)
+    return fa->sec_offset < fb->sec_offset ? -1 : 1;
+  return fa->frame_nr < fb->frame_nr ? -1 : fa->frame_nr > fb->frame_nr;
+}
+
+/* The threads hand in their events in batches, so a frame's events are
+ * only put in order once it is complete */
+static void
+gst_timecode_tracer_write_frame (GsttimecodeTracer * self,
+    GsttimecodeTracerFrame * frame)
+{
+  g_array_sort (frame->events, gst_timecode_tracer_compare_events);
+  const GsttimecodeTracerEvent *events = (gpointer) frame->events->data;
+
+  for (guint i = 0; i < frame->events->len; i++) {
+    const GsttimecodeTracerEvent *e = &events[i];
+
+    /* A frame sent as packets crosses a pad many times, the first counts */
+    gboolean seen = FALSE;
+    for (guint j = 0; j < i && !seen; j++)
+      seen = events[j].pad == e->pad && events[j].from == e->from;
+    if (seen)
+      continue;
+
+    gint64 latency = -1;
+    for (guint j = i; j-- > 0;) {
+      if (events[j].to == e->from) {
+        latency = (e->ts - events[j].ts) / GST_USECOND;
+        break;
+      }
+    }
+    gint64 time = self->realtime_base +
+        GST_CLOCK_DIFF (self->ts_base, e->ts) / GST_USECOND -
+        (gint64) frame->sec_offset * G_USEC_PER_SEC;
+    const gchar *to = g_quark_to_string (e->to);
+
+    fprintf (self->file, "%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT
+        "\t%s\t%s\t%s\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\n",
+        frame->frame_nr, frame->sec_offset, g_quark_to_string (e->from),
+        g_quark_to_string (e->pad), to ? to : "", time, latency);
+  }
+}
+
+/* Writes the frames no event came in for within the window, or all */
+static void
+gst_timecode_tracer_write_frames (GsttimecodeTracer * self, gint64 now,
+    gboolean all)
+{
+  GPtrArray *done = g_ptr_array_new_with_free_func (gst_timecode_tracer_frame_free);
+  GHashTableIter iter;
+  gpointer frame;
+
+  g_hash_table_iter_init (&iter, self->frames);
+  while (g_hash_table_iter_next (&iter, &frame, NULL)) {
+    if (all || (GstClockTime) (now - ((GsttimecodeTracerFrame *) frame)->updated) *
+        GST_USECOND >= self->window) {
+      g_hash_table_iter_steal (&iter);
+      g_ptr_array_add (done, frame);
+    }
+  }
+
+  g_ptr_array_sort (done, gst_timecode_tracer_compare_frames);
+  for (guint i = 0; i < done->len; i++)
+    gst_timecode_tracer_write_frame (self, g_ptr_array_index (done, i));
+  g_ptr_array_unref (done);
+  fflush (self->file);
+}
+
+static void
+gst_timecode_tracer_collect (GsttimecodeTracer * self,
+    const GsttimecodeTracerBuffer * buffer, gint64 now)
+{
+  for (gint i = 0; i < buffer->n; i++) {
+    const GsttimecodeTracerEvent *e = &buffer->events[i];
+    GsttimecodeTracerFrame key = {
+      .sec_offset = e->sec_offset,
+      .frame_nr = e->frame_nr,
+    };
+
+    GsttimecodeTracerFrame *frame = g_hash_table_lookup (self->frames, &key);
+    if (!frame) {
+      frame = g_new0 (GsttimecodeTracerFrame, 1);
+      frame->sec_offset = e->sec_offset;
+      frame->frame_nr = e->frame_nr;
+      frame->events = g_array_new (FALSE, FALSE, sizeof (GsttimecodeTracerEvent));
+      g_hash_table_add (self->frames, frame);
+    }
+    if (frame->events->len < GST_TIMECODE_TRACER_FRAME_EVENTS)
+      g_array_append_vals (frame->events, e, 1);
+    frame->updated = now;
+  }
+}
+
+/* Once the pipeline is done nothing more is coming for any frame */
+static void
+gst_timecode_tracer_post_message_pre (GObject * object, GstClockTime ts,
+    GstElement * element, GstMessage * message)
+{
+  GsttimecodeTracer *self = GST_TIMECODE_TRACER (object);
+
+  if (GST_MESSAGE_TYPE (message) != GST_MESSAGE_EOS ||
+      GST_OBJECT_PARENT (element))
+    return;
+
+  g_mutex_lock (&self->lock);
+  self->flush = TRUE;
+  g_cond_signal (&self->cond);
+  g_mutex_unlock (&self->lock);
+}
+
+static gpointer
+gst_timecode_tracer_thread (gpointer data)
+{
+  GsttimecodeTracer *self = data;
+  GPtrArray *batch = g_ptr_array_new ();
+  gboolean stopping, all;
+
+  g_mutex_lock (&self->lock);
+  do {
+    gint64 end = g_get_monotonic_time () + GST_TIMECODE_TRACER_FLUSH_INTERVAL;
+    while (!self->stopping && !self->flush && self->full->len == 0 &&
+        g_cond_wait_until (&self->cond, &self->lock, end));
+
+    gst_timecode_tracer_reclaim (self);
+    GPtrArray *full = self->full;
+    self->full = batch;
+    batch = full;
+    stopping = self->stopping;
+    all = stopping || self->flush;
+    self->flush = FALSE;
+    g_mutex_unlock (&self->lock);
+
+    gint64 now = g_get_monotonic_time ();
+    for (guint i = 0; i < batch->len; i++)
+      gst_timecode_tracer_collect (self, g_ptr_array_index (batch, i), now);
+    gst_timecode_tracer_write_frames (self, now, all);
+
+    g_mutex_lock (&self->lock);
+    for (guint i = 0; i < batch->len; i++)
+      g_ptr_array_add (self->pool, g_ptr_array_index (batch, i));
+    g_ptr_array_set_size (batch, 0);
+  } while (!stopping);
+  g_mutex_unlock (&self->lock);
+
+  g_ptr_array_unref (batch);
+  return NULL;
+}
+
+static void
+gst_timecode_tracer_constructed (GObject * object)
+{
+  GsttimecodeTracer *self = GST_TIMECODE_TRACER (object);
+  gchar *params = NULL;
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  g_object_get (self, "params", &params, NULL);
+  if (params) {
+    gchar *str = g_strdup_printf ("timecodetracer,%s", params);
+    GstStructure *s = gst_structure_from_string (str, NULL);
+    gint value;
+
+    if (s) {
+      const gchar *location = gst_structure_get_string (s, "location");
+      if (location) {
+        g_free (self->location);
+        self->location = g_strdup (location);
+      }
+      if (gst_structure_get_int (s, "interval", &value) && value > 0)
+        self->interval = value;
+      if (gst_structure_get_int (s, "window", &value) && value > 0)
+        self->window = value * GST_MSECOND;
+      gst_structure_free (s);
+    } else {
+      GST_WARNING_OBJECT (self, "Can't parse params %s", params);
+    }
+    g_free (str);
+    g_free (params);
+  }
+
+  self->file = g_fopen (self->location, "w");
+  if (!self->file) {
+    GST_ERROR_OBJECT (self, "Failed opening %s, not tracing", self->location);
+    return;
+  }
+  fputs ("frame_nr\tsec_offset\telement\tpad\tpeer\ttime\tlatency\n", self->file);
+
+  self->thread = g_thread_new ("timecodetracer", gst_timecode_tracer_thread, self);
+
+  GstTracer *tracer = GST_TRACER (self);
+  gst_tracing_register_hook (tracer, "pad-push-pre",
+      G_CALLBACK (gst_timecode_tracer_push_pre));
+  gst_tracing_register_hook (tracer, "pad-push-list-pre",
+      G_CALLBACK (gst_timecode_tracer_push_list_pre));
+  gst_tracing_register_hook (tracer, "pad-pull-range-post",
+      G_CALLBACK (gst_timecode_tracer_pull_range_post));
+  gst_tracing_register_hook (tracer, "element-post-message-pre",
+      G_CALLBACK (gst_timecode_tracer_post_message_pre));
+}
+
+static void
+gst_timecode_tracer_finalize (GObject * object)
+{
+  GsttimecodeTracer *self = GST_TIMECODE_TRACER (object);
+
+  if (self->thread) {
+    g_mutex_lock (&self->lock);
+    self->stopping = TRUE;
+    g_cond_signal (&self->cond);
+    g_mutex_unlock (&self->lock);
+    g_thread_join (self->thread);
+  }
+  if (self->file)
+    fclose (self->file);
+
+  /* Threads that trace on, or exit later, leave the tracer alone */
+  G_LOCK (threads);
+  for (guint i = 0; i < self->threads->len; i++) {
+    GsttimecodeTracerThread *state = g_ptr_array_index (self->threads, i);
+    state->tracer = NULL;
+    state->buffer = NULL;
+  }
+  G_UNLOCK (threads);
+
+  guint dropped = (guint) g_atomic_int_get (&self->dropped);
+  if (dropped > 0)
+    GST_WARNING_OBJECT (self, "Dropped %u pad crossings", dropped);
+
+  g_hash_table_unref (self->frames);
+  g_ptr_array_unref (self->pool);
+  g_ptr_array_unref (self->full);
+  g_ptr_array_unref (self->threads);
+  g_free (self->buffers);
+  g_free (self->location);
+  g_cond_clear (&self->cond);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_timecode_tracer_class_init (GsttimecodeTracerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->constructed = gst_timecode_tracer_constructed;
+  gobject_class->finalize = gst_timecode_tracer_finalize;
+
+  pad_quark = g_quark_from_static_string ("GsttimecodeTracerPad");
+}
+
+static void
+gst_timecode_tracer_init (GsttimecodeTracer * self)
+{
+  self->location = g_strdup (DEFAULT_LOCATION);
+  self->interval = 1;
+  self->window = DEFAULT_WINDOW;
+
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->cond);
+  self->buffers = g_new (GsttimecodeTracerBuffer, GST_TIMECODE_TRACER_N_BUFFERS);
+  self->pool = g_ptr_array_sized_new (GST_TIMECODE_TRACER_N_BUFFERS);
+  self->full = g_ptr_array_sized_new (GST_TIMECODE_TRACER_N_BUFFERS);
+  self->threads = g_ptr_array_new ();
+  for (guint i = 0; i < GST_TIMECODE_TRACER_N_BUFFERS; i++)
+    g_ptr_array_add (self->pool, &self->buffers[i]);
+  self->frames = g_hash_table_new_full (gst_timecode_tracer_frame_hash,
+      gst_timecode_tracer_frame_equal, gst_timecode_tracer_frame_free, NULL);
+}
+
+static gboolean
+timecodetracer_init (GstPlugin * plugin)
+{
+  GST_DEBUG_CATEGORY_INIT (gst_timecode_tracer_debug, "timecodetracer", 0,
+      "Per-element latency of stamped frames");
+
+  return gst_tracer_register (plugin, "timecodetracer", GST_TYPE_TIMECODE_TRACER);
+}
+
+GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
+    GST_VERSION_MINOR,
+    timecodetracer,
+    "timecodetracer",
+    timecodetracer_init,
+    PACKAGE_VERSION, GST_LICENSE, GST_PACKAGE_NAME, GST_PACKAGE_ORIGIN)
@@ -0,0 +1,90 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_TIMECODE_TRACER_H__
+#define __GST_TIMECODE_TRACER_H__
+
+#include <gst/gst.h>
+#include <stdio.h>
+
+G_BEGIN_DECLS
+
+/* Events a thread collects before handing them to the writer, and how many
+ * such buffers there are. Allocated when the tracer is created. */
+#define GST_TIMECODE_TRACER_BUFFER_EVENTS 1024
+#define GST_TIMECODE_TRACER_N_BUFFERS 64
+
+/* A stamped frame crossing a link. from pushed it through pad to to. */
+typedef struct {
+  guint64 sec_offset;
+  guint64 frame_nr;
+  GstClockTime ts;
+  GQuark from;
+  GQuark pad;
+  GQuark to;
+} GsttimecodeTracerEvent;
+
+/* Owned by one streaming thread at a time, or by the pool or the writer.
+ * n is read by the writer while a thread fills the buffer. */
+typedef struct {
+  gint n;
+  GsttimecodeTracerEvent events[GST_TIMECODE_TRACER_BUFFER_EVENTS];
+} GsttimecodeTracerBuffer;
+
+#define GST_TYPE_TIMECODE_TRACER (gst_timecode_tracer_get_type())
+G_DECLARE_FINAL_TYPE (GsttimecodeTracer, gst_timecode_tracer,
+    GST, TIMECODE_TRACER, GstTracer)
+
+struct _GsttimecodeTracer {
+  GstTracer tracer;
+
+  /* Parameters, fixed once constructed */
+  gchar *location;
+  guint interval;
+  GstClockTime window;
+
+  /* Wall clock at a tracer timestamp, to put the events on the time axis
+   * of the logs. Taken at the first event, based is set after. */
+  GstClockTime ts_base;
+  gint64 realtime_base;
+  gint based;
+
+  /* The pool, the full buffers and the threads tracing, protected by lock.
+   * The writer takes the threads' buffers every round, and all frames are
+   * written out on flush, when the pipeline is done. */
+  GMutex lock;
+  GCond cond;
+  GsttimecodeTracerBuffer *buffers;
+  GPtrArray *pool;
+  GPtrArray *full;
+  GPtrArray *threads;
+  gint dropped;
+  gboolean flush;
+  gboolean stopping;
+  GThread *thread;
+
+  /* Only used by the writer thread: the frames still collecting events */
+  FILE *file;
+  GHashTable *frames;
+};
+
+G_END_DECLS
+
+#endif /* __GST_TIMECODE_TRACER_H__ */
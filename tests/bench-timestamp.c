@@ -0,0 +1,163 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Times what a frame costs the elements for its timestamps, in ns per frame,
+ * against what it cost before they took one clock_gettime sample per frame
+ * and the log writer cached the date prefix:
+ *
+ *   sample      the wall-clock reads of a frame
+ *   ts          the ts column of a log line, for frames 1/30 s apart
+ *   log         a record pushed to a log writing to /dev/null, until the
+ *               writer has formatted and written it
+ *
+ *   bench-timestamp [FRAMES]
+ */
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <gst/gst.h>
+
+#include "gsttimecodebinlog.h"
+#include "gsttimecodelog.h"
+
+#define FRAME_USEC (G_USEC_PER_SEC / 30)
+
+/* Keeps the compiler from dropping the loops */
+static volatile guint64 sink;
+
+/* gettimeofday for the encoded value and g_get_real_time for the log record,
+ * as the elements did */
+static void
+sample_old (guint frames)
+{
+  for (guint i = 0; i < frames; i++) {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    sink += 1000000 * tv.tv_sec + tv.tv_usec;
+    sink += g_get_real_time ();
+  }
+}
+
+static void
+sample_new (guint frames)
+{
+  for (guint i = 0; i < frames; i++)
+    sink += gst_timecodelog_realtime ();
+}
+
+/* A GDateTime and a heap string per record, as the writer did */
+static void
+ts_old (guint frames)
+{
+  gint64 realtime = gst_timecodelog_realtime ();
+  gchar buf[64];
+
+  for (guint i = 0; i < frames; i++, realtime += FRAME_USEC) {
+    GDateTime *dt = g_date_time_new_from_unix_utc (realtime / G_USEC_PER_SEC);
+    gchar *ts = g_date_time_format (dt, "%Y-%m-%d %H:%M:%S");
+    g_snprintf (buf, sizeof (buf), "%s.%06dZ", ts,
+        (gint) (realtime % G_USEC_PER_SEC));
+    g_free (ts);
+    g_date_time_unref (dt);
+    sink += buf[0];
+  }
+}
+
+/* The prefix formatted once per second, as gst_timecodelog_format_ts() does */
+static void
+ts_new (guint frames)
+{
+  gint64 realtime = gst_timecodelog_realtime ();
+  gint64 prefix_second = -1;
+  gchar prefix[sizeof ("2011-10-08 07:07:09")];
+  gchar buf[64];
+
+  for (guint i = 0; i < frames; i++, realtime += FRAME_USEC) {
+    gint64 second = realtime / G_USEC_PER_SEC;
+    if (second != prefix_second) {
+      time_t t = (time_t) second;
+      struct tm tm;
+      gmtime_r (&t, &tm);
+      strftime (prefix, sizeof (prefix), "%Y-%m-%d %H:%M:%S", &tm);
+      prefix_second = second;
+    }
+    g_snprintf (buf, sizeof (buf), "%s.%06dZ", prefix,
+        (gint) (realtime % G_USEC_PER_SEC));
+    sink += buf[0];
+  }
+}
+
+static gint
+format_record (const GsttimecodelogRecord * record, const gchar * ts,
+    gchar * buf, gsize size)
+{
+  return g_snprintf (buf, size, "%s\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT
+      "\n", ts, record->frame_nr, record->time_s);
+}
+
+/* Freeing the log waits for the writer to drain the ring */
+static void
+log_new (guint frames)
+{
+  Gsttimecodelog *log = gst_timecodelog_new (NULL,
+      GST_TIMECODE_BINLOG_KIND_SENDER, "ts\tframe_nr\ttime_s\n", format_record);
+  gst_timecodelog_set_full_policy (log, GST_TIMECODELOG_FULL_POLICY_BLOCK);
+  gst_timecodelog_set_location (log, "/dev/null");
+
+  for (guint i = 0; i < frames; i++) {
+    GsttimecodelogRecord record = {
+      .realtime = gst_timecodelog_realtime (),
+      .frame_nr = i,
+    };
+    record.time_s = record.realtime;
+    gst_timecodelog_push (log, &record);
+  }
+  gst_timecodelog_free (log);
+}
+
+static void
+run (const gchar * name, void (*func) (guint), guint frames)
+{
+  gint64 start = g_get_monotonic_time ();
+  func (frames);
+  gint64 elapsed = g_get_monotonic_time () - start;
+  g_print ("%-12s %8.1f ns/frame\n", name, elapsed * 1000.0 / frames);
+}
+
+int
+main (int argc, char **argv)
+{
+  guint frames = argc > 1 ? (guint) atoi (argv[1]) : 1000000;
+
+  gst_init (&argc, &argv);
+  if (frames == 0) {
+    g_printerr ("usage: bench-timestamp [FRAMES]\n");
+    return 1;
+  }
+
+  run ("sample-old", sample_old, frames);
+  run ("sample", sample_new, frames);
+  run ("ts-old", ts_old, frames);
+  run ("ts", ts_new, frames);
+  run ("log", log_new, frames);
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Maps regions of plain system-memory frames and checks what the mapping
+ * reads and writes */
+
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "gsttimecoderegion.h"
+
+#define WIDTH 64
+#define HEIGHT 64
+
+static GstBuffer *
+new_frame (GstVideoInfo * info, guint8 value)
+{
+  gst_video_info_set_format (info, GST_VIDEO_FORMAT_I420, WIDTH, HEIGHT);
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL,
+      GST_VIDEO_INFO_SIZE (info), NULL);
+  gst_buffer_memset (buffer, 0, value, GST_VIDEO_INFO_SIZE (info));
+  return buffer;
+}
+
+/* Writes through the region reach the frame, and only the rows mapped */
+static void
+test_map_write (void)
+{
+  GstVideoInfo info;
+  GstBuffer *buffer = new_frame (&info, 0);
+  GsttimecodeRegion region;
+
+  g_assert_true (gst_timecode_region_map (&region, buffer, &info, 1 << 0,
+          16, 24, GST_MAP_WRITE));
+  for (guint y = 16; y < 24; y++)
+    memset (region.data[0] + y * region.stride[0], 0xff, region.width);
+  gst_timecode_region_unmap (&region);
+
+  gint stride = GST_VIDEO_INFO_PLANE_STRIDE (&info, 0);
+  GstMapInfo map;
+  g_assert_true (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  g_assert_cmpuint (map.data[15 * stride + WIDTH - 1], ==, 0);
+  g_assert_cmpuint (map.data[16 * stride], ==, 0xff);
+  g_assert_cmpuint (map.data[23 * stride + WIDTH - 1], ==, 0xff);
+  g_assert_cmpuint (map.data[24 * stride], ==, 0);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+}
+
+/* Rows of every plane read back at their place in the frame */
+static void
+test_map_read (void)
+{
+  GstVideoInfo info;
+  GstBuffer *buffer = new_frame (&info, 0x10);
+  GsttimecodeRegion region;
+
+  GstMapInfo map;
+  g_assert_true (gst_buffer_map (buffer, &map, GST_MAP_WRITE));
+  for (guint p = 0; p < GST_VIDEO_INFO_N_PLANES (&info); p++)
+    map.data[GST_VIDEO_INFO_PLANE_OFFSET (&info, p) +
+        10 * GST_VIDEO_INFO_PLANE_STRIDE (&info, p) + 3] = 0x80 + p;
+  gst_buffer_unmap (buffer, &map);
+
+  /* Row 10 of the chroma planes is row 20 of the frame */
+  g_assert_true (gst_timecode_region_map (&region, buffer, &info, 0x7, 20, 24,
+          GST_MAP_READ));
+  g_assert_cmpuint (region.data[0][21 * region.stride[0]], ==, 0x10);
+  g_assert_cmpuint (region.data[1][10 * region.stride[1] + 3], ==, 0x81);
+  g_assert_cmpuint (region.data[2][10 * region.stride[2] + 3], ==, 0x82);
+  gst_timecode_region_unmap (&region);
+  gst_buffer_unref (buffer);
+}
+
+int
+main (int argc, char **argv)
+{
+  gst_init (&argc, &argv);
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/region/map-write", test_map_write);
+  g_test_add_func ("/region/map-read", test_map_read);
+  return g_test_run ();
+}
@@ -0,0 +1,734 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Reads the time code from recorded video after the fact and writes the log
+ * timecodeparse would have written. Files are decoded with GStreamer, raw
+ * I420 dumps are memory-mapped. The frames are read in batches on a thread
+ * pool and logged in order.
+ *
+ *   gst-timecode-analyze [OPTION...] FILE
+ *   gst-timecode-analyze --raw=1920x1080 --fps=30 [OPTION...] FILE
+ *
+ * Latency needs the wall-clock time at which each frame was received. It is
+ * the start time (--start, or the date tag of the file) plus the running
+ * time of the frame. Without it latency is -1 and the ts column counts from
+ * the epoch.
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+
+#include "gsttimecodebinlog.h"
+#include "gsttimecodedense.h"
+#include "gsttimecodelog.h"
+#include "gsttimecodereader.h"
+
+/* Frames per job of the thread pool */
+#define BATCH 32
+
+typedef struct {
+  GsttimecodeTimestamps timestamps[GST_TIMECODE_MAX_HOPS];
+  /* Running time in µs, -1 if unknown */
+  gint64 pts;
+} Frame;
+
+/* A batch of frames. The worker reads into its own copy of the reader, which
+ * keeps state between frames. */
+typedef struct {
+  GsttimecodeReader reader;
+  GstVideoInfo info;
+  guint n_hops;
+  guint n_frames;
+  /* Either the first of n_frames frames of a raw dump or one sample each */
+  guint8 *raw;
+  GstSample *samples[BATCH];
+  Frame frames[BATCH];
+  gboolean done;
+} Job;
+
+typedef struct {
+  GsttimecodeGeometry geometry;
+  guint hops;
+  guint min_confidence;
+  /* Wall-clock time of running time 0, µs since the epoch, -1 if unknown */
+  gint64 start;
+
+  /* Set up for the current format, copied into each job */
+  GsttimecodeReader reader;
+  GstVideoInfo info;
+  guint n_hops;
+
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  /* Jobs in submission order, the head is written next */
+  GQueue pending;
+  guint max_pending;
+
+  /* Only used by the main thread, which writes the jobs in order */
+  Gsttimecodelog *log;
+  guint64 last_sec_offset[GST_TIMECODE_MAX_HOPS];
+  guint64 last_frame_nr[GST_TIMECODE_MAX_HOPS];
+  guint skip;
+  guint64 n_frames;
+  guint64 n_read;
+} Analyzer;
+
+static gboolean
+analyzer_set_info (Analyzer * an, const GstVideoInfo * info)
+{
+  an->info = *info;
+  if (!gst_timecode_reader_set_format (&an->reader, info)) {
+    g_printerr ("Unsupported format %s\n",
+        gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (info)));
+    return FALSE;
+  }
+  an->n_hops = gst_timecode_reader_set_layout (&an->reader, &an->geometry,
+      an->hops, GST_VIDEO_INFO_WIDTH (info), GST_VIDEO_INFO_HEIGHT (info));
+  if (an->n_hops < an->hops) {
+    g_printerr ("Only %u of %u code blocks fit into %dx%d frames\n",
+        an->n_hops, an->hops, GST_VIDEO_INFO_WIDTH (info),
+        GST_VIDEO_INFO_HEIGHT (info));
+    return FALSE;
+  }
+  gst_timecodelog_set_video_info (an->log, GST_VIDEO_INFO_WIDTH (info),
+      GST_VIDEO_INFO_HEIGHT (info), GST_VIDEO_INFO_FPS_N (info),
+      GST_VIDEO_INFO_FPS_D (info));
+  return TRUE;
+}
+
+static Job *
+job_new (Analyzer * an)
+{
+  Job *job = g_new0 (Job, 1);
+  job->reader = an->reader;
+  job->info = an->info;
+  job->n_hops = an->n_hops;
+  return job;
+}
+
+static void
+job_free (Job * job)
+{
+  for (guint i = 0; i < job->n_frames; i++)
+    if (job->samples[i])
+      gst_sample_unref (job->samples[i]);
+  g_free (job);
+}
+
+/* Runs on the thread pool */
+static void
+analyze_job (gpointer data, gpointer user_data)
+{
+  Job *job = data;
+  Analyzer *an = user_data;
+  guint first, last;
+  guint planes = gst_timecode_reader_get_region (&job->reader, job->n_hops,
+      &first, &last);
+
+  for (guint i = 0; i < job->n_frames; i++) {
+    Frame *frame = &job->frames[i];
+    GsttimecodeRegion region;
+
+    for (guint hop = 0; hop < job->n_hops; hop++)
+      frame->timestamps[hop] =
+          (GsttimecodeTimestamps) GST_TIMECODE_TIMESTAMPS_INIT;
+
+    if (job->raw) {
+      gst_timecode_region_wrap (&region, &job->info,
+          job->raw + i * GST_VIDEO_INFO_SIZE (&job->info));
+    } else if (!gst_timecode_region_map (&region,
+            gst_sample_get_buffer (job->samples[i]), &job->info, planes,
+            first, last, GST_MAP_READ)) {
+      continue;
+    }
+
+    for (guint hop = 0; hop < job->n_hops; hop++)
+      gst_timecode_reader_read (&job->reader, hop, &region,
+          &frame->timestamps[hop]);
+
+    if (!job->raw)
+      gst_timecode_region_unmap (&region);
+  }
+
+  g_mutex_lock (&an->lock);
+  job->done = TRUE;
+  g_cond_broadcast (&an->cond);
+  g_mutex_unlock (&an->lock);
+}
+
+/* Workers unwrap the frame_nr of dense blocks within their batch only, so
+ * it is unwrapped again across batches here */
+static void
+unwrap_frame_nr (Analyzer * an, const Job * job, guint hop,
+    GsttimecodeTimestamps * timestamps)
+{
+  if (job->reader.layout[hop].encoding != GST_TIMECODE_ENCODING_DENSE ||
+      timestamps->sec_offset == 0)
+    return;
+
+  if (timestamps->sec_offset != an->last_sec_offset[hop])
+    an->last_frame_nr[hop] = 0;
+  guint64 low = timestamps->frame_nr &
+      ((G_GUINT64_CONSTANT (1) << GST_TIMECODE_DENSE_FRAME_NR_BITS) - 1);
+  an->last_frame_nr[hop] = gst_timecode_dense_unwrap (low,
+      GST_TIMECODE_DENSE_FRAME_NR_BITS, an->last_frame_nr[hop]);
+  an->last_sec_offset[hop] = timestamps->sec_offset;
+  timestamps->frame_nr = an->last_frame_nr[hop];
+}
+
+/* Logs one record per block like timecodeparse does */
+static void
+write_frame (Analyzer * an, const Job * job, const Frame * frame)
+{
+  gint64 realtime = -1;
+  gint64 prev_stamp = -1;
+
+  if (an->start >= 0 && frame->pts >= 0)
+    realtime = an->start + frame->pts;
+
+  for (guint hop = 0; hop < job->n_hops; hop++) {
+    GsttimecodeTimestamps timestamps = frame->timestamps[hop];
+    unwrap_frame_nr (an, job, hop, &timestamps);
+    if (realtime >= 0)
+      gst_timecode_reader_complete (&job->reader, hop, realtime, &timestamps);
+
+    guint64 sec_offset = timestamps.sec_offset;
+    guint64 time_s = timestamps.render_realtime;
+    gboolean stamped = sec_offset != 0 && time_s != 0;
+
+    if (hop == 0) {
+      /* A frame the sender did not stamp, see GsttimecodeSampler */
+      if (!stamped && an->skip > 0) {
+        an->skip--;
+        return;
+      }
+      an->skip = stamped ? (1 << timestamps.interval_log2) - 1 : 0;
+      an->n_read += stamped;
+    } else if (!stamped) {
+      prev_stamp = -1;
+      continue;
+    }
+
+    gint64 stamp = sec_offset * G_USEC_PER_SEC + time_s;
+    guint64 now = realtime >= 0 ? realtime - sec_offset * G_USEC_PER_SEC : 0;
+    gint64 latency = -1;
+    if (stamped && realtime >= 0)
+      latency = now - time_s;
+    if (latency > 30 * G_USEC_PER_SEC || latency < 0)
+      latency = -1;
+
+    GsttimecodelogRecord record = {
+      .realtime = realtime >= 0 ? realtime : MAX (frame->pts, 0),
+      .frame_nr = timestamps.frame_nr,
+      .time_s = time_s,
+      .time_p = now,
+      .latency = latency,
+      .sec_offset = sec_offset,
+      .hop = hop,
+      .hop_delta = prev_stamp < 0 || !stamped ? -1 : stamp - prev_stamp,
+      .clock_error = -1,
+      .render_latency = -1,
+    };
+    gst_timecodelog_push (an->log, &record);
+    prev_stamp = stamped ? stamp : -1;
+  }
+}
+
+/* Waits for the oldest job and logs its frames */
+static void
+write_next (Analyzer * an)
+{
+  Job *job = g_queue_pop_head (&an->pending);
+
+  g_mutex_lock (&an->lock);
+  while (!job->done)
+    g_cond_wait (&an->cond, &an->lock);
+  g_mutex_unlock (&an->lock);
+
+  for (guint i = 0; i < job->n_frames; i++)
+    write_frame (an, job, &job->frames[i]);
+  an->n_frames += job->n_frames;
+  job_free (job);
+}
+
+static void
+submit (Analyzer * an, Job * job)
+{
+  if (job->n_frames == 0) {
+    job_free (job);
+    return;
+  }
+
+  g_queue_push_tail (&an->pending, job);
+  g_thread_pool_push (an->pool, job, NULL);
+  while (g_queue_get_length (&an->pending) >= an->max_pending)
+    write_next (an);
+}
+
+static int
+analyze_raw (Analyzer * an, const gchar * path, gint width, gint height,
+    gint fps_n, gint fps_d)
+{
+  GstVideoInfo info;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, width, height);
+  GST_VIDEO_INFO_FPS_N (&info) = fps_n;
+  GST_VIDEO_INFO_FPS_D (&info) = fps_d;
+  if (!analyzer_set_info (an, &info))
+    return 1;
+
+  int fd = open (path, O_RDONLY);
+  if (fd < 0) {
+    perror (path);
+    return 1;
+  }
+  struct stat st;
+  if (fstat (fd, &st) < 0) {
+    perror (path);
+    close (fd);
+    return 1;
+  }
+  guint64 n_frames = st.st_size / GST_VIDEO_INFO_SIZE (&info);
+  if (n_frames == 0) {
+    fprintf (stderr, "%s: shorter than one %dx%d frame\n", path, width, height);
+    close (fd);
+    return 1;
+  }
+  gsize size = n_frames * GST_VIDEO_INFO_SIZE (&info);
+  guint8 *data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED) {
+    perror (path);
+    return 1;
+  }
+  madvise (data, size, MADV_SEQUENTIAL);
+
+  for (guint64 first = 0; first < n_frames; first += BATCH) {
+    Job *job = job_new (an);
+    job->raw = data + first * GST_VIDEO_INFO_SIZE (&info);
+    job->n_frames = MIN (n_frames - first, BATCH);
+    for (guint i = 0; i < job->n_frames; i++)
+      job->frames[i].pts = gst_util_uint64_scale (first + i,
+          G_USEC_PER_SEC * fps_d, fps_n);
+    submit (an, job);
+  }
+  while (!g_queue_is_empty (&an->pending))
+    write_next (an);
+
+  munmap (data, size);
+  return 0;
+}
+
+/* Takes the start time from the date tag of the file, which e.g. matroskamux
+ * writes when the recording starts */
+static void
+handle_messages (Analyzer * an, GstBus * bus, gboolean have_start)
+{
+  GstMessage *msg;
+
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_TAG))) {
+    GstTagList *tags;
+    GstDateTime *date_time;
+
+    gst_message_parse_tag (msg, &tags);
+    if (!have_start && an->start < 0 &&
+        gst_tag_list_get_date_time (tags, GST_TAG_DATE_TIME, &date_time)) {
+      GDateTime *dt = gst_date_time_to_g_date_time (date_time);
+      if (dt) {
+        an->start = g_date_time_to_unix (dt) * G_USEC_PER_SEC +
+            g_date_time_get_microsecond (dt);
+        g_date_time_unref (dt);
+      }
+      gst_date_time_unref (date_time);
+    }
+    gst_tag_list_unref (tags);
+    gst_message_unref (msg);
+  }
+}
+
+/* Prints the first error on the bus, if there is one */
+static gboolean
+report_error (GstBus * bus, const gchar * path)
+{
+  GstMessage *msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+  if (!msg)
+    return FALSE;
+
+  GError *error = NULL;
+  gchar *debug;
+  gst_message_parse_error (msg, &error, &debug);
+  g_printerr ("%s: %s\n", path, error->message);
+  g_clear_error (&error);
+  g_free (debug);
+  gst_message_unref (msg);
+  return TRUE;
+}
+
+static int
+analyze_file (Analyzer * an, const gchar * path)
+{
+  GError *error = NULL;
+  gchar *uri = gst_uri_is_valid (path) ? g_strdup (path) :
+      gst_filename_to_uri (path, &error);
+  if (!uri) {
+    g_printerr ("%s: %s\n", path, error->message);
+    g_clear_error (&error);
+    return 1;
+  }
+
+  /* The decoder may run threads of its own, the frames are read on the
+   * pool. Nothing is synchronised to the clock. */
+  GstElement *pipeline = gst_parse_launch ("uridecodebin name=src ! "
+      "videoconvert ! appsink name=sink sync=false", &error);
+  if (!pipeline) {
+    g_printerr ("Failed to create the pipeline: %s\n", error->message);
+    g_clear_error (&error);
+    g_free (uri);
+    return 1;
+  }
+  GstElement *src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "uri", uri, NULL);
+  gst_object_unref (src);
+  g_free (uri);
+
+  GstElement *sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  GstCaps *caps = gst_caps_from_string (GST_TIMECODE_VIDEO_CAPS);
+  g_object_set (sink, "caps", caps, "max-buffers", BATCH * 2, NULL);
+  gst_caps_unref (caps);
+
+  GstBus *bus = gst_element_get_bus (pipeline);
+  gboolean have_start = an->start >= 0;
+  int ret = 0;
+  if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE) {
+    if (!report_error (bus, path))
+      g_printerr ("%s: Failed to start decoding\n", path);
+    ret = 1;
+  }
+
+  GstCaps *current = NULL;
+  Job *job = NULL;
+  while (ret == 0) {
+    /* Errors stop the decoder without an EOS the sink could return */
+    GstSample *sample = gst_app_sink_try_pull_sample (GST_APP_SINK (sink),
+        100 * GST_MSECOND);
+    if (!sample) {
+      if (report_error (bus, path))
+        ret = 1;
+      else if (!gst_app_sink_is_eos (GST_APP_SINK (sink)))
+        continue;
+      break;
+    }
+    handle_messages (an, bus, have_start);
+
+    GstCaps *sample_caps = gst_sample_get_caps (sample);
+    if (!current || !gst_caps_is_equal (current, sample_caps)) {
+      GstVideoInfo info;
+      if (job)
+        submit (an, job);
+      job = NULL;
+      if (!gst_video_info_from_caps (&info, sample_caps) ||
+          !analyzer_set_info (an, &info)) {
+        gst_sample_unref (sample);
+        ret = 1;
+        break;
+      }
+      gst_caps_replace (&current, sample_caps);
+    }
+
+    if (!job)
+      job = job_new (an);
+    GstBuffer *buffer = gst_sample_get_buffer (sample);
+    GstClockTime running_time = gst_segment_to_running_time (
+        gst_sample_get_segment (sample), GST_FORMAT_TIME,
+        GST_BUFFER_PTS (buffer));
+    Frame *frame = &job->frames[job->n_frames];
+    frame->pts = GST_CLOCK_TIME_IS_VALID (running_time) ?
+        (gint64) (running_time / GST_USECOND) : -1;
+    job->samples[job->n_frames++] = sample;
+    if (job->n_frames == BATCH) {
+      submit (an, job);
+      job = NULL;
+    }
+  }
+  if (job)
+    submit (an, job);
+  while (!g_queue_is_empty (&an->pending))
+    write_next (an);
+  gst_caps_replace (&current, NULL);
+
+  if (ret == 0 && report_error (bus, path))
+    ret = 1;
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+  return ret;
+}
+
+/* µs since the epoch, or an ISO 8601 date */
+static gboolean
+parse_start (const gchar * arg, gint64 * start)
+{
+  gchar *end;
+  gint64 us = g_ascii_strtoll (arg, &end, 10);
+  if (*arg && *end == '\0') {
+    *start = us;
+    return TRUE;
+  }
+
+  GDateTime *dt = g_date_time_new_from_iso8601 (arg, NULL);
+  if (!dt)
+    return FALSE;
+  *start = g_date_time_to_unix (dt) * G_USEC_PER_SEC +
+      g_date_time_get_microsecond (dt);
+  g_date_time_unref (dt);
+  return TRUE;
+}
+
+static gboolean
+parse_enum (GType type, const gchar * arg, gint * value)
+{
+  GEnumClass *klass = g_type_class_ref (type);
+  GEnumValue *v = g_enum_get_value_by_nick (klass, arg);
+  if (v)
+    *value = v->value;
+  g_type_class_unref (klass);
+  return v != NULL;
+}
+
+/* Flag nicks separated by '+', as gst-launch takes them */
+static gboolean
+parse_flags (GType type, const gchar * arg, guint * value)
+{
+  GFlagsClass *klass = g_type_class_ref (type);
+  gchar **nicks = g_strsplit (arg, "+", -1);
+  gboolean ok = TRUE;
+
+  *value = 0;
+  for (guint i = 0; ok && nicks[i]; i++) {
+    GFlagsValue *v = g_flags_get_value_by_nick (klass, nicks[i]);
+    if (v)
+      *value |= v->value;
+    else
+      ok = FALSE;
+  }
+  g_strfreev (nicks);
+  g_type_class_unref (klass);
+  return ok;
+}
+
+static void
+usage (FILE *out, const char *prog)
+{
+  fprintf (out, "Usage: %s [OPTION...] FILE\n"
+      "Read the time code from a recording and write the timecodeparse log.\n\n"
+      "  -r, --raw=WxH             FILE is a raw I420 dump of WxH frames\n"
+      "  -f, --fps=N[/D]           frame rate of the raw dump (default 30)\n"
+      "  -s, --start=TIME          wall-clock time of the first frame, µs since\n"
+      "                            the epoch or ISO 8601 (default: date tag)\n"
+      "  -j, --threads=N           threads reading frames (default: all cores)\n"
+      "  -o, --output=FILE         log file (default: stdout)\n"
+      "  -b, --binary              write the binary log format\n"
+      "  -n, --hops=N              code blocks to read (default 1)\n"
+      "  -e, --encoding=NAME       binary or dense, as set on timecodeoverlay\n"
+      "  -a, --anchor=NAME         top-left, top-right, bottom-left, bottom-right\n"
+      "  -x, --margin-x=N          horizontal margin\n"
+      "  -y, --margin-y=N          vertical margin\n"
+      "  -c, --cell-size=N         cell size, 0 to scale the reference layout\n"
+      "  -A, --align=N             codec block size the code is snapped to\n"
+      "  -F, --fields=A+B          timing fields of the dense code, e.g.\n"
+      "                            clock-time+render-time\n"
+      "  -m, --min-confidence=N    minimum confidence of binary words (0-100)\n"
+      "  -h, --help                show this help\n", prog);
+}
+
+int
+main (int argc, char **argv)
+{
+  Analyzer an = {
+    .geometry = GST_TIMECODE_GEOMETRY_INIT,
+    .hops = 1,
+    .min_confidence = GST_TIMECODE_READER_DEFAULT_MIN_CONFIDENCE,
+    .start = -1,
+  };
+  gint width = 0, height = 0, fps_n = 30, fps_d = 1;
+  guint threads = g_get_num_processors ();
+  const gchar *output = "/dev/stdout";
+  gboolean binary = FALSE;
+  static const struct option options[] = {
+    {"raw", required_argument, NULL, 'r'},
+    {"fps", required_argument, NULL, 'f'},
+    {"start", required_argument, NULL, 's'},
+    {"threads", required_argument, NULL, 'j'},
+    {"output", required_argument, NULL, 'o'},
+    {"binary", no_argument, NULL, 'b'},
+    {"hops", required_argument, NULL, 'n'},
+    {"encoding", required_argument, NULL, 'e'},
+    {"anchor", required_argument, NULL, 'a'},
+    {"margin-x", required_argument, NULL, 'x'},
+    {"margin-y", required_argument, NULL, 'y'},
+    {"cell-size", required_argument, NULL, 'c'},
+    {"align", required_argument, NULL, 'A'},
+    {"fields", required_argument, NULL, 'F'},
+    {"min-confidence", required_argument, NULL, 'm'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+  int opt;
+  gint value;
+
+  gst_init (&argc, &argv);
+
+  while ((opt = getopt_long (argc, argv, "r:f:s:j:o:bn:e:a:x:y:c:A:F:m:h",
+              options, NULL)) != -1) {
+    switch (opt) {
+      case 'r':
+        if (sscanf (optarg, "%dx%d", &width, &height) != 2 || width <= 0 ||
+            height <= 0) {
+          fprintf (stderr, "Invalid frame size %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'f':
+        if (sscanf (optarg, "%d/%d", &fps_n, &fps_d) < 1 || fps_n <= 0 ||
+            fps_d <= 0) {
+          fprintf (stderr, "Invalid frame rate %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 's':
+        if (!parse_start (optarg, &an.start)) {
+          fprintf (stderr, "Invalid start time %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'j':
+        threads = CLAMP (strtoul (optarg, NULL, 10), 1, 256);
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'b':
+        binary = TRUE;
+        break;
+      case 'n':
+        an.hops = CLAMP (strtoul (optarg, NULL, 10), 1, GST_TIMECODE_MAX_HOPS);
+        break;
+      case 'e':
+        if (!parse_enum (GST_TYPE_TIMECODE_ENCODING, optarg, &value)) {
+          fprintf (stderr, "Unknown encoding %s\n", optarg);
+          return 2;
+        }
+        an.geometry.encoding = value;
+        break;
+      case 'a':
+        if (!parse_enum (GST_TYPE_TIMECODE_ANCHOR, optarg, &value)) {
+          fprintf (stderr, "Unknown anchor %s\n", optarg);
+          return 2;
+        }
+        an.geometry.anchor = value;
+        break;
+      case 'x':
+        an.geometry.margin_x = strtoul (optarg, NULL, 10);
+        break;
+      case 'y':
+        an.geometry.margin_y = strtoul (optarg, NULL, 10);
+        break;
+      case 'c':
+        an.geometry.cell_size = strtoul (optarg, NULL, 10);
+        break;
+      case 'A':
+        an.geometry.align = MIN (strtoul (optarg, NULL, 10),
+            GST_TIMECODE_MAX_ALIGN);
+        break;
+      case 'F':
+        if (!parse_flags (GST_TYPE_TIMECODE_FIELDS, optarg,
+                &an.geometry.fields)) {
+          fprintf (stderr, "Unknown fields %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'm':
+        an.min_confidence = MIN (strtoul (optarg, NULL, 10), 100);
+        break;
+      case 'h':
+        usage (stdout, argv[0]);
+        return 0;
+      default:
+        usage (stderr, argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage (stderr, argv[0]);
+    return 2;
+  }
+
+  gst_timecode_reader_init (&an.reader);
+  an.reader.min_confidence = an.min_confidence;
+
+  an.log = gst_timecodelog_new (NULL, GST_TIMECODE_BINLOG_KIND_RECEIVER,
+      gst_timecode_reader_log_columns, gst_timecode_reader_format_record);
+  gst_timecodelog_set_full_policy (an.log, GST_TIMECODELOG_FULL_POLICY_BLOCK);
+  gchar *stream_id = g_path_get_basename (argv[optind]);
+  gst_timecodelog_set_stream_id (an.log, stream_id);
+  g_free (stream_id);
+  gst_timecodelog_set_format (an.log, binary ?
+      GST_TIMECODELOG_FORMAT_BINARY : GST_TIMECODELOG_FORMAT_TEXT);
+  if (!gst_timecodelog_set_location (an.log, output)) {
+    fprintf (stderr, "Failed to open %s\n", output);
+    gst_timecodelog_free (an.log);
+    return 1;
+  }
+
+  g_mutex_init (&an.lock);
+  g_cond_init (&an.cond);
+  g_queue_init (&an.pending);
+  an.max_pending = threads * 4;
+  an.pool = g_thread_pool_new (analyze_job, &an, threads, TRUE, NULL);
+
+  int ret;
+  if (width > 0)
+    ret = analyze_raw (&an, argv[optind], width, height, fps_n, fps_d);
+  else
+    ret = analyze_file (&an, argv[optind]);
+
+  g_thread_pool_free (an.pool, FALSE, TRUE);
+  gst_timecodelog_free (an.log);
+  g_cond_clear (&an.cond);
+  g_mutex_clear (&an.lock);
+
+  fprintf (stderr, "%" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT
+      " stamps read\n", an.n_frames, an.n_read);
+  return ret;
+}
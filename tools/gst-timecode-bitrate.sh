@@ -0,0 +1,56 @@
+#!/bin/sh
+# Measures how many bits the encoder spends on the code drawn by
+# timecodeoverlay. The same test video is encoded at a fixed quantizer
+# without the overlay and with several overlay settings, so any difference
+# in file size is the cost of the code.
+#
+#   gst-timecode-bitrate.sh [BUILDDIR]
+#
+# BUILDDIR is added to GST_PLUGIN_PATH. The environment variables below
+# change the test; a fixed quantizer matters, with a target bitrate the
+# encoder would pay for the code in quality instead of size.
+
+BUILDDIR=${1:-builddir}
+WIDTH=${WIDTH:-1920}
+HEIGHT=${HEIGHT:-1080}
+FPS=${FPS:-30}
+FRAMES=${FRAMES:-300}
+SRC=${SRC:-"videotestsrc pattern=smpte horizontal-speed=2"}
+ENCODER=${ENCODER:-"x264enc pass=quant quantizer=30 speed-preset=veryfast tune=zerolatency key-int-max=60"}
+
+export GST_PLUGIN_PATH="$BUILDDIR${GST_PLUGIN_PATH:+:$GST_PLUGIN_PATH}"
+
+if ! gst-inspect-1.0 timecodeoverlay > /dev/null 2>&1; then
+  echo "timecodeoverlay not found in $BUILDDIR" >&2
+  exit 1
+fi
+
+OUT=$(mktemp)
+trap 'rm -f "$OUT"' EXIT
+
+# Prints the bitrate in kbit/s of the encoded stream, given the overlay
+# element or nothing
+encode () {
+  # shellcheck disable=SC2086
+  gst-launch-1.0 -q $SRC num-buffers="$FRAMES" \
+      ! "video/x-raw,format=I420,width=$WIDTH,height=$HEIGHT,framerate=$FPS/1" \
+      ${1:+! $1} ! $ENCODER ! filesink location="$OUT" || exit 1
+  bytes=$(wc -c < "$OUT")
+  echo $((bytes * 8 * FPS / FRAMES / 1000))
+}
+
+BASE=$(encode "") || exit 1
+printf "%-30s %10s %10s %10s\n" "overlay" "kbit/s" "+kbit/s" "+%"
+printf "%-30s %10d %10s %10s\n" "none" "$BASE" "-" "-"
+
+for settings in \
+    "encoding=binary" \
+    "encoding=binary align=16" \
+    "encoding=binary align=64" \
+    "encoding=dense" \
+    "encoding=dense align=16" \
+    "encoding=dense align=64"; do
+  RATE=$(encode "timecodeoverlay location=/dev/null $settings") || exit 1
+  awk -v s="$settings" -v r="$RATE" -v b="$BASE" \
+      'BEGIN { printf "%-30s %10d %10d %10.1f\n", s, r, r - b, (r - b) * 100 / b }'
+done
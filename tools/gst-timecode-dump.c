@@ -0,0 +1,402 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Reads the binary logs of timecodeoverlay and timecodeparse
+ * (log-format=binary) and prints them as the tab-separated text log, a
+ * summary, or a single frame. Files several elements shared are split by
+ * stream with --stream.
+ *
+ *   gst-timecode-dump [--csv | --summary | --frame=N] [--stream=NAME] FILE
+ */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gst-timecode-logfile.h"
+
+/* Hops the summary keeps delta statistics for */
+#define MAX_HOPS 16
+
+/* The names the stream announcements gave so far, and the stream to print */
+static StreamNames streams;
+static const char *only_stream;
+
+/* Whether r is a frame of the stream to print. Announcements are taken note
+ * of and skipped; they come before the first record of their stream. */
+static int
+wanted (const Record *r)
+{
+  if (r->flags & GST_TIMECODE_BINLOG_FLAG_STREAM) {
+    stream_names_set (&streams, r->stream, r->stream_name);
+    return 0;
+  }
+  if (!only_stream)
+    return 1;
+  const char *name = stream_names_get (&streams, r->stream);
+  return strcmp (name ? name : "", only_stream) == 0;
+}
+
+/* Frame number of the hop 0 record that record i belongs to. Records of later
+ * hops follow their hop 0 record, which keeps this key sorted as long as a
+ * single stream wrote the file. Announcements have frame 0. */
+static uint64_t
+binlog_frame_key (const Binlog *log, uint64_t i, Record *r)
+{
+  binlog_get (log, i, r);
+  while (r->hop != 0 && i > 0)
+    binlog_get (log, --i, r);
+  return r->frame_nr;
+}
+
+/* Same columns and formatting as the text log of the element that wrote the
+ * file. The wall-clock ts column is sec_offset plus time_s (sender) or time_p
+ * (receiver), which is exactly what the elements logged. */
+static void
+print_record (const Binlog *log, const Record *r)
+{
+  static int64_t cached_second = -1;
+  static char prefix[sizeof ("2011-10-08 07:07:09")];
+
+  uint64_t realtime = r->sec_offset * 1000000 +
+      (log->kind == GST_TIMECODE_BINLOG_KIND_SENDER ? r->time_s : r->time_p);
+  int64_t second = realtime / 1000000;
+  if (second != cached_second) {
+    time_t t = second;
+    struct tm tm;
+    gmtime_r (&t, &tm);
+    strftime (prefix, sizeof (prefix), "%Y-%m-%d %H:%M:%S", &tm);
+    cached_second = second;
+  }
+
+  const char *name = stream_names_get (&streams, r->stream);
+  if (log->kind == GST_TIMECODE_BINLOG_KIND_SENDER)
+    printf ("%s.%06dZ\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRId64 "\t%"
+        PRId64 "\t%s\n", prefix, (int) (realtime % 1000000), r->frame_nr,
+        r->time_s, r->sec_offset, r->clock_offset, r->clock_error,
+        name ? name : "");
+  else
+    printf ("%s.%06dZ\t%" PRIu64 "\t%" PRId64 "\t%" PRIu64 "\t%" PRIu64 "\t%"
+        PRIu64 "\t%" PRIu32 "\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%" PRIu64
+        "\t%" PRId64 "\t%s\n", prefix, (int) (realtime % 1000000), r->frame_nr,
+        r->latency, r->time_s, r->time_p, r->sec_offset, r->hop, r->hop_delta,
+        r->clock_offset, r->clock_error, r->time_r, r->render_latency,
+        name ? name : "");
+}
+
+static void
+print_columns (const Binlog *log)
+{
+  if (log->kind == GST_TIMECODE_BINLOG_KIND_SENDER)
+    fputs ("ts\tframe_nr\ttime_s\tsec_offset\tclock_offset\tclock_error"
+        "\tstream\n", stdout);
+  else
+    fputs ("ts\tframe_nr\tlatency\ttime_s\ttime_p\tsec_offset\thop\thop_delta"
+        "\tclock_offset\tclock_error\ttime_r\trender_latency\tstream\n", stdout);
+}
+
+static void
+dump_csv (const Binlog *log)
+{
+  Record r;
+
+  print_columns (log);
+  for (uint64_t i = 0; i < log->n_records; i++) {
+    binlog_get (log, i, &r);
+    if (wanted (&r))
+      print_record (log, &r);
+  }
+}
+
+/* The records of frame_nr in the selected stream, looked for front to back
+ * as the frames of several streams interleave */
+static int
+dump_frame_scan (const Binlog *log, uint64_t frame_nr)
+{
+  Record r;
+  int found = 0;
+
+  for (uint64_t i = 0; i < log->n_records; i++) {
+    binlog_get (log, i, &r);
+    if (!wanted (&r))
+      continue;
+    if (r.hop == 0) {
+      if (found)
+        break;
+      if (r.frame_nr != frame_nr)
+        continue;
+      print_columns (log);
+      found = 1;
+    }
+    if (found)
+      print_record (log, &r);
+  }
+  return found ? 0 : -1;
+}
+
+/* Frame numbers start at 0 and normally increase by one per record, so the
+ * record index is a good first guess. Fall back to a binary search when frames
+ * were lost or the log starts in the middle of a stream. */
+static int
+dump_frame (const Binlog *log, uint64_t frame_nr)
+{
+  Record r;
+  uint64_t start = 0;
+
+  if (log->n_streams > 1)
+    return dump_frame_scan (log, frame_nr);
+
+  /* The announcement of the only stream comes first */
+  for (; start < log->n_records; start++) {
+    binlog_get (log, start, &r);
+    if (!(r.flags & GST_TIMECODE_BINLOG_FLAG_STREAM))
+      break;
+    wanted (&r);
+  }
+  if (start == log->n_records || (only_stream && !wanted (&r)))
+    return -1;
+
+  uint64_t first = r.frame_nr;
+  uint64_t lo = start, hi = log->n_records;
+  if (frame_nr >= first && frame_nr - first < log->n_records - start) {
+    lo = start + frame_nr - first;
+    binlog_get (log, lo, &r);
+    if (r.frame_nr == frame_nr && r.hop == 0)
+      goto found;
+    lo = start;
+  }
+
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (binlog_frame_key (log, mid, &r) < frame_nr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == log->n_records)
+    return -1;
+  binlog_get (log, lo, &r);
+  if (r.frame_nr != frame_nr)
+    return -1;
+
+found:
+  /* Also print the records the later hops left in the same frame */
+  print_columns (log);
+  do {
+    print_record (log, &r);
+    if (++lo == log->n_records)
+      break;
+    binlog_get (log, lo, &r);
+  } while (r.hop != 0);
+  return 0;
+}
+
+static void
+dump_summary (const Binlog *log)
+{
+  uint64_t missing = 0, repeated = 0, restarts = 0;
+  uint64_t no_latency = 0, no_sec_offset = 0, n_latency = 0;
+  int64_t lat_min = INT64_MAX, lat_max = INT64_MIN;
+  double lat_sum = 0;
+  uint64_t n_render = 0;
+  int64_t render_min = INT64_MAX, render_max = INT64_MIN;
+  double render_sum = 0;
+  uint64_t first_frame = 0, last_frame = 0;
+  uint64_t hop_n[MAX_HOPS] = { 0 };
+  int64_t hop_min[MAX_HOPS], hop_max[MAX_HOPS];
+  double hop_sum[MAX_HOPS] = { 0 };
+  uint64_t n_records = 0;
+  Record r, prev = { 0 };
+
+  for (uint64_t i = 0; i < log->n_records; i++) {
+    binlog_get (log, i, &r);
+    if (!wanted (&r))
+      continue;
+    n_records++;
+    /* Later hops only contribute their deltas */
+    if (r.hop != 0) {
+      if (r.hop < MAX_HOPS && r.hop_delta >= 0) {
+        if (hop_n[r.hop] == 0 || r.hop_delta < hop_min[r.hop])
+          hop_min[r.hop] = r.hop_delta;
+        if (hop_n[r.hop] == 0 || r.hop_delta > hop_max[r.hop])
+          hop_max[r.hop] = r.hop_delta;
+        hop_sum[r.hop] += r.hop_delta;
+        hop_n[r.hop]++;
+      }
+      continue;
+    }
+    if (n_records == 1) {
+      first_frame = r.frame_nr;
+    } else {
+      if (r.sec_offset != 0 && prev.sec_offset != 0 && r.sec_offset != prev.sec_offset)
+        restarts++;
+      else if (r.frame_nr > prev.frame_nr + 1)
+        missing += r.frame_nr - prev.frame_nr - 1;
+      else if (r.frame_nr <= prev.frame_nr)
+        repeated++;
+    }
+    last_frame = r.frame_nr;
+
+    if (r.flags & GST_TIMECODE_BINLOG_FLAG_NO_SEC_OFFSET)
+      no_sec_offset++;
+    if (log->kind == GST_TIMECODE_BINLOG_KIND_RECEIVER) {
+      if (r.flags & GST_TIMECODE_BINLOG_FLAG_NO_LATENCY) {
+        no_latency++;
+      } else {
+        n_latency++;
+        lat_sum += r.latency;
+        if (r.latency < lat_min)
+          lat_min = r.latency;
+        if (r.latency > lat_max)
+          lat_max = r.latency;
+      }
+      if (r.render_latency >= 0) {
+        n_render++;
+        render_sum += r.render_latency;
+        if (r.render_latency < render_min)
+          render_min = r.render_latency;
+        if (r.render_latency > render_max)
+          render_max = r.render_latency;
+      }
+    }
+    prev = r;
+  }
+
+  printf ("kind\t%s\n", log->kind == GST_TIMECODE_BINLOG_KIND_SENDER ?
+      "sender" : "receiver");
+  printf ("sec_offset\t%" PRIu64 "\n", log->sec_offset);
+  printf ("video\t%" PRIu32 "x%" PRIu32 " @ %" PRId32 "/%" PRId32 "\n",
+      log->width, log->height, log->fps_n, log->fps_d);
+  if (only_stream)
+    printf ("stream\t%s\n", only_stream);
+  printf ("records\t%" PRIu64 "\n", n_records);
+  if (n_records == 0)
+    return;
+  printf ("frames\t%" PRIu64 "-%" PRIu64 "\n", first_frame, last_frame);
+  printf ("missing\t%" PRIu64 "\n", missing);
+  printf ("out_of_order\t%" PRIu64 "\n", repeated);
+  printf ("restarts\t%" PRIu64 "\n", restarts);
+  printf ("no_sec_offset\t%" PRIu64 "\n", no_sec_offset);
+  if (log->kind == GST_TIMECODE_BINLOG_KIND_RECEIVER) {
+    printf ("no_latency\t%" PRIu64 "\n", no_latency);
+    if (n_latency > 0)
+      printf ("latency_us\tmin=%" PRId64 " mean=%.0f max=%" PRId64 "\n",
+          lat_min, lat_sum / n_latency, lat_max);
+    if (n_render > 0)
+      printf ("render_latency_us\tmin=%" PRId64 " mean=%.0f max=%" PRId64 "\n",
+          render_min, render_sum / n_render, render_max);
+    for (unsigned hop = 1; hop < MAX_HOPS; hop++)
+      if (hop_n[hop] > 0)
+        printf ("hop%u_delta_us\tmin=%" PRId64 " mean=%.0f max=%" PRId64 "\n",
+            hop, hop_min[hop], hop_sum[hop] / hop_n[hop], hop_max[hop]);
+  }
+}
+
+static void
+usage (FILE *out, const char *prog)
+{
+  fprintf (out, "Usage: %s [--csv | --summary | --frame=N] [--stream=NAME] FILE\n"
+      "Convert a binary timecodeoverlay/timecodeparse log.\n\n"
+      "  -c, --csv          print the log in the text log format (default)\n"
+      "  -s, --summary      print frame and latency statistics\n"
+      "  -f, --frame=N      print the record of frame N\n"
+      "  -S, --stream=NAME  only use the records of the stream NAME\n"
+      "  -h, --help         show this help\n", prog);
+}
+
+int
+main (int argc, char **argv)
+{
+  enum { MODE_CSV, MODE_SUMMARY, MODE_FRAME } mode = MODE_CSV;
+  uint64_t frame_nr = 0;
+  static const struct option options[] = {
+    {"csv", no_argument, NULL, 'c'},
+    {"summary", no_argument, NULL, 's'},
+    {"frame", required_argument, NULL, 'f'},
+    {"stream", required_argument, NULL, 'S'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+  int opt;
+
+  while ((opt = getopt_long (argc, argv, "csf:S:h", options, NULL)) != -1) {
+    switch (opt) {
+      case 'c':
+        mode = MODE_CSV;
+        break;
+      case 's':
+        mode = MODE_SUMMARY;
+        break;
+      case 'f':
+        mode = MODE_FRAME;
+        frame_nr = strtoull (optarg, NULL, 10);
+        break;
+      case 'S':
+        only_stream = optarg;
+        break;
+      case 'h':
+        usage (stdout, argv[0]);
+        return 0;
+      default:
+        usage (stderr, argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage (stderr, argv[0]);
+    return 2;
+  }
+
+  Binlog log;
+  if (binlog_open (&log, argv[optind]) < 0)
+    return 1;
+
+  /* Statistics over interleaved streams would be meaningless */
+  if (mode != MODE_CSV && log.n_streams > 1 && !only_stream) {
+    fprintf (stderr, "%s: %" PRIu32 " streams share the log, select one with "
+        "--stream\n", argv[optind], log.n_streams);
+    binlog_close (&log);
+    return 2;
+  }
+
+  int ret = 0;
+  switch (mode) {
+    case MODE_CSV:
+      dump_csv (&log);
+      break;
+    case MODE_SUMMARY:
+      dump_summary (&log);
+      break;
+    case MODE_FRAME:
+      if (dump_frame (&log, frame_nr) < 0) {
+        fprintf (stderr, "frame %" PRIu64 " not found\n", frame_nr);
+        ret = 1;
+      }
+      break;
+  }
+
+  binlog_close (&log);
+  stream_names_clear (&streams);
+  return ret;
+}
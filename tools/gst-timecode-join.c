@@ -0,0 +1,500 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Joins the log of timecodeoverlay with the log of timecodeparse on
+ * sec_offset and frame_nr and prints one line per frame the sender stamped,
+ * followed by a summary on stderr. Either log may be text or binary.
+ *
+ *   gst-timecode-join [--summary] [--window=MS] [--sender-stream=NAME]
+ *       [--receiver-stream=NAME] SENDER_LOG RECEIVER_LOG
+ *
+ * Both logs are read once, side by side in wall-clock time. A sent frame is
+ * held until the receiver is window past the time it was sent, so memory
+ * only grows with the frames sent within one window. Frames that arrive
+ * later than that count as lost, and their receiver record as unmatched.
+ */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gst-timecode-logfile.h"
+
+#define USEC_PER_SEC 1000000
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* Matches the largest latency timecodeparse accepts */
+#define DEFAULT_WINDOW_MS 30000
+
+/* Latency histogram for the percentiles, with a bucket per HIST_BUCKET_US
+ * up to the window */
+#define HIST_BUCKET_US 100
+
+typedef enum {
+  STATUS_OK,
+  STATUS_REORDERED,
+  STATUS_LOST,
+  STATUS_UNMATCHED,
+} Status;
+
+static const char *status_names[] = { "ok", "reordered", "lost", "unmatched" };
+
+typedef struct {
+  uint64_t sec_offset;
+  uint64_t frame_nr;
+  uint64_t time_s;
+  /* Wall-clock µs since the epoch, received is -1 until it was */
+  int64_t sent;
+  int64_t received;
+  int reordered;
+} Frame;
+
+typedef struct {
+  LogReader sender;
+  LogReader receiver;
+  int64_t window;
+  int summary_only;
+
+  /* Sent frames not yet printed, in the order of the sender log, which is
+   * sorted by sec_offset and frame_nr */
+  Frame *frames;
+  size_t capacity;
+  size_t head;
+  size_t n_frames;
+
+  Record next_sent;
+  int have_next_sent;
+  int64_t first_received;
+  /* Highest sec_offset and frame_nr received so far */
+  uint64_t max_sec_offset;
+  uint64_t max_frame_nr;
+
+  uint64_t n_sent;
+  uint64_t n_received;
+  uint64_t n_lost;
+  uint64_t n_reordered;
+  uint64_t n_duplicates;
+  uint64_t n_unmatched;
+  uint64_t n_undecodable;
+  uint64_t n_before;
+  uint64_t n_after;
+  uint64_t n_restarts;
+  uint64_t n_negative;
+  uint64_t last_sec_offset;
+
+  uint64_t n_latency;
+  int64_t lat_min;
+  int64_t lat_max;
+  double lat_sum;
+  uint64_t *hist;
+  int64_t n_hist;
+} Join;
+
+static int
+key_cmp (uint64_t sec_offset_a, uint64_t frame_nr_a, uint64_t sec_offset_b,
+    uint64_t frame_nr_b)
+{
+  if (sec_offset_a != sec_offset_b)
+    return sec_offset_a < sec_offset_b ? -1 : 1;
+  if (frame_nr_a != frame_nr_b)
+    return frame_nr_a < frame_nr_b ? -1 : 1;
+  return 0;
+}
+
+static Frame *
+frame_at (Join *j, size_t i)
+{
+  return &j->frames[(j->head + i) & (j->capacity - 1)];
+}
+
+static void
+frames_push (Join *j, const Frame *frame)
+{
+  if (j->n_frames == j->capacity) {
+    size_t capacity = j->capacity ? j->capacity * 2 : 1024;
+    Frame *frames = malloc (capacity * sizeof (Frame));
+    if (!frames) {
+      perror ("malloc");
+      exit (1);
+    }
+    for (size_t i = 0; i < j->n_frames; i++)
+      frames[i] = *frame_at (j, i);
+    free (j->frames);
+    j->frames = frames;
+    j->capacity = capacity;
+    j->head = 0;
+  }
+  *frame_at (j, j->n_frames++) = *frame;
+}
+
+/* Binary search, the frames are sorted */
+static Frame *
+frames_find (Join *j, uint64_t sec_offset, uint64_t frame_nr)
+{
+  size_t lo = 0, hi = j->n_frames;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    Frame *f = frame_at (j, mid);
+    int cmp = key_cmp (f->sec_offset, f->frame_nr, sec_offset, frame_nr);
+    if (cmp == 0)
+      return f;
+    if (cmp < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return NULL;
+}
+
+static void
+print_line (const Join *j, uint64_t frame_nr, uint64_t sec_offset,
+    uint64_t time_s, int64_t time_p, int64_t latency, Status status)
+{
+  if (j->summary_only)
+    return;
+  printf ("%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRId64 "\t%" PRId64
+      "\t%s\n", frame_nr, sec_offset, time_s, time_p, latency,
+      status_names[status]);
+}
+
+static void
+record_latency (Join *j, int64_t latency)
+{
+  if (latency < 0) {
+    j->n_negative++;
+    return;
+  }
+  if (j->n_latency == 0 || latency < j->lat_min)
+    j->lat_min = latency;
+  if (j->n_latency == 0 || latency > j->lat_max)
+    j->lat_max = latency;
+  j->lat_sum += latency;
+  j->n_latency++;
+  j->hist[latency / HIST_BUCKET_US < j->n_hist ?
+      latency / HIST_BUCKET_US : j->n_hist - 1]++;
+}
+
+static void
+pop_frame (Join *j)
+{
+  Frame *f = frame_at (j, 0);
+  int64_t time_p = -1, latency = -1;
+  Status status;
+
+  if (f->received < 0) {
+    status = STATUS_LOST;
+    j->n_lost++;
+  } else {
+    time_p = f->received - (int64_t) f->sec_offset * USEC_PER_SEC;
+    latency = f->received - f->sent;
+    status = f->reordered ? STATUS_REORDERED : STATUS_OK;
+    record_latency (j, latency);
+  }
+  print_line (j, f->frame_nr, f->sec_offset, f->time_s, time_p, latency,
+      status);
+
+  j->head = (j->head + 1) & (j->capacity - 1);
+  j->n_frames--;
+}
+
+/* Reads the sender log up to wall-clock time until */
+static int
+read_sent (Join *j, int64_t until)
+{
+  for (;;) {
+    if (!j->have_next_sent) {
+      int ret = log_reader_next (&j->sender, &j->next_sent);
+      if (ret <= 0)
+        return ret;
+      j->have_next_sent = 1;
+    }
+
+    Record *r = &j->next_sent;
+    int64_t sent = (int64_t) r->sec_offset * USEC_PER_SEC + r->time_s;
+    if (sent > until)
+      return 1;
+    j->have_next_sent = 0;
+    if (r->sec_offset == 0)
+      continue;
+
+    if (j->last_sec_offset != 0 && r->sec_offset != j->last_sec_offset)
+      j->n_restarts++;
+    j->last_sec_offset = r->sec_offset;
+
+    /* Sent before the receiver started logging */
+    if (sent < j->first_received - j->window) {
+      j->n_before++;
+      continue;
+    }
+
+    if (j->n_frames > 0) {
+      Frame *last = frame_at (j, j->n_frames - 1);
+      if (key_cmp (last->sec_offset, last->frame_nr, r->sec_offset,
+              r->frame_nr) >= 0) {
+        fprintf (stderr, "%s: frame %" PRIu64 " out of order, skipped\n",
+            j->sender.path, r->frame_nr);
+        continue;
+      }
+    }
+
+    Frame frame = {
+      .sec_offset = r->sec_offset,
+      .frame_nr = r->frame_nr,
+      .time_s = r->time_s,
+      .sent = sent,
+      .received = -1,
+    };
+    frames_push (j, &frame);
+    j->n_sent++;
+  }
+}
+
+static void
+receive (Join *j, const Record *r, int64_t received)
+{
+  if (r->sec_offset == 0) {
+    j->n_undecodable++;
+    return;
+  }
+
+  Frame *f = frames_find (j, r->sec_offset, r->frame_nr);
+  if (!f) {
+    j->n_unmatched++;
+    print_line (j, r->frame_nr, r->sec_offset, r->time_s,
+        received - (int64_t) r->sec_offset * USEC_PER_SEC, r->latency,
+        STATUS_UNMATCHED);
+    return;
+  }
+  if (f->received >= 0) {
+    j->n_duplicates++;
+    return;
+  }
+
+  f->received = received;
+  j->n_received++;
+  if (key_cmp (r->sec_offset, r->frame_nr, j->max_sec_offset,
+          j->max_frame_nr) < 0) {
+    f->reordered = 1;
+    j->n_reordered++;
+  } else {
+    j->max_sec_offset = r->sec_offset;
+    j->max_frame_nr = r->frame_nr;
+  }
+}
+
+static int
+join (Join *j)
+{
+  Record r;
+  int64_t received = -1;
+  int ret;
+
+  j->first_received = -1;
+  while ((ret = log_reader_next (&j->receiver, &r)) > 0) {
+    /* Later hops belong to the logs of the overlays further down */
+    if (r.hop != 0)
+      continue;
+
+    /* time_p is the receive time whether or not the frame was read, time_r
+     * when the frame was shown if timecodeparse measured at the sink */
+    received = (int64_t) r.sec_offset * USEC_PER_SEC +
+        (r.time_r != 0 ? r.time_r : r.time_p);
+    if (j->first_received < 0)
+      j->first_received = received;
+
+    if (read_sent (j, received + j->window) < 0)
+      return -1;
+    while (j->n_frames > 0 && frame_at (j, 0)->sent < received - j->window)
+      pop_frame (j);
+    receive (j, &r, received);
+  }
+  if (ret < 0)
+    return -1;
+
+  /* Frames sent after the receiver log ends were not lost */
+  while (j->n_frames > 0 && frame_at (j, 0)->sent <= received)
+    pop_frame (j);
+  j->n_sent -= j->n_frames;
+  j->n_after = j->n_frames;
+  Record rest;
+  if (j->have_next_sent)
+    j->n_after++;
+  while ((ret = log_reader_next (&j->sender, &rest)) > 0)
+    j->n_after++;
+  return ret;
+}
+
+static int64_t
+percentile (const Join *j, double p)
+{
+  uint64_t rank = (uint64_t) (p / 100.0 * j->n_latency + 0.5);
+  uint64_t count = 0;
+
+  for (int64_t i = 0; i < j->n_hist; i++) {
+    count += j->hist[i];
+    if (count >= rank && count > 0)
+      return MIN ((int64_t) (i + 1) * HIST_BUCKET_US, j->lat_max);
+  }
+  return j->lat_max;
+}
+
+static void
+print_summary (const Join *j, FILE *out)
+{
+  uint64_t expected = j->n_received + j->n_lost;
+
+  fprintf (out, "sent\t%" PRIu64 "\n", j->n_sent);
+  fprintf (out, "received\t%" PRIu64 "\n", j->n_received);
+  fprintf (out, "lost\t%" PRIu64 " (%.2f%%)\n", j->n_lost,
+      expected ? 100.0 * j->n_lost / expected : 0.0);
+  fprintf (out, "reordered\t%" PRIu64 "\n", j->n_reordered);
+  fprintf (out, "duplicates\t%" PRIu64 "\n", j->n_duplicates);
+  fprintf (out, "unmatched\t%" PRIu64 "\n", j->n_unmatched);
+  fprintf (out, "undecodable\t%" PRIu64 "\n", j->n_undecodable);
+  fprintf (out, "restarts\t%" PRIu64 "\n", j->n_restarts);
+  fprintf (out, "outside_receiver_log\t%" PRIu64 "\n",
+      j->n_before + j->n_after);
+  if (j->n_negative > 0)
+    fprintf (out, "negative_latency\t%" PRIu64 "\n", j->n_negative);
+  if (j->n_latency > 0)
+    fprintf (out, "latency_us\tmin=%" PRId64 " mean=%.0f p50=%" PRId64
+        " p95=%" PRId64 " p99=%" PRId64 " max=%" PRId64 "\n", j->lat_min,
+        j->lat_sum / j->n_latency, percentile (j, 50), percentile (j, 95),
+        percentile (j, 99), j->lat_max);
+}
+
+/* Only binary logs know up front that elements shared them */
+static void
+warn_streams (const LogReader *reader, const char *option)
+{
+  if (reader->binary && reader->bin.n_streams > 1 && !reader->only_stream)
+    fprintf (stderr, "%s: %" PRIu32 " streams share the log, the frames of "
+        "all of them are joined; select one with %s\n", reader->path,
+        reader->bin.n_streams, option);
+}
+
+static void
+usage (FILE *out, const char *prog)
+{
+  fprintf (out, "Usage: %s [--summary] [--window=MS] [--sender-stream=NAME]\n"
+      "    [--receiver-stream=NAME] SENDER_LOG RECEIVER_LOG\n"
+      "Join the timecodeoverlay and timecodeparse logs on frame_nr.\n\n"
+      "  -s, --summary               only print the summary, to stdout\n"
+      "  -w, --window=MS             how long a frame may be underway "
+      "(default %d)\n"
+      "  -S, --sender-stream=NAME    the stream to use of a shared sender log\n"
+      "  -R, --receiver-stream=NAME  the stream to use of a shared receiver "
+      "log\n"
+      "  -h, --help                  show this help\n\n"
+      "Columns: frame_nr, sec_offset, time_s, time_p (-1 if lost, the render\n"
+      "time for receiver logs written with measure-at=render), latency\n"
+      "(-1 if lost) and status: ok, reordered, lost, or unmatched for\n"
+      "received frames the sender log does not have.\n", prog,
+      DEFAULT_WINDOW_MS);
+}
+
+int
+main (int argc, char **argv)
+{
+  Join j = { .window = (int64_t) DEFAULT_WINDOW_MS * 1000 };
+  const char *sender_stream = NULL, *receiver_stream = NULL;
+  static const struct option options[] = {
+    {"summary", no_argument, NULL, 's'},
+    {"window", required_argument, NULL, 'w'},
+    {"sender-stream", required_argument, NULL, 'S'},
+    {"receiver-stream", required_argument, NULL, 'R'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+  int opt;
+
+  while ((opt = getopt_long (argc, argv, "sw:S:R:h", options, NULL)) != -1) {
+    switch (opt) {
+      case 's':
+        j.summary_only = 1;
+        break;
+      case 'w':
+        j.window = strtoll (optarg, NULL, 10) * 1000;
+        break;
+      case 'S':
+        sender_stream = optarg;
+        break;
+      case 'R':
+        receiver_stream = optarg;
+        break;
+      case 'h':
+        usage (stdout, argv[0]);
+        return 0;
+      default:
+        usage (stderr, argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 2 || j.window <= 0) {
+    usage (stderr, argv[0]);
+    return 2;
+  }
+
+  if (log_reader_open (&j.sender, argv[optind]) < 0)
+    return 1;
+  if (log_reader_open (&j.receiver, argv[optind + 1]) < 0) {
+    log_reader_close (&j.sender);
+    return 1;
+  }
+
+  int ret = 1;
+  if (j.sender.kind != GST_TIMECODE_BINLOG_KIND_SENDER) {
+    fprintf (stderr, "%s: not a timecodeoverlay log\n", argv[optind]);
+    goto out;
+  }
+  if (j.receiver.kind != GST_TIMECODE_BINLOG_KIND_RECEIVER) {
+    fprintf (stderr, "%s: not a timecodeparse log\n", argv[optind + 1]);
+    goto out;
+  }
+  j.sender.only_stream = sender_stream;
+  j.receiver.only_stream = receiver_stream;
+  warn_streams (&j.sender, "--sender-stream");
+  warn_streams (&j.receiver, "--receiver-stream");
+
+  j.n_hist = j.window / HIST_BUCKET_US + 1;
+  j.hist = calloc (j.n_hist, sizeof (*j.hist));
+  if (!j.hist) {
+    perror ("calloc");
+    goto out;
+  }
+
+  if (!j.summary_only)
+    fputs ("frame_nr\tsec_offset\ttime_s\ttime_p\tlatency\tstatus\n", stdout);
+  if (join (&j) < 0)
+    goto out;
+  print_summary (&j, j.summary_only ? stdout : stderr);
+  ret = 0;
+
+out:
+  free (j.hist);
+  free (j.frames);
+  log_reader_close (&j.sender);
+  log_reader_close (&j.receiver);
+  return ret;
+}
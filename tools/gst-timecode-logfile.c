@@ -0,0 +1,658 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#define _GNU_SOURCE
+#include <endian.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "gst-timecode-logfile.h"
+
+static const uint8_t gzip_magic[] = { 0x1f, 0x8b };
+static const uint8_t zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+static uint32_t
+read_u32 (const void *p)
+{
+  uint32_t v;
+  memcpy (&v, p, sizeof (v));
+  return le32toh (v);
+}
+
+static uint64_t
+read_u64 (const void *p)
+{
+  uint64_t v;
+  memcpy (&v, p, sizeof (v));
+  return le64toh (v);
+}
+
+#if defined (HAVE_ZLIB) || defined (HAVE_ZSTD)
+/* Makes room for needed bytes in a buffer that is filled up */
+static int
+grow (uint8_t **data, size_t *capacity, size_t needed)
+{
+  if (needed <= *capacity)
+    return 0;
+  size_t capacity_new = *capacity ? *capacity : 1 << 20;
+  while (capacity_new < needed)
+    capacity_new *= 2;
+  uint8_t *data_new = realloc (*data, capacity_new);
+  if (!data_new)
+    return -1;
+  *data = data_new;
+  *capacity = capacity_new;
+  return 0;
+}
+#endif
+
+#ifdef HAVE_ZLIB
+static int
+gunzip (const uint8_t *in, size_t in_size, uint8_t **out, size_t *out_size)
+{
+  z_stream z = { 0 };
+  size_t capacity = 0;
+  int ret;
+
+  /* 32 detects the gzip wrapper */
+  if (inflateInit2 (&z, 15 + 32) != Z_OK)
+    return -1;
+  z.next_in = (uint8_t *) in;
+  z.avail_in = in_size;
+  *out = NULL;
+  *out_size = 0;
+  do {
+    if (grow (out, &capacity, *out_size + 65536) < 0)
+      break;
+    z.next_out = *out + *out_size;
+    z.avail_out = capacity - *out_size;
+    ret = inflate (&z, Z_NO_FLUSH);
+    *out_size = capacity - z.avail_out;
+    /* Concatenated members decompress to one log */
+    if (ret == Z_STREAM_END && z.avail_in > 0 && inflateReset (&z) == Z_OK)
+      ret = Z_OK;
+  } while (ret == Z_OK);
+  inflateEnd (&z);
+
+  /* A log that is still written ends in the middle of the stream */
+  if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && z.avail_in == 0))
+    return 0;
+  free (*out);
+  return -1;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static int
+unzstd (const uint8_t *in, size_t in_size, uint8_t **out, size_t *out_size)
+{
+  ZSTD_DStream *z = ZSTD_createDStream ();
+  ZSTD_inBuffer input = { in, in_size, 0 };
+  size_t capacity = 0, ret = 0;
+
+  if (!z)
+    return -1;
+  *out = NULL;
+  *out_size = 0;
+  while (input.pos < input.size) {
+    if (grow (out, &capacity, *out_size + 65536) < 0) {
+      ret = (size_t) -1;
+      break;
+    }
+    ZSTD_outBuffer output = { *out, capacity, *out_size };
+    ret = ZSTD_decompressStream (z, &output, &input);
+    *out_size = output.pos;
+    if (ZSTD_isError (ret))
+      break;
+  }
+  ZSTD_freeDStream (z);
+
+  /* As with gzip, a frame that is still written may be incomplete */
+  if (ZSTD_isError (ret)) {
+    free (*out);
+    return -1;
+  }
+  return 0;
+}
+#endif
+
+/* 1 and the decompressed contents of path if it is compressed, 0 if it is
+ * not and -1 on errors */
+static int
+read_compressed (const char *path, uint8_t **data, size_t *size)
+{
+  uint8_t magic[4];
+  int is_gzip, is_zstd;
+
+  FILE *f = fopen (path, "rb");
+  if (!f) {
+    perror (path);
+    return -1;
+  }
+  size_t n = fread (magic, 1, sizeof (magic), f);
+  is_gzip = n >= sizeof (gzip_magic) && memcmp (magic, gzip_magic, sizeof (gzip_magic)) == 0;
+  is_zstd = n >= sizeof (zstd_magic) && memcmp (magic, zstd_magic, sizeof (zstd_magic)) == 0;
+  fclose (f);
+  if (!is_gzip && !is_zstd)
+    return 0;
+
+  int fd = open (path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat (fd, &st) < 0) {
+    perror (path);
+    if (fd >= 0)
+      close (fd);
+    return -1;
+  }
+  if (!S_ISREG (st.st_mode) || st.st_size == 0) {
+    fprintf (stderr, "%s: compressed logs are read from non-empty files\n", path);
+    close (fd);
+    return -1;
+  }
+  void *in = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (in == MAP_FAILED) {
+    perror (path);
+    return -1;
+  }
+
+  const char *error = "corrupt compressed log";
+  int ret = -1;
+  if (is_gzip) {
+#ifdef HAVE_ZLIB
+    ret = gunzip (in, st.st_size, data, size);
+#else
+    (void) data;
+    (void) size;
+    error = "gzip compressed, but built without zlib";
+#endif
+  } else {
+#ifdef HAVE_ZSTD
+    ret = unzstd (in, st.st_size, data, size);
+#else
+    (void) data;
+    (void) size;
+    error = "zstd compressed, but built without libzstd";
+#endif
+  }
+  munmap (in, st.st_size);
+
+  if (ret < 0) {
+    fprintf (stderr, "%s: %s\n", path, error);
+    return -1;
+  }
+  return 1;
+}
+
+/* Takes the header apart. data stays the caller's on errors. */
+static int
+binlog_init (Binlog *log, const char *path, const uint8_t *data, size_t size)
+{
+  if (size < sizeof (GstTimecodeBinlogHeader)) {
+    fprintf (stderr, "%s: too short for a timecode log\n", path);
+    return -1;
+  }
+
+  const GstTimecodeBinlogHeader *h = (const void *) data;
+  uint32_t header_size = read_u32 (&h->header_size);
+  uint32_t record_size = read_u32 (&h->record_size);
+  if (memcmp (h->magic, GST_TIMECODE_BINLOG_MAGIC, sizeof (h->magic)) != 0) {
+    fprintf (stderr, "%s: not a binary timecode log\n", path);
+    return -1;
+  }
+  if (read_u32 (&h->version) > GST_TIMECODE_BINLOG_VERSION) {
+    fprintf (stderr, "%s: unsupported version %" PRIu32 "\n", path,
+        read_u32 (&h->version));
+    return -1;
+  }
+  if (header_size < sizeof (GstTimecodeBinlogHeader) || header_size > size ||
+      record_size < offsetof (GstTimecodeBinlogRecord, hop)) {
+    fprintf (stderr, "%s: corrupt header\n", path);
+    return -1;
+  }
+
+  log->data = data;
+  log->size = size;
+  log->buffer = NULL;
+  log->kind = read_u32 (&h->kind);
+  log->sec_offset = read_u64 (&h->sec_offset);
+  log->width = read_u32 (&h->width);
+  log->height = read_u32 (&h->height);
+  log->fps_n = (int32_t) read_u32 (&h->fps_n);
+  log->fps_d = (int32_t) read_u32 (&h->fps_d);
+  log->n_streams = read_u32 (&h->n_streams);
+  if (log->n_streams == 0)
+    log->n_streams = 1;
+  log->records = log->data + header_size;
+  log->record_size = record_size;
+  /* A trailing partial record is from a writer that is still running */
+  log->n_records = (log->size - header_size) / record_size;
+  return 0;
+}
+
+/* The header of a compressed log cannot count streams that joined later,
+ * but their announcements do. It is in memory anyway. */
+static void
+binlog_count_streams (Binlog *log)
+{
+  Record r;
+
+  for (uint64_t i = 0; i < log->n_records; i++) {
+    binlog_get (log, i, &r);
+    if ((r.flags & GST_TIMECODE_BINLOG_FLAG_STREAM) && r.stream >= log->n_streams)
+      log->n_streams = r.stream + 1;
+  }
+}
+
+static int
+binlog_init_compressed (Binlog *log, const char *path, uint8_t *data,
+    size_t size)
+{
+  if (binlog_init (log, path, data, size) < 0) {
+    free (data);
+    return -1;
+  }
+  log->buffer = data;
+  binlog_count_streams (log);
+  return 0;
+}
+
+int
+binlog_open (Binlog *log, const char *path)
+{
+  uint8_t *buffer = NULL;
+  size_t buffer_size = 0;
+
+  switch (read_compressed (path, &buffer, &buffer_size)) {
+    case -1:
+      return -1;
+    case 1:
+      return binlog_init_compressed (log, path, buffer, buffer_size);
+  }
+
+  int fd = open (path, O_RDONLY);
+  if (fd < 0) {
+    perror (path);
+    return -1;
+  }
+  struct stat st;
+  if (fstat (fd, &st) < 0) {
+    perror (path);
+    close (fd);
+    return -1;
+  }
+  if ((size_t) st.st_size < sizeof (GstTimecodeBinlogHeader)) {
+    fprintf (stderr, "%s: too short for a timecode log\n", path);
+    close (fd);
+    return -1;
+  }
+  void *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED) {
+    perror (path);
+    return -1;
+  }
+  madvise (data, st.st_size, MADV_SEQUENTIAL);
+
+  if (binlog_init (log, path, data, st.st_size) < 0) {
+    munmap (data, st.st_size);
+    return -1;
+  }
+  return 0;
+}
+
+void
+binlog_close (Binlog *log)
+{
+  if (log->buffer)
+    free (log->buffer);
+  else
+    munmap ((void *) log->data, log->size);
+}
+
+void
+binlog_get (const Binlog *log, uint64_t i, Record *r)
+{
+  const GstTimecodeBinlogRecord *in =
+      (const void *) (log->records + i * log->record_size);
+
+  r->frame_nr = read_u64 (&in->frame_nr);
+  r->time_s = read_u64 (&in->time_s);
+  r->time_p = read_u64 (&in->time_p);
+  r->latency = (int64_t) read_u64 (&in->latency);
+  r->flags = read_u32 (&in->flags);
+  r->stream_name[0] = '\0';
+  if (r->flags & GST_TIMECODE_BINLOG_FLAG_STREAM) {
+    const GstTimecodeBinlogStream *s = (const void *) in;
+    uint32_t flags = r->flags;
+    memset (r, 0, sizeof (*r));
+    r->flags = flags;
+    r->stream = read_u32 (&s->stream);
+    memcpy (r->stream_name, s->name, sizeof (s->name));
+    r->stream_name[sizeof (s->name)] = '\0';
+    return;
+  }
+  if (r->flags & GST_TIMECODE_BINLOG_FLAG_NO_SEC_OFFSET)
+    r->sec_offset = 0;
+  else
+    r->sec_offset = log->sec_offset + (int32_t) read_u32 (&in->sec_offset_delta);
+  /* Version 1 records end before the hop fields */
+  if (log->record_size >= offsetof (GstTimecodeBinlogRecord, hop_delta) + sizeof (in->hop_delta)) {
+    r->hop = read_u32 (&in->hop);
+    r->stream = read_u32 (&in->stream);
+    r->hop_delta = (int64_t) read_u64 (&in->hop_delta);
+  } else {
+    r->hop = 0;
+    r->stream = 0;
+    r->hop_delta = -1;
+  }
+  /* Version 2 records end before the clock fields */
+  if (log->record_size >= offsetof (GstTimecodeBinlogRecord, clock_error) + sizeof (in->clock_error)) {
+    r->clock_offset = (int64_t) read_u64 (&in->clock_offset);
+    r->clock_error = (int64_t) read_u64 (&in->clock_error);
+  } else {
+    r->clock_offset = 0;
+    r->clock_error = -1;
+  }
+  /* Version 3 records end before the render fields */
+  if (log->record_size >= offsetof (GstTimecodeBinlogRecord, render_latency) + sizeof (in->render_latency)) {
+    r->time_r = read_u64 (&in->time_r);
+    r->render_latency = (int64_t) read_u64 (&in->render_latency);
+  } else {
+    r->time_r = 0;
+    r->render_latency = -1;
+  }
+}
+
+void
+stream_names_set (StreamNames *names, uint32_t stream, const char *name)
+{
+  if (stream >= names->n) {
+    char **grown = realloc (names->names, (stream + 1) * sizeof (char *));
+    if (!grown)
+      return;
+    memset (grown + names->n, 0, (stream + 1 - names->n) * sizeof (char *));
+    names->names = grown;
+    names->n = stream + 1;
+  }
+  free (names->names[stream]);
+  names->names[stream] = strdup (name);
+}
+
+const char *
+stream_names_get (const StreamNames *names, uint32_t stream)
+{
+  return stream < names->n ? names->names[stream] : NULL;
+}
+
+uint32_t
+stream_names_find (StreamNames *names, const char *name)
+{
+  for (uint32_t i = 0; i < names->n; i++)
+    if (names->names[i] && strcmp (names->names[i], name) == 0)
+      return i;
+
+  uint32_t stream = names->n;
+  stream_names_set (names, stream, name);
+  return stream;
+}
+
+void
+stream_names_clear (StreamNames *names)
+{
+  for (uint32_t i = 0; i < names->n; i++)
+    free (names->names[i]);
+  free (names->names);
+  names->names = NULL;
+  names->n = 0;
+}
+
+enum {
+  COLUMN_FRAME_NR,
+  COLUMN_TIME_S,
+  COLUMN_TIME_P,
+  COLUMN_LATENCY,
+  COLUMN_SEC_OFFSET,
+  COLUMN_HOP,
+  COLUMN_HOP_DELTA,
+  COLUMN_CLOCK_OFFSET,
+  COLUMN_CLOCK_ERROR,
+  COLUMN_TIME_R,
+  COLUMN_RENDER_LATENCY,
+  COLUMN_STREAM,
+  N_COLUMNS,
+};
+
+static const char *column_names[N_COLUMNS] = {
+  "frame_nr", "time_s", "time_p", "latency", "sec_offset", "hop", "hop_delta",
+  "clock_offset", "clock_error", "time_r", "render_latency", "stream",
+};
+
+/* Finds the columns in the header line. Only receiver logs have time_p. */
+static int
+text_open (LogReader *reader)
+{
+  if (getline (&reader->line, &reader->line_size, reader->file) < 0) {
+    fprintf (stderr, "%s: empty log\n", reader->path);
+    return -1;
+  }
+  reader->line_nr = 1;
+
+  for (int c = 0; c < N_COLUMNS; c++)
+    reader->columns[c] = -1;
+
+  char *save = NULL;
+  int i = 0;
+  for (char *name = strtok_r (reader->line, "\t\n", &save); name;
+      name = strtok_r (NULL, "\t\n", &save), i++)
+    for (int c = 0; c < N_COLUMNS; c++)
+      if (strcmp (name, column_names[c]) == 0)
+        reader->columns[c] = i;
+
+  if (reader->columns[COLUMN_FRAME_NR] < 0 ||
+      reader->columns[COLUMN_TIME_S] < 0 ||
+      reader->columns[COLUMN_SEC_OFFSET] < 0) {
+    fprintf (stderr, "%s: not a timecode log\n", reader->path);
+    return -1;
+  }
+  reader->kind = reader->columns[COLUMN_TIME_P] >= 0 ?
+      GST_TIMECODE_BINLOG_KIND_RECEIVER : GST_TIMECODE_BINLOG_KIND_SENDER;
+  return 0;
+}
+
+static int
+text_next (LogReader *reader, Record *r)
+{
+  ssize_t len;
+
+  /* Skip empty lines, e.g. a trailing one */
+  do {
+    len = getline (&reader->line, &reader->line_size, reader->file);
+    if (len < 0)
+      return 0;
+    reader->line_nr++;
+  } while (len <= 1);
+
+  char *fields[16];
+  int n = 0;
+  char *save = NULL;
+  for (char *field = strtok_r (reader->line, "\t\n", &save); field && n < 16;
+      field = strtok_r (NULL, "\t\n", &save))
+    fields[n++] = field;
+
+  int64_t values[N_COLUMNS] = { 0, 0, 0, 0, 0, 0, -1, 0, -1, 0, -1, 0 };
+  for (int c = 0; c < N_COLUMNS; c++) {
+    int i = reader->columns[c];
+    if (i < 0)
+      continue;
+    if (c == COLUMN_STREAM) {
+      /* Unnamed streams leave an empty last field */
+      values[c] = stream_names_find (&reader->streams, i < n ? fields[i] : "");
+      continue;
+    }
+    if (i >= n) {
+      fprintf (stderr, "%s:%" PRIu64 ": missing %s\n", reader->path,
+          reader->line_nr, column_names[c]);
+      return -1;
+    }
+    values[c] = strtoll (fields[i], NULL, 10);
+  }
+
+  /* All values of the logs fit into 63 bits */
+  r->frame_nr = values[COLUMN_FRAME_NR];
+  r->time_s = values[COLUMN_TIME_S];
+  r->time_p = values[COLUMN_TIME_P];
+  r->latency = values[COLUMN_LATENCY];
+  r->sec_offset = values[COLUMN_SEC_OFFSET];
+  r->hop = values[COLUMN_HOP];
+  r->hop_delta = values[COLUMN_HOP_DELTA];
+  r->clock_offset = values[COLUMN_CLOCK_OFFSET];
+  r->clock_error = values[COLUMN_CLOCK_ERROR];
+  r->time_r = values[COLUMN_TIME_R];
+  r->render_latency = values[COLUMN_RENDER_LATENCY];
+  r->stream = values[COLUMN_STREAM];
+  r->stream_name[0] = '\0';
+  r->flags = 0;
+  if (r->sec_offset == 0)
+    r->flags |= GST_TIMECODE_BINLOG_FLAG_NO_SEC_OFFSET;
+  if (reader->kind == GST_TIMECODE_BINLOG_KIND_RECEIVER && r->latency < 0)
+    r->flags |= GST_TIMECODE_BINLOG_FLAG_NO_LATENCY;
+  return 1;
+}
+
+int
+log_reader_open (LogReader *reader, const char *path)
+{
+  char magic[sizeof (((GstTimecodeBinlogHeader *) NULL)->magic)];
+  uint8_t *buffer = NULL;
+  size_t buffer_size = 0;
+
+  memset (reader, 0, sizeof (*reader));
+  reader->path = path;
+
+  switch (read_compressed (path, &buffer, &buffer_size)) {
+    case -1:
+      return -1;
+    case 1:
+      if (buffer_size >= sizeof (magic) &&
+          memcmp (buffer, GST_TIMECODE_BINLOG_MAGIC, sizeof (magic)) == 0) {
+        if (binlog_init_compressed (&reader->bin, path, buffer, buffer_size) < 0)
+          return -1;
+        reader->binary = 1;
+        reader->kind = reader->bin.kind;
+        return 0;
+      }
+      /* Text logs are read like files */
+      reader->buffer = buffer;
+      reader->file = fmemopen (buffer, buffer_size, "r");
+      if (!reader->file) {
+        perror (path);
+        log_reader_close (reader);
+        return -1;
+      }
+      goto text;
+  }
+
+  reader->file = fopen (path, "r");
+  if (!reader->file) {
+    perror (path);
+    return -1;
+  }
+
+  if (fread (magic, 1, sizeof (magic), reader->file) == sizeof (magic) &&
+      memcmp (magic, GST_TIMECODE_BINLOG_MAGIC, sizeof (magic)) == 0) {
+    fclose (reader->file);
+    reader->file = NULL;
+    if (binlog_open (&reader->bin, path) < 0)
+      return -1;
+    reader->binary = 1;
+    reader->kind = reader->bin.kind;
+    return 0;
+  }
+
+  rewind (reader->file);
+text:
+  if (text_open (reader) < 0) {
+    log_reader_close (reader);
+    return -1;
+  }
+  return 0;
+}
+
+void
+log_reader_close (LogReader *reader)
+{
+  if (reader->binary)
+    binlog_close (&reader->bin);
+  if (reader->file)
+    fclose (reader->file);
+  free (reader->buffer);
+  free (reader->line);
+  stream_names_clear (&reader->streams);
+  memset (reader, 0, sizeof (*reader));
+}
+
+static int
+next_record (LogReader *reader, Record *r)
+{
+  if (!reader->binary)
+    return text_next (reader, r);
+
+  if (reader->next == reader->bin.n_records)
+    return 0;
+  binlog_get (&reader->bin, reader->next++, r);
+  return 1;
+}
+
+int
+log_reader_next (LogReader *reader, Record *r)
+{
+  int ret;
+
+  while ((ret = next_record (reader, r)) > 0) {
+    if (r->flags & GST_TIMECODE_BINLOG_FLAG_STREAM) {
+      stream_names_set (&reader->streams, r->stream, r->stream_name);
+      continue;
+    }
+    if (!reader->only_stream ||
+        strcmp (log_reader_stream_name (reader, r->stream), reader->only_stream) == 0)
+      break;
+  }
+  return ret;
+}
+
+const char *
+log_reader_stream_name (const LogReader *reader, uint32_t stream)
+{
+  const char *name = stream_names_get (&reader->streams, stream);
+  return name ? name : "";
+}
@@ -0,0 +1,121 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Reading the logs of timecodeoverlay and timecodeparse in the tools. Like
+ * gsttimecodebinlog.h this only depends on the C library. */
+
+#ifndef __GST_TIMECODE_LOGFILE_H__
+#define __GST_TIMECODE_LOGFILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gsttimecodebinlog.h"
+
+/* A memory-mapped binary log, or a compressed one read into memory */
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+  /* The decompressed log, NULL if mapped */
+  uint8_t *buffer;
+  uint32_t kind;
+  uint64_t sec_offset;
+  uint32_t width;
+  uint32_t height;
+  int32_t fps_n;
+  int32_t fps_d;
+  /* At least 1, several if elements shared the file */
+  uint32_t n_streams;
+  const uint8_t *records;
+  uint32_t record_size;
+  uint64_t n_records;
+} Binlog;
+
+/* A record decoded to host byte order */
+typedef struct {
+  uint64_t frame_nr;
+  uint64_t time_s;
+  uint64_t time_p;
+  int64_t latency;
+  uint32_t flags;
+  uint64_t sec_offset;
+  uint32_t hop;
+  int64_t hop_delta;
+  int64_t clock_offset;
+  int64_t clock_error;
+  uint64_t time_r;
+  int64_t render_latency;
+  uint32_t stream;
+  /* Only for records with GST_TIMECODE_BINLOG_FLAG_STREAM, which announce
+   * the name of stream and are no frames */
+  char stream_name[sizeof (((GstTimecodeBinlogStream *) NULL)->name) + 1];
+} Record;
+
+/* The names of the streams of a log by index */
+typedef struct {
+  char **names;
+  uint32_t n;
+} StreamNames;
+
+void stream_names_set (StreamNames *names, uint32_t stream, const char *name);
+/* NULL if stream has not been named */
+const char *stream_names_get (const StreamNames *names, uint32_t stream);
+/* The index of name, which is added if it is new */
+uint32_t stream_names_find (StreamNames *names, const char *name);
+void stream_names_clear (StreamNames *names);
+
+/* Both open gzip and zstd compressed logs too, if built with them */
+int binlog_open (Binlog *log, const char *path);
+void binlog_close (Binlog *log);
+void binlog_get (const Binlog *log, uint64_t i, Record *r);
+
+/* Reads a text or binary log front to back, whichever the file is */
+typedef struct {
+  const char *path;
+  uint32_t kind;
+  int binary;
+
+  Binlog bin;
+  uint64_t next;
+
+  FILE *file;
+  /* A decompressed text log the file reads from */
+  uint8_t *buffer;
+  char *line;
+  size_t line_size;
+  uint64_t line_nr;
+  /* Column of each Record field in the text log, -1 if it has none */
+  int columns[12];
+
+  StreamNames streams;
+  /* Set to only read the records of this stream */
+  const char *only_stream;
+} LogReader;
+
+int log_reader_open (LogReader *reader, const char *path);
+void log_reader_close (LogReader *reader);
+
+/* 1 if r was filled in, 0 at the end of the log and -1 on errors. Stream
+ * announcements are not returned. */
+int log_reader_next (LogReader *reader, Record *r);
+/* The name of stream, "" if it has none */
+const char *log_reader_stream_name (const LogReader *reader, uint32_t stream);
+
+#endif /* __GST_TIMECODE_LOGFILE_H__ */
@@ -0,0 +1,283 @@
+/*
+ * GStreamer
+ * Copyright (C) 2022 Hendrik Cech <<user@hostname.org>>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Follows the live telemetry of a timecodeoverlay or timecodeparse with
+ * shm-name set and prints the records in the text log format as they are
+ * published, e.g. to pipe into a live plot.
+ *
+ *   gst-timecode-monitor [--from-start] NAME
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gsttimecodeshmring.h"
+
+/* How long to sleep when no record is new */
+#define POLL_INTERVAL_US 1000
+/* Polls between checks whether the writer is still there */
+#define WRITER_CHECK_POLLS 1000
+/* How long to wait for a new writer once the old one is gone */
+#define REOPEN_POLLS 5000
+
+static volatile sig_atomic_t stop;
+
+static void
+on_signal (int sig)
+{
+  (void) sig;
+  stop = 1;
+}
+
+/* quiet for retries while a writer may be setting the object up */
+static const GstTimecodeShmHeader *
+shm_map (const char *name, size_t *size, int quiet)
+{
+  int fd = shm_open (name, O_RDONLY, 0);
+  if (fd < 0) {
+    if (!quiet)
+      fprintf (stderr, "%s: %s\n", name, strerror (errno));
+    return NULL;
+  }
+
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat (fd, &st) == 0 && (size_t) st.st_size >= sizeof (GstTimecodeShmHeader))
+    data = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED) {
+    if (!quiet)
+      fprintf (stderr, "%s: not a timecode telemetry ring\n", name);
+    return NULL;
+  }
+
+  const GstTimecodeShmHeader *header = data;
+  if (memcmp (header->magic, GST_TIMECODE_SHM_MAGIC, sizeof (header->magic)) != 0 ||
+      header->version < 1 || header->slot_size < sizeof (GstTimecodeShmSlot) ||
+      header->n_slots == 0 || (header->n_slots & (header->n_slots - 1)) != 0 ||
+      header->header_size + (uint64_t) header->n_slots * header->slot_size >
+      (uint64_t) st.st_size) {
+    if (!quiet)
+      fprintf (stderr, "%s: not a timecode telemetry ring\n", name);
+    munmap (data, st.st_size);
+    return NULL;
+  }
+
+  *size = st.st_size;
+  return header;
+}
+
+/* Same columns as the text log of the element that publishes */
+static void
+print_columns (uint32_t kind)
+{
+  if (kind == GST_TIMECODE_BINLOG_KIND_SENDER)
+    fputs ("ts\tframe_nr\ttime_s\tsec_offset\tclock_offset\tclock_error\n",
+        stdout);
+  else
+    fputs ("ts\tframe_nr\tlatency\ttime_s\ttime_p\tsec_offset\thop\thop_delta"
+        "\tclock_offset\tclock_error\ttime_r\trender_latency\n", stdout);
+}
+
+static void
+print_record (uint32_t kind, const GstTimecodeShmRecord *r)
+{
+  static int64_t cached_second = -1;
+  static char prefix[sizeof ("2011-10-08 07:07:09")];
+
+  int64_t second = r->realtime / 1000000;
+  if (second != cached_second) {
+    time_t t = second;
+    struct tm tm;
+    gmtime_r (&t, &tm);
+    strftime (prefix, sizeof (prefix), "%Y-%m-%d %H:%M:%S", &tm);
+    cached_second = second;
+  }
+
+  if (kind == GST_TIMECODE_BINLOG_KIND_SENDER)
+    printf ("%s.%06dZ\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRId64 "\t%"
+        PRId64 "\n", prefix, (int) (r->realtime % 1000000), r->frame_nr,
+        r->time_s, r->sec_offset, r->clock_offset, r->clock_error);
+  else
+    printf ("%s.%06dZ\t%" PRIu64 "\t%" PRId64 "\t%" PRIu64 "\t%" PRIu64 "\t%"
+        PRIu64 "\t%" PRIu32 "\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%" PRIu64
+        "\t%" PRId64 "\n", prefix, (int) (r->realtime % 1000000), r->frame_nr,
+        r->latency, r->time_s, r->time_p, r->sec_offset, r->hop, r->hop_delta,
+        r->clock_offset, r->clock_error, r->time_r, r->render_latency);
+}
+
+/* Whether the writer closed the ring or went away without doing so */
+static int
+writer_gone (const GstTimecodeShmHeader *header)
+{
+  return atomic_load_explicit (&header->closed, memory_order_acquire) ||
+      (kill ((pid_t) header->pid, 0) < 0 && errno == ESRCH);
+}
+
+/* Maps the ring of the next writer of name, waiting a while for it to
+ * appear. NULL if none does. */
+static const GstTimecodeShmHeader *
+shm_reopen (const char *name, size_t *size)
+{
+  for (unsigned polls = 0; polls < REOPEN_POLLS && !stop; polls++) {
+    const GstTimecodeShmHeader *header = shm_map (name, size, 1);
+    if (header && !writer_gone (header))
+      return header;
+    /* Still the old ring, or one that is being replaced */
+    if (header)
+      munmap ((void *) header, *size);
+    usleep (POLL_INTERVAL_US);
+  }
+  return NULL;
+}
+
+/* Prints the records from next on until stopped or no writer takes over
+ * name from the one that is gone. Takes the mapping. */
+static int
+follow (const char *name, const GstTimecodeShmHeader *header, size_t size,
+    uint64_t next)
+{
+  uint64_t skipped = 0;
+  unsigned polls = 0;
+
+  print_columns (header->kind);
+  while (!stop) {
+    GstTimecodeShmRecord r;
+    int ret = gst_timecode_shm_read (header, next, &r);
+
+    if (ret > 0) {
+      print_record (header->kind, &r);
+      next++;
+      continue;
+    }
+
+    if (ret < 0) {
+      /* Overtaken by the writer, continue with the oldest record it kept */
+      uint64_t head = atomic_load_explicit (&header->head, memory_order_acquire);
+      uint64_t oldest = head > header->n_slots ? head - header->n_slots : 0;
+      skipped += oldest > next ? oldest - next : 1;
+      next = oldest > next ? oldest : next + 1;
+      continue;
+    }
+
+    fflush (stdout);
+    /* closed is set after the last record, which has been read by now */
+    if (atomic_load_explicit (&header->closed, memory_order_acquire) ||
+        ++polls == WRITER_CHECK_POLLS) {
+      polls = 0;
+      if (writer_gone (header)) {
+        uint32_t kind = header->kind;
+        munmap ((void *) header, size);
+        if (!(header = shm_reopen (name, &size)))
+          break;
+        /* The new writer counts from 0 again */
+        fprintf (stderr, "%s: following the ring of process %" PRIu32 "\n",
+            name, header->pid);
+        if (header->kind != kind)
+          print_columns (header->kind);
+        next = 0;
+        continue;
+      }
+    }
+    usleep (POLL_INTERVAL_US);
+  }
+
+  if (header)
+    munmap ((void *) header, size);
+  fflush (stdout);
+  if (skipped > 0)
+    fprintf (stderr, "skipped %" PRIu64 " records the writer overwrote\n",
+        skipped);
+  return 0;
+}
+
+static void
+usage (FILE *out, const char *prog)
+{
+  fprintf (out, "Usage: %s [--from-start] NAME\n"
+      "Print the records a timecodeoverlay/timecodeparse with shm-name=NAME\n"
+      "publishes, in the text log format, until interrupted or the element\n"
+      "goes away. An element that takes over NAME within a few seconds is\n"
+      "followed from its first record.\n\n"
+      "  -s, --from-start  begin with the oldest record still in the ring\n"
+      "                    instead of the next one published\n"
+      "  -h, --help        show this help\n", prog);
+}
+
+int
+main (int argc, char **argv)
+{
+  int from_start = 0;
+  static const struct option options[] = {
+    {"from-start", no_argument, NULL, 's'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+  int opt;
+
+  while ((opt = getopt_long (argc, argv, "sh", options, NULL)) != -1) {
+    switch (opt) {
+      case 's':
+        from_start = 1;
+        break;
+      case 'h':
+        usage (stdout, argv[0]);
+        return 0;
+      default:
+        usage (stderr, argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage (stderr, argv[0]);
+    return 2;
+  }
+
+  char name[256];
+  snprintf (name, sizeof (name), "%s%s", argv[optind][0] == '/' ? "" : "/",
+      argv[optind]);
+
+  size_t size;
+  const GstTimecodeShmHeader *header = shm_map (name, &size, 0);
+  if (!header)
+    return 1;
+
+  signal (SIGINT, on_signal);
+  signal (SIGTERM, on_signal);
+  signal (SIGPIPE, on_signal);
+
+  uint64_t head = atomic_load_explicit (&header->head, memory_order_acquire);
+  uint64_t next = head;
+  if (from_start)
+    next = head > header->n_slots ? head - header->n_slots : 0;
+
+  return follow (name, header, size, next);
+}